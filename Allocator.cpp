@@ -0,0 +1,103 @@
+#include "Allocator.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+void* allocatorAlloc(const Allocator &allocator, size_t numBytes, size_t alignment)
+{
+    if(!allocator.allocate) {
+        // malloc() is aligned for any built-in type, which is all we need
+        assert(alignment <= DEFAULT_ALLOCATION_ALIGNMENT);
+        return malloc(numBytes);
+    }
+    return allocator.allocate(allocator.userData, numBytes, alignment);
+}
+
+void allocatorFree(const Allocator &allocator, void* memory)
+{
+    if(!allocator.allocate)
+        free(memory);
+    else if(allocator.free)
+        allocator.free(allocator.userData, memory);
+}
+
+Arena createArena(size_t capacity)
+{
+    Arena result = {};
+    result.memory = (uint8_t*)malloc(capacity);
+    assert(result.memory || capacity == 0);
+    result.capacity = capacity;
+    result.ownsMemory = true;
+    return result;
+}
+
+Arena createArena(void* memory, size_t capacity)
+{
+    Arena result = {};
+    result.memory = (uint8_t*)memory;
+    result.capacity = capacity;
+    return result;
+}
+
+void destroyArena(Arena* arena)
+{
+    if(arena->ownsMemory)
+        free(arena->memory);
+    *arena = {};
+}
+
+void* arenaPush(Arena* arena, size_t numBytes, size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    size_t start = ((uintptr_t)arena->memory + arena->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    start -= (uintptr_t)arena->memory;
+    if(start + numBytes > arena->capacity)
+        return NULL;
+    arena->used = start + numBytes;
+    if(arena->used > arena->peakUsed)
+        arena->peakUsed = arena->used;
+    return arena->memory + start;
+}
+
+void arenaReset(Arena* arena)
+{
+    arena->used = 0;
+}
+
+bool arenaReserve(Arena* arena, size_t numBytes)
+{
+    assert(arena->used == 0);
+    if(numBytes <= arena->capacity)
+        return true;
+    if(!arena->ownsMemory)
+        return false;
+
+    // Grow geometrically so a series of slightly bigger loads doesn't reallocate every time
+    size_t newCapacity = arena->capacity + arena->capacity / 2;
+    if(newCapacity < numBytes)
+        newCapacity = numBytes;
+    free(arena->memory);
+    arena->memory = (uint8_t*)malloc(newCapacity);
+    assert(arena->memory);
+    arena->capacity = newCapacity;
+    return true;
+}
+
+static void* arenaAllocate(void* userData, size_t numBytes, size_t alignment)
+{
+    return arenaPush((Arena*)userData, numBytes, alignment);
+}
+
+Allocator arenaAllocator(Arena* arena)
+{
+    Allocator result = {};
+    result.allocate = arenaAllocate;
+    result.free = NULL;
+    result.userData = arena;
+    return result;
+}
+
+Arena* getAllocatorArena(const Allocator &allocator)
+{
+    return (allocator.allocate == arenaAllocate) ? (Arena*)allocator.userData : NULL;
+}
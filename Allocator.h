@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pluggable memory allocation, so callers can decide where long-lived
+// buffers (e.g. the ones in a LoadedObj) end up.
+// A zero-initialised Allocator uses malloc()/free().
+//
+// Usage:
+// Arena arena = createArena(64 * 1024 * 1024);
+// Allocator allocator = arenaAllocator(&arena);
+// void* memory = allocatorAlloc(allocator, 1024);
+// ...
+// allocatorFree(allocator, memory); // No-op for arenas
+// arenaReset(&arena); // Frees everything allocated from the arena at once
+// ...
+// destroyArena(&arena);
+
+typedef void* AllocateProc(void* userData, size_t numBytes, size_t alignment);
+typedef void FreeProc(void* userData, void* memory);
+
+struct Allocator
+{
+    AllocateProc* allocate;
+    FreeProc* free; // Can be NULL if memory doesn't need to be freed individually
+    void* userData;
+};
+
+#define DEFAULT_ALLOCATION_ALIGNMENT 16
+
+// Returns NULL if the allocation failed
+void* allocatorAlloc(const Allocator &allocator, size_t numBytes, size_t alignment = DEFAULT_ALLOCATION_ALIGNMENT);
+void allocatorFree(const Allocator &allocator, void* memory);
+
+// Linear allocator: allocating just bumps a pointer through one big block,
+// and everything is freed at once by resetting it.
+struct Arena
+{
+    uint8_t* memory;
+    size_t capacity;
+    size_t used;
+    size_t peakUsed; // Highest `used` has been since the arena was created
+    bool ownsMemory;
+};
+
+// Allocates the arena's block with malloc()
+Arena createArena(size_t capacity);
+// Uses the caller's memory, which must outlive the arena
+Arena createArena(void* memory, size_t capacity);
+void destroyArena(Arena* arena);
+
+// Returns NULL if the arena is full
+void* arenaPush(Arena* arena, size_t numBytes, size_t alignment = DEFAULT_ALLOCATION_ALIGNMENT);
+void arenaReset(Arena* arena);
+
+// Makes sure the arena has room for `numBytes`, growing its block if it owns it.
+// Only valid on an empty arena, since growing moves the block.
+// Returns false if the arena is too small and can't grow.
+bool arenaReserve(Arena* arena, size_t numBytes);
+
+// The Allocator keeps a pointer to `arena`, so don't move the arena
+// while the Allocator is in use
+Allocator arenaAllocator(Arena* arena);
+// Returns the arena behind an Allocator from arenaAllocator(), otherwise NULL
+Arena* getAllocatorArena(const Allocator &allocator);
@@ -0,0 +1,236 @@
+#include "AssetCache.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // disable warning that fopen() is unsafe
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BakedMesh.h"
+#include "FileMapping.h"
+#include "Hash.h"
+#include "Threads.h"
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+static void createDirectory(const char* path)
+{
+    CreateDirectoryA(path, NULL); // Fails harmlessly if it already exists
+}
+
+static uint32_t getProcessId()
+{
+    return (uint32_t)GetCurrentProcessId();
+}
+
+// rename() on Windows fails if `newPath` exists
+static bool replaceFile(const char* oldPath, const char* newPath)
+{
+    return MoveFileExA(oldPath, newPath, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+#else
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void createDirectory(const char* path)
+{
+    mkdir(path, 0755); // Fails harmlessly if it already exists
+}
+
+static uint32_t getProcessId()
+{
+    return (uint32_t)getpid();
+}
+
+static bool replaceFile(const char* oldPath, const char* newPath)
+{
+    return rename(oldPath, newPath) == 0;
+}
+
+#endif
+
+#define ASSET_CACHE_MAX_PATH 1024
+
+// Everything besides the source file that changes what gets cached.
+// Zero-initialised so the padding hashes the same every time.
+struct AssetCacheKeyData
+{
+    uint32_t meshVersion;
+    uint32_t imageVersion;
+    uint32_t type;
+    uint32_t quantiseVertices;
+    uint64_t processObjKey;
+};
+
+uint64_t getAssetCacheKey(const AssetRequest &request, const void* sourceData, size_t sourceSize)
+{
+    AssetCacheKeyData keyData = {};
+    keyData.meshVersion = BAKED_MESH_VERSION;
+    keyData.imageVersion = ASSET_CACHE_IMAGE_VERSION;
+    keyData.type = request.type;
+    if(request.type == AssetType_OBJ) {
+        keyData.quantiseVertices = request.objOptions.quantiseVertices;
+        keyData.processObjKey = request.processObj ? request.processObjKey : 0;
+    }
+    return hashBytes64(&keyData, sizeof(keyData), hashBytes64(sourceData, sourceSize));
+}
+
+static bool getCachePath(const AssetRequest &request, uint64_t key, char* result)
+{
+    const char* extension = (request.type == AssetType_OBJ) ? "mesh" : "pixels";
+    int length = snprintf(result, ASSET_CACHE_MAX_PATH, "%s/%016llx.%s", request.cacheDirectory, (unsigned long long)key, extension);
+    return length > 0 && length < ASSET_CACHE_MAX_PATH;
+}
+
+// Unique per thread and process, so concurrent writers of the same entry
+// never share a temporary file
+static bool getTempPath(const char* path, char* result)
+{
+    static volatile uint32_t tempFileCounter = 0;
+    uint32_t counter = atomicIncrement(&tempFileCounter);
+    int length = snprintf(result, ASSET_CACHE_MAX_PATH, "%s.%u-%u.tmp", path, getProcessId(), counter);
+    return length > 0 && length < ASSET_CACHE_MAX_PATH;
+}
+
+static bool loadCachedObj(const char* path, const LoadObjOptions &options, LoadedObj* result)
+{
+    BakedMesh bakedMesh;
+    if(!loadBakedMesh(path, &bakedMesh))
+        return false;
+    if(!bakedMeshChecksumIsValid(bakedMesh)) {
+        unloadBakedMesh(&bakedMesh);
+        return false;
+    }
+
+    // The baked mesh points into the mapped file, copy it out so it can be
+    // freed like any other LoadedObj
+    const LoadedObj &baked = bakedMesh.obj;
+    LoadedObj obj = {};
+    obj.numVertices = baked.numVertices;
+    obj.numIndices = baked.numIndices;
+    obj.bytesPerIndex = baked.bytesPerIndex;
+    obj.numLods = baked.numLods;
+    memcpy(obj.lods, baked.lods, baked.numLods * sizeof(MeshLod));
+    obj.bounds = baked.bounds;
+    obj.numSubmeshes = baked.numSubmeshes;
+    obj.allocator = options.outputAllocator;
+
+    size_t vertexBufferSize = baked.numVertices * sizeof(VertexData);
+    size_t indexBufferSize = getTotalNumIndices(baked) * baked.bytesPerIndex;
+    size_t submeshesSize = baked.numSubmeshes * sizeof(Submesh);
+    obj.vertexBuffer = (VertexData*)allocatorAlloc(obj.allocator, vertexBufferSize);
+    obj.indexBuffer = allocatorAlloc(obj.allocator, indexBufferSize);
+    obj.submeshes = (Submesh*)allocatorAlloc(obj.allocator, submeshesSize);
+    assert((obj.vertexBuffer || vertexBufferSize == 0) && (obj.indexBuffer || indexBufferSize == 0) && (obj.submeshes || submeshesSize == 0));
+    memcpy(obj.vertexBuffer, baked.vertexBuffer, vertexBufferSize);
+    memcpy(obj.indexBuffer, baked.indexBuffer, indexBufferSize);
+    memcpy(obj.submeshes, baked.submeshes, submeshesSize);
+    unloadBakedMesh(&bakedMesh);
+
+    // Cheaper to redo than to store, and comes out exactly the same
+    if(options.quantiseVertices)
+        quantiseVertices(&obj);
+
+    *result = obj;
+    return true;
+}
+
+static bool loadCachedImage(const char* path, LoadedImage* result)
+{
+    MappedFile file;
+    if(!mapFile(path, &file))
+        return false;
+
+    const CachedImageHeader* header = (const CachedImageHeader*)file.data;
+    bool isValid = file.numBytes >= sizeof(CachedImageHeader)
+        && header->magic == ASSET_CACHE_IMAGE_MAGIC
+        && header->version == ASSET_CACHE_IMAGE_VERSION
+        && header->numChannels >= 1 && header->numChannels <= 4
+        && file.numBytes - sizeof(CachedImageHeader) == (uint64_t)header->width * header->height * header->numChannels;
+    const unsigned char* pixels = (const unsigned char*)file.data + sizeof(CachedImageHeader);
+    size_t numPixelBytes = file.numBytes - sizeof(CachedImageHeader);
+    isValid = isValid && hashBytes64(pixels, numPixelBytes) == header->checksum;
+
+    // NOTE: Allocated with malloc() to match stbi_load(), since they're
+    // both freed by freeLoadedImage()
+    unsigned char* resultPixels = isValid ? (unsigned char*)malloc(numPixelBytes) : NULL;
+    if(resultPixels) {
+        memcpy(resultPixels, pixels, numPixelBytes);
+        result->width = (int)header->width;
+        result->height = (int)header->height;
+        result->numChannels = (int)header->numChannels;
+        result->pixels = resultPixels;
+    }
+    unmapFile(&file);
+    return resultPixels != NULL;
+}
+
+bool loadCachedAsset(const AssetRequest &request, uint64_t key, LoadedAsset* result)
+{
+    char path[ASSET_CACHE_MAX_PATH];
+    if(!getCachePath(request, key, path))
+        return false;
+
+    *result = {};
+    result->type = request.type;
+    if(request.type == AssetType_OBJ)
+        return loadCachedObj(path, request.objOptions, &result->obj);
+    return loadCachedImage(path, &result->image);
+}
+
+static bool writeCachedImage(const char* path, const LoadedImage &image)
+{
+    CachedImageHeader header = {};
+    header.magic = ASSET_CACHE_IMAGE_MAGIC;
+    header.version = ASSET_CACHE_IMAGE_VERSION;
+    header.width = (uint32_t)image.width;
+    header.height = (uint32_t)image.height;
+    header.numChannels = (uint32_t)image.numChannels;
+    size_t numPixelBytes = (size_t)image.width * image.height * image.numChannels;
+    header.checksum = hashBytes64(image.pixels, numPixelBytes);
+
+    FILE* file = fopen(path, "wb");
+    if(!file)
+        return false;
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    success &= fwrite(image.pixels, numPixelBytes, 1, file) == 1 || numPixelBytes == 0;
+    success &= fclose(file) == 0;
+    return success;
+}
+
+bool storeCachedAsset(const AssetRequest &request, uint64_t key, const LoadedAsset &asset)
+{
+    // Don't cache failed loads, so fixing the file is picked up
+    if(asset.type == AssetType_IMAGE && !asset.image.pixels)
+        return false;
+
+    char path[ASSET_CACHE_MAX_PATH];
+    char tempPath[ASSET_CACHE_MAX_PATH];
+    if(!getCachePath(request, key, path) || !getTempPath(path, tempPath))
+        return false;
+    createDirectory(request.cacheDirectory);
+
+    bool success;
+    if(asset.type == AssetType_OBJ)
+        success = writeBakedMesh(tempPath, asset.obj);
+    else
+        success = writeCachedImage(tempPath, asset.image);
+    success = success && replaceFile(tempPath, path);
+    if(!success)
+        remove(tempPath);
+    return success;
+}
+
+#pragma warning(pop)
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AssetLoading.h"
+
+// On-disk cache of processed assets, so loading something a second time
+// skips parsing the .obj (and running AssetRequest::processObj) or
+// decoding the .png and just copies the finished buffers out of a file.
+//
+// Entries are named after a hash of the source file's contents combined
+// with everything that changes the output (the asset type, the load
+// options, AssetRequest::processObjKey and the cache format versions), so
+// editing an asset or changing how it's processed is just a miss and
+// nothing ever needs invalidating. Old entries are never deleted, it's
+// always safe to delete the whole directory.
+// Meshes are stored in the .mesh format (see BakedMesh.h), images as raw
+// RGBA pixels. New entries are written to a temporary file then renamed
+// into place, so other threads or processes loading the same asset only
+// ever see a complete entry or none at all.
+//
+// AssetLoading.cpp does all this when AssetRequest::cacheDirectory is set.
+//
+// Usage:
+// MappedFile sourceFile;
+// mapFile(request.filename, &sourceFile);
+// uint64_t key = getAssetCacheKey(request, sourceFile.data, sourceFile.numBytes);
+// LoadedAsset asset;
+// if(!loadCachedAsset(request, key, &asset)) {
+//     ... // Load and process asset from sourceFile
+//     storeCachedAsset(request, key, asset);
+// }
+// unmapFile(&sourceFile);
+
+#define ASSET_CACHE_IMAGE_MAGIC 0x58505249 // "IRPX"
+#define ASSET_CACHE_IMAGE_VERSION 1
+
+// Followed by width*height*numChannels bytes of pixels
+struct CachedImageHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t numChannels;
+    uint32_t pad;
+    uint64_t checksum; // Of the pixels
+};
+
+uint64_t getAssetCacheKey(const AssetRequest &request, const void* sourceData, size_t sourceSize);
+
+// Returns false on a miss, or if the entry is corrupt. Buffers are
+// allocated like a normal load would (LoadObjOptions::outputAllocator for
+// meshes, malloc() for images) and freed with freeLoadedAsset().
+bool loadCachedAsset(const AssetRequest &request, uint64_t key, LoadedAsset* result);
+
+// Creates request.cacheDirectory if it doesn't exist.
+// Returns false if the entry couldn't be written, loading still works without it.
+bool storeCachedAsset(const AssetRequest &request, uint64_t key, const LoadedAsset &asset);
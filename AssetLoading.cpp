@@ -0,0 +1,336 @@
+#include "AssetLoading.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "stb_image.h"
+#include "AssetCache.h"
+#include "FileMapping.h"
+#include "Threads.h"
+
+// Each worker repeatedly claims the next unclaimed asset by bumping
+// `nextAsset`, so a worker that finishes a small asset goes straight on
+// to the next one instead of waiting on a fixed share of the batch.
+// waitForAsset() claims assets the same way, so the calling thread is
+// never idle while there's work left to do.
+
+// Always expand to RGBA, see d3d11CreateTexture()
+#define LOADED_IMAGE_NUM_CHANNELS 4
+
+enum AssetState
+{
+    AssetState_QUEUED,
+    AssetState_LOADING,
+    AssetState_LOADED
+};
+
+struct AssetBatch
+{
+    uint32_t numAssets;
+    AssetRequest* requests;
+    LoadedAsset* assets;
+    volatile uint32_t* states; // AssetState for each asset
+
+    volatile uint32_t nextAsset; // Next asset to claim, can go past numAssets
+
+    uint32_t numThreads;
+    Thread* threads;
+};
+
+void freeLoadedImage(LoadedImage image)
+{
+    stbi_image_free(image.pixels);
+}
+
+void freeLoadedAsset(LoadedAsset asset)
+{
+    if(asset.type == AssetType_OBJ)
+        freeLoadedObj(asset.obj);
+    else
+        freeLoadedImage(asset.image);
+}
+
+static void loadAssetFromMemory(const AssetRequest &request, const void* data, size_t numBytes, LoadedAsset* asset)
+{
+    asset->type = request.type;
+    switch(request.type)
+    {
+        case AssetType_OBJ:
+        {
+            const char* begin = (const char*)data;
+            asset->obj = loadObjFromMemory(begin, begin + numBytes, request.objOptions);
+            if(request.processObj)
+                request.processObj(&asset->obj, request.processObjUserData);
+            break;
+        }
+        case AssetType_IMAGE:
+        {
+            int fileNumChannels;
+            LoadedImage* image = &asset->image;
+            image->pixels = stbi_load_from_memory((const stbi_uc*)data, (int)numBytes, &image->width, &image->height, &fileNumChannels, LOADED_IMAGE_NUM_CHANNELS);
+            image->numChannels = LOADED_IMAGE_NUM_CHANNELS;
+            break;
+        }
+        default: assert(false);
+    }
+}
+
+static void loadAsset(const AssetRequest &request, LoadedAsset* asset)
+{
+    // There's no telling what a processObj without a key does
+    bool useCache = request.cacheDirectory && (request.type != AssetType_OBJ || !request.processObj || request.processObjKey != 0);
+
+    // Cached or not, the whole source file is read to hash it
+    MappedFile sourceFile;
+    if(useCache && mapFile(request.filename, &sourceFile))
+    {
+        uint64_t key = getAssetCacheKey(request, sourceFile.data, sourceFile.numBytes);
+        if(!loadCachedAsset(request, key, asset)) {
+            loadAssetFromMemory(request, sourceFile.data, sourceFile.numBytes, asset);
+            storeCachedAsset(request, key, *asset);
+        }
+        unmapFile(&sourceFile);
+        return;
+    }
+
+    asset->type = request.type;
+    switch(request.type)
+    {
+        case AssetType_OBJ:
+        {
+            asset->obj = loadObj(request.filename, request.objOptions);
+            if(request.processObj)
+                request.processObj(&asset->obj, request.processObjUserData);
+            break;
+        }
+        case AssetType_IMAGE:
+        {
+            int fileNumChannels;
+            LoadedImage* image = &asset->image;
+            image->pixels = stbi_load(request.filename, &image->width, &image->height, &fileNumChannels, LOADED_IMAGE_NUM_CHANNELS);
+            image->numChannels = LOADED_IMAGE_NUM_CHANNELS;
+            break;
+        }
+        default: assert(false);
+    }
+}
+
+// Loads the next unclaimed asset, returns false if there are none left
+static bool loadNextAsset(AssetBatch* batch)
+{
+    // Check first so waiting threads don't keep bumping nextAsset
+    if(atomicLoad(&batch->nextAsset) >= batch->numAssets)
+        return false;
+    uint32_t index = atomicIncrement(&batch->nextAsset) - 1;
+    if(index >= batch->numAssets)
+        return false;
+
+    atomicStore(batch->states + index, AssetState_LOADING);
+    loadAsset(batch->requests[index], batch->assets + index);
+    atomicStore(batch->states + index, AssetState_LOADED);
+    return true;
+}
+
+static void assetWorkerProc(void* userData)
+{
+    AssetBatch* batch = (AssetBatch*)userData;
+    while(loadNextAsset(batch))
+        ;
+}
+
+AssetBatch* beginAssetBatch(const AssetRequest* requests, uint32_t numRequests, uint32_t numThreads)
+{
+    AssetBatch* batch = (AssetBatch*)calloc(1, sizeof(AssetBatch));
+    assert(batch);
+    batch->numAssets = numRequests;
+    batch->requests = (AssetRequest*)malloc(numRequests * sizeof(AssetRequest));
+    batch->assets = (LoadedAsset*)calloc(numRequests, sizeof(LoadedAsset));
+    batch->states = (volatile uint32_t*)calloc(numRequests, sizeof(uint32_t));
+    assert((batch->requests && batch->assets && batch->states) || numRequests == 0);
+    for(uint32_t i=0; i<numRequests; ++i)
+        batch->requests[i] = requests[i];
+
+#ifndef NDEBUG
+    // Requests load at the same time, so they can't share arenas, see AssetRequest::objOptions
+    for(uint32_t i=0; i<numRequests; ++i)
+    {
+        Arena* scratchArenaA = requests[i].objOptions.scratchArena;
+        Arena* outputArenaA = getAllocatorArena(requests[i].objOptions.outputAllocator);
+        for(uint32_t j=i+1; j<numRequests; ++j)
+        {
+            Arena* scratchArenaB = requests[j].objOptions.scratchArena;
+            Arena* outputArenaB = getAllocatorArena(requests[j].objOptions.outputAllocator);
+            assert(!scratchArenaA || (scratchArenaA != scratchArenaB && scratchArenaA != outputArenaB));
+            assert(!outputArenaA || (outputArenaA != outputArenaB && outputArenaA != scratchArenaB));
+        }
+    }
+#endif
+
+    // No point having more workers than assets
+    batch->numThreads = (numThreads < numRequests) ? numThreads : numRequests;
+    batch->threads = (Thread*)malloc(batch->numThreads * sizeof(Thread));
+    assert(batch->threads || batch->numThreads == 0);
+    for(uint32_t i=0; i<batch->numThreads; ++i)
+        batch->threads[i] = threadCreate(assetWorkerProc, batch);
+
+    return batch;
+}
+
+bool isAssetLoaded(AssetBatch* batch, uint32_t index)
+{
+    assert(index < batch->numAssets);
+    return atomicLoad(batch->states + index) == AssetState_LOADED;
+}
+
+const LoadedAsset* waitForAsset(AssetBatch* batch, uint32_t index)
+{
+    assert(index < batch->numAssets);
+    while(!isAssetLoaded(batch, index))
+    {
+        // Help out until there's nothing left to claim,
+        // then wait for whichever worker has our asset
+        if(!loadNextAsset(batch))
+            threadYield();
+    }
+    return batch->assets + index;
+}
+
+void endAssetBatch(AssetBatch* batch)
+{
+    while(loadNextAsset(batch))
+        ;
+    for(uint32_t i=0; i<batch->numThreads; ++i)
+        threadJoin(batch->threads[i]);
+
+    free(batch->threads);
+    free((void*)batch->states);
+    free(batch->assets);
+    free(batch->requests);
+    free(batch);
+}
+
+// Asset streaming
+
+// Single producer, single consumer ring buffer. Only the producer writes
+// `head` and only the consumer writes `tail`, they count pushes and pops
+// and wrap around naturally so a full queue can use every slot.
+struct AssetStreamRequest
+{
+    AssetRequest request;
+    uint32_t id;
+};
+
+struct AssetStreamResult
+{
+    LoadedAsset asset;
+    uint32_t id;
+};
+
+struct AssetStreamer
+{
+    AssetStreamRequest requests[ASSET_STREAM_QUEUE_SIZE];
+    volatile uint32_t requestsHead;
+    volatile uint32_t requestsTail;
+
+    AssetStreamResult results[ASSET_STREAM_QUEUE_SIZE];
+    volatile uint32_t resultsHead;
+    volatile uint32_t resultsTail;
+
+    // Signalled once per request, and once more to quit
+    Semaphore wakeLoader;
+    volatile uint32_t quit;
+    Thread loaderThread;
+};
+
+static void assetStreamerThreadProc(void* userData)
+{
+    AssetStreamer* streamer = (AssetStreamer*)userData;
+    while(true)
+    {
+        semaphoreWait(streamer->wakeLoader);
+        if(atomicLoad(&streamer->quit))
+            return;
+
+        uint32_t tail = streamer->requestsTail;
+        assert(atomicLoad(&streamer->requestsHead) != tail);
+        AssetStreamRequest request = streamer->requests[tail & (ASSET_STREAM_QUEUE_SIZE - 1)];
+        atomicStore(&streamer->requestsTail, tail + 1);
+
+        AssetStreamResult result = {};
+        result.id = request.id;
+        loadAsset(request.request, &result.asset);
+
+        // Wait for the main thread to make room for the result
+        uint32_t head = streamer->resultsHead;
+        while(head - atomicLoad(&streamer->resultsTail) == ASSET_STREAM_QUEUE_SIZE)
+        {
+            if(atomicLoad(&streamer->quit)) {
+                freeLoadedAsset(result.asset);
+                return;
+            }
+            threadYield();
+        }
+        streamer->results[head & (ASSET_STREAM_QUEUE_SIZE - 1)] = result;
+        atomicStore(&streamer->resultsHead, head + 1);
+    }
+}
+
+AssetStreamer* createAssetStreamer()
+{
+    AssetStreamer* streamer = (AssetStreamer*)calloc(1, sizeof(AssetStreamer));
+    assert(streamer);
+    streamer->wakeLoader = semaphoreCreate(0);
+    streamer->loaderThread = threadCreate(assetStreamerThreadProc, streamer);
+    return streamer;
+}
+
+void destroyAssetStreamer(AssetStreamer* streamer)
+{
+    atomicStore(&streamer->quit, 1);
+    semaphoreSignal(streamer->wakeLoader);
+    threadJoin(streamer->loaderThread);
+    semaphoreDestroy(streamer->wakeLoader);
+
+    uint32_t id;
+    LoadedAsset asset;
+    while(popStreamedAsset(streamer, &id, &asset))
+        freeLoadedAsset(asset);
+    free(streamer);
+}
+
+bool requestAssetStream(AssetStreamer* streamer, const AssetRequest &request, uint32_t id)
+{
+    uint32_t head = streamer->requestsHead;
+    if(head - atomicLoad(&streamer->requestsTail) == ASSET_STREAM_QUEUE_SIZE)
+        return false;
+
+    AssetStreamRequest* slot = streamer->requests + (head & (ASSET_STREAM_QUEUE_SIZE - 1));
+    slot->request = request;
+    slot->id = id;
+    atomicStore(&streamer->requestsHead, head + 1);
+    semaphoreSignal(streamer->wakeLoader);
+    return true;
+}
+
+bool popStreamedAsset(AssetStreamer* streamer, uint32_t* id, LoadedAsset* asset)
+{
+    uint32_t tail = streamer->resultsTail;
+    if(atomicLoad(&streamer->resultsHead) == tail)
+        return false;
+
+    const AssetStreamResult* slot = streamer->results + (tail & (ASSET_STREAM_QUEUE_SIZE - 1));
+    *id = slot->id;
+    *asset = slot->asset;
+    atomicStore(&streamer->resultsTail, tail + 1);
+    return true;
+}
+
+size_t getAssetUploadSize(const LoadedAsset &asset)
+{
+    if(asset.type == AssetType_IMAGE)
+        return (size_t)asset.image.width * asset.image.height * asset.image.numChannels;
+
+    const LoadedObj &obj = asset.obj;
+    size_t vertexSize = obj.quantisedVertexBuffer ? sizeof(QuantisedVertexData) : sizeof(VertexData);
+    return obj.numVertices * vertexSize + getTotalNumIndices(obj) * obj.bytesPerIndex;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ObjLoading.h"
+
+// Loads a batch of assets in parallel on a pool of worker threads, so
+// startup takes about as long as the slowest asset rather than the sum
+// of all of them. Only the CPU side of loading happens here: creating the
+// D3D11 resources still has to be done on the thread that owns the
+// device context, once each asset is ready.
+//
+// Usage:
+// AssetRequest requests[2] = {};
+// requests[0].type = AssetType_OBJ;
+// requests[0].filename = "test.obj";
+// requests[1].type = AssetType_IMAGE;
+// requests[1].filename = "test.png";
+// AssetBatch* batch = beginAssetBatch(requests, 2, getNumLogicalCores());
+// ... // Do other startup work, poll isAssetLoaded(batch, 0) etc.
+// LoadedObj myObj = waitForAsset(batch, 0)->obj;
+// LoadedImage myImage = waitForAsset(batch, 1)->image;
+// endAssetBatch(batch);
+// ... // Send to GPU
+// freeLoadedObj(myObj);
+// freeLoadedImage(myImage);
+
+enum AssetType
+{
+    AssetType_OBJ,
+    AssetType_IMAGE
+};
+
+// Run on the worker thread straight after an .obj is loaded, so expensive
+// processing (e.g. generateLods(), buildMeshlets()) is spread over the
+// workers too. It must only touch `obj` and its own userData.
+typedef void ObjProcessProc(LoadedObj* obj, void* userData);
+
+struct AssetRequest
+{
+    AssetType type;
+    const char* filename; // Must stay valid until the asset is loaded
+
+    // Optional, see AssetCache.h. Cached assets load straight from this
+    // directory the next time they're requested.
+    const char* cacheDirectory;
+
+    // AssetType_OBJ only
+    // NOTE: Arenas aren't thread-safe. Requests in a batch load at the same
+    // time on different workers, so each one needs its own scratchArena and
+    // arena outputAllocator, beginAssetBatch() asserts that they aren't
+    // shared. A streamer loads one request at a time, so its requests can
+    // share arenas, but nothing else can use them until they've all loaded.
+    LoadObjOptions objOptions;
+    ObjProcessProc* processObj; // Optional
+    void* processObjUserData;
+    // Identifies what processObj does to the mesh, including any settings it
+    // uses, so change it whenever they change. processObj doesn't run on a
+    // cache hit, so requests with a processObj are only cached if this is
+    // set, and processObj must only touch `obj` (not its userData).
+    uint64_t processObjKey;
+};
+
+// 8 bits per channel image, see stbi_load()
+struct LoadedImage
+{
+    int width, height;
+    int numChannels;
+    unsigned char* pixels; // NULL if the image couldn't be loaded
+};
+
+void freeLoadedImage(LoadedImage image);
+
+struct LoadedAsset
+{
+    AssetType type;
+    LoadedObj obj; // AssetType_OBJ
+    LoadedImage image; // AssetType_IMAGE
+};
+
+void freeLoadedAsset(LoadedAsset asset);
+
+struct AssetBatch;
+
+// Starts loading `requests` (which are copied) on `numThreads` worker
+// threads, in order. Put the slowest assets first so they start
+// straight away. Passing 0 threads means assets only get loaded by
+// waitForAsset(), on the calling thread.
+AssetBatch* beginAssetBatch(const AssetRequest* requests, uint32_t numRequests, uint32_t numThreads);
+
+// `index` is the asset's index in the requests passed to beginAssetBatch()
+bool isAssetLoaded(AssetBatch* batch, uint32_t index);
+
+// Blocks until requests[index] is loaded. Rather than sit idle the calling
+// thread loads any assets the workers haven't started yet while it waits.
+// The result is owned by the caller but lives in the batch, so copy it
+// out before calling endAssetBatch().
+const LoadedAsset* waitForAsset(AssetBatch* batch, uint32_t index);
+
+// Waits for everything in the batch to load then frees the batch,
+// but not the loaded assets.
+void endAssetBatch(AssetBatch* batch);
+
+// Streams assets in while the game is running, on a single background
+// thread so it doesn't compete with the main thread for cores.
+// Requests and results are passed through lock-free single producer,
+// single consumer queues, so the main thread never waits on the loader.
+//
+// Usage:
+// AssetStreamer* streamer = createAssetStreamer();
+// Texture myTexture = placeholderTexture;
+// requestAssetStream(streamer, myImageRequest, MY_TEXTURE_ID);
+// ... // Each frame:
+// uint32_t id;
+// LoadedAsset asset;
+// while(uploadBudget > 0 && popStreamedAsset(streamer, &id, &asset)) {
+//     ... // Create GPU resources for `asset` and free it
+//     uploadBudget -= getAssetUploadSize(asset);
+// }
+// ...
+// destroyAssetStreamer(streamer);
+
+// Must be a power of two
+#define ASSET_STREAM_QUEUE_SIZE 64
+
+struct AssetStreamer;
+
+AssetStreamer* createAssetStreamer();
+// Stops the loader thread once it finishes the asset it's loading, if any.
+// Requests it hasn't started are dropped and results that haven't been
+// popped are freed.
+void destroyAssetStreamer(AssetStreamer* streamer);
+
+// Queues `request` to be loaded in the background. `id` is passed back
+// with the result to tell the caller which asset it is.
+// Returns false if the queue is full, try again next frame.
+// NOTE: Only call this from one thread (e.g. the main thread)
+bool requestAssetStream(AssetStreamer* streamer, const AssetRequest &request, uint32_t id);
+
+// Takes the next finished asset, returns false if none are ready yet.
+// The caller owns the result.
+// NOTE: Only call this from one thread (e.g. the main thread)
+bool popStreamedAsset(AssetStreamer* streamer, uint32_t* id, LoadedAsset* asset);
+
+// Number of bytes that will be sent to the GPU for `asset`, for
+// spreading uploads over several frames
+size_t getAssetUploadSize(const LoadedAsset &asset);
@@ -0,0 +1,116 @@
+#include "BakedCollider.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // disable warning that fopen() is unsafe
+
+#include <stdio.h>
+#include <stdlib.h> // calloc()
+#include <string.h> // memcpy()
+
+#include "Hash.h"
+
+// Same as alignUp() in BakedMesh.cpp, named differently for the jumbo build
+static uint32_t alignColliderOffset(uint32_t x, uint32_t alignment)
+{
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+bool writeBakedCollider(const char* filename, const ColliderPolyhedron &collider)
+{
+    BakedColliderHeader header = {};
+    header.magic = BAKED_COLLIDER_MAGIC;
+    header.version = BAKED_COLLIDER_VERSION;
+    header.headerSize = sizeof(BakedColliderHeader);
+    header.numVertices = collider.numVertices;
+    header.numPlanes = collider.numPlanes;
+    header.numEdges = collider.numEdges;
+    header.numEdgeDirections = collider.numEdgeDirections;
+    header.verticesOffset = alignColliderOffset(sizeof(BakedColliderHeader), 16);
+    header.planesOffset = alignColliderOffset(header.verticesOffset + collider.numVertices * sizeof(vec4), 16);
+    header.edgesOffset = alignColliderOffset(header.planesOffset + collider.numPlanes * sizeof(Plane), 16);
+    header.edgeDirectionsOffset = alignColliderOffset(header.edgesOffset + collider.numEdges * sizeof(Edge), 16);
+    header.fileSize = header.edgeDirectionsOffset + collider.numEdgeDirections * sizeof(vec3);
+    header.centroid = collider.centroid;
+    header.boundingSphereCenter = collider.boundingSphereCenter;
+    header.boundingSphereRadius = collider.boundingSphereRadius;
+
+    // Build the data section in memory so we can checksum it
+    size_t dataSize = (size_t)(header.fileSize - header.verticesOffset);
+    unsigned char* data = (unsigned char*)calloc(dataSize, 1);
+    if(!data)
+        return false;
+    memcpy(data, collider.vertices, collider.numVertices * sizeof(vec4));
+    memcpy(data + (header.planesOffset - header.verticesOffset), collider.planes, collider.numPlanes * sizeof(Plane));
+    memcpy(data + (header.edgesOffset - header.verticesOffset), collider.edges, collider.numEdges * sizeof(Edge));
+    memcpy(data + (header.edgeDirectionsOffset - header.verticesOffset), collider.edgeDirections, collider.numEdgeDirections * sizeof(vec3));
+    header.checksum = hashBytes64(data, dataSize);
+
+    unsigned char padding[16] = {};
+    FILE* file = fopen(filename, "wb");
+    bool success = (file != NULL);
+    if(success) {
+        success &= fwrite(&header, sizeof(header), 1, file) == 1;
+        success &= fwrite(padding, header.verticesOffset - sizeof(header), 1, file) == 1 || header.verticesOffset == sizeof(header);
+        success &= fwrite(data, dataSize, 1, file) == 1 || dataSize == 0;
+        success &= fclose(file) == 0;
+    }
+    free(data);
+    return success;
+}
+
+bool loadBakedCollider(const char* filename, BakedCollider* result)
+{
+    *result = {};
+    if(!mapFile(filename, &result->file))
+        return false;
+
+    const BakedColliderHeader* header = (const BakedColliderHeader*)result->file.data;
+    bool isValid = result->file.numBytes >= sizeof(BakedColliderHeader)
+        && header->magic == BAKED_COLLIDER_MAGIC
+        && header->version == BAKED_COLLIDER_VERSION
+        && header->headerSize == sizeof(BakedColliderHeader)
+        && header->fileSize == result->file.numBytes
+        && header->verticesOffset >= sizeof(BakedColliderHeader)
+        && (uint64_t)header->verticesOffset + (uint64_t)header->numVertices * sizeof(vec4) <= header->planesOffset
+        && (uint64_t)header->planesOffset + (uint64_t)header->numPlanes * sizeof(Plane) <= header->edgesOffset
+        && (uint64_t)header->edgesOffset + (uint64_t)header->numEdges * sizeof(Edge) <= header->edgeDirectionsOffset
+        && (uint64_t)header->edgeDirectionsOffset + (uint64_t)header->numEdgeDirections * sizeof(vec3) <= header->fileSize
+        && header->verticesOffset % 4 == 0 && header->planesOffset % 4 == 0
+        && header->edgesOffset % 4 == 0 && header->edgeDirectionsOffset % 4 == 0;
+    if(!isValid) {
+        unmapFile(&result->file);
+        *result = {};
+        return false;
+    }
+
+    const char* fileBytes = (const char*)result->file.data;
+    result->header = header;
+    ColliderPolyhedron* collider = &result->collider;
+    collider->numVertices = header->numVertices;
+    collider->vertices = (vec4*)(fileBytes + header->verticesOffset);
+    collider->numPlanes = header->numPlanes;
+    collider->planes = (Plane*)(fileBytes + header->planesOffset);
+    collider->numEdges = header->numEdges;
+    collider->edges = (Edge*)(fileBytes + header->edgesOffset);
+    collider->numEdgeDirections = header->numEdgeDirections;
+    collider->edgeDirections = (vec3*)(fileBytes + header->edgeDirectionsOffset);
+    collider->centroid = header->centroid;
+    collider->boundingSphereCenter = header->boundingSphereCenter;
+    collider->boundingSphereRadius = header->boundingSphereRadius;
+    return true;
+}
+
+bool bakedColliderChecksumIsValid(const BakedCollider &collider)
+{
+    const char* fileBytes = (const char*)collider.file.data;
+    size_t dataSize = (size_t)(collider.header->fileSize - collider.header->verticesOffset);
+    return hashBytes64(fileBytes + collider.header->verticesOffset, dataSize) == collider.header->checksum;
+}
+
+void unloadBakedCollider(BakedCollider* collider)
+{
+    unmapFile(&collider->file);
+    *collider = {};
+}
+
+#pragma warning(pop)
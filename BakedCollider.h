@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include "Collision.h"
+#include "FileMapping.h"
+
+// Binary format storing a finished ColliderPolyhedron, so colliders can be
+// memory-mapped and used straight away rather than built from the render
+// mesh at load time. Use tools/colliderbake to convert .obj files.
+//
+// Layout (little-endian):
+//   BakedColliderHeader
+//   vec4[numVertices]                  at header.verticesOffset
+//   Plane[numPlanes]                   at header.planesOffset
+//   Edge[numEdges]                     at header.edgesOffset
+//   vec3[numEdgeDirections]            at header.edgeDirectionsOffset
+//
+// The checksum covers everything after the header.
+//
+// Usage:
+// BakedCollider baked;
+// if(loadBakedCollider("test.collider", &baked)) {
+//     ColliderPolyhedron collider = baked.collider;
+//     setColliderTransform(&collider, modelMat, normalMat);
+//     updateColliderWorldSpace(&collider);
+//     ...
+//     freeColliderWorldSpace(&collider);
+//     unloadBakedCollider(&baked);
+// }
+
+#define BAKED_COLLIDER_MAGIC 0x4c4c4f43 // "COLL"
+#define BAKED_COLLIDER_VERSION 1
+
+struct BakedColliderHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t numVertices;
+    uint32_t numPlanes;
+    uint32_t numEdges;
+    uint32_t numEdgeDirections;
+    uint32_t verticesOffset;
+    uint32_t planesOffset;
+    uint32_t edgesOffset;
+    uint32_t edgeDirectionsOffset;
+    uint32_t pad;
+    uint64_t fileSize;
+    uint64_t checksum;
+    vec3 centroid;
+    vec3 boundingSphereCenter;
+    float boundingSphereRadius;
+};
+
+struct BakedCollider
+{
+    MappedFile file;
+    const BakedColliderHeader* header;
+
+    // Points into the mapped file, don't write to its arrays.
+    // Copy it and give the copy a transform with setColliderTransform().
+    ColliderPolyhedron collider;
+};
+
+bool writeBakedCollider(const char* filename, const ColliderPolyhedron &collider);
+
+// Maps `filename` and validates its header, the arrays are used as they are
+// in the file without looking at them. Call bakedColliderChecksumIsValid()
+// to check for corruption.
+bool loadBakedCollider(const char* filename, BakedCollider* result);
+bool bakedColliderChecksumIsValid(const BakedCollider &collider);
+void unloadBakedCollider(BakedCollider* collider);
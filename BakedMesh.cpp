@@ -0,0 +1,209 @@
+#include "BakedMesh.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // disable warning that fopen() is unsafe
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h> // calloc()
+#include <string.h> // memcpy()
+
+#include "Hash.h"
+#include "MeshCompression.h"
+
+static uint32_t alignUp(uint32_t x, uint32_t alignment)
+{
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+bool writeBakedMesh(const char* filename, const LoadedObj &obj, bool compress)
+{
+    BakedMeshHeader header = {};
+    header.magic = BAKED_MESH_MAGIC;
+    header.version = BAKED_MESH_VERSION;
+    header.headerSize = sizeof(BakedMeshHeader);
+    header.numVertices = obj.numVertices;
+    header.numIndices = obj.numIndices;
+    header.bytesPerIndex = obj.bytesPerIndex;
+    header.flags = compress ? BAKED_MESH_COMPRESSED : 0;
+    if(obj.numLods == 0) {
+        header.numLods = 1;
+        header.lods[0] = { 0, obj.numIndices, 0.f };
+    }
+    else {
+        header.numLods = obj.numLods;
+        memcpy(header.lods, obj.lods, obj.numLods * sizeof(MeshLod));
+    }
+
+    // Contents of each section, either the buffers themselves or their encodings
+    const void* vertexData = obj.vertexBuffer;
+    const void* indexData = obj.indexBuffer;
+    uint32_t totalNumIndices = getTotalNumIndices(obj);
+    uint8_t* encodedVertices = NULL;
+    uint8_t* encodedIndices = NULL;
+    if(compress) {
+        size_t vertexBound = getVertexBufferEncodeBound(obj.numVertices, sizeof(VertexData));
+        size_t indexBound = getIndexBufferEncodeBound(totalNumIndices);
+        encodedVertices = (uint8_t*)malloc(vertexBound);
+        encodedIndices = (uint8_t*)malloc(indexBound);
+        if(!encodedVertices || !encodedIndices) {
+            free(encodedVertices);
+            free(encodedIndices);
+            return false;
+        }
+        header.vertexDataSize = (uint32_t)encodeVertexBuffer(encodedVertices, vertexBound, obj.vertexBuffer, obj.numVertices, sizeof(VertexData));
+        header.indexDataSize = (uint32_t)encodeIndexBuffer(encodedIndices, indexBound, obj.indexBuffer, totalNumIndices, obj.bytesPerIndex);
+        vertexData = encodedVertices;
+        indexData = encodedIndices;
+    }
+    else {
+        header.vertexDataSize = obj.numVertices * sizeof(VertexData);
+        header.indexDataSize = totalNumIndices * obj.bytesPerIndex;
+    }
+    header.vertexDataOffset = alignUp(sizeof(BakedMeshHeader), 16);
+    header.indexDataOffset = alignUp(header.vertexDataOffset + header.vertexDataSize, 16);
+    header.numSubmeshes = obj.numSubmeshes;
+    header.submeshDataOffset = alignUp(header.indexDataOffset + header.indexDataSize, 16);
+    header.fileSize = header.submeshDataOffset + obj.numSubmeshes * sizeof(Submesh);
+
+    header.bounds = obj.bounds;
+
+    // Build the data section in memory so we can checksum it
+    size_t dataSize = (size_t)(header.fileSize - header.vertexDataOffset);
+    unsigned char* data = (unsigned char*)calloc(dataSize, 1);
+    if(data) {
+        memcpy(data, vertexData, header.vertexDataSize);
+        memcpy(data + (header.indexDataOffset - header.vertexDataOffset), indexData, header.indexDataSize);
+        memcpy(data + (header.submeshDataOffset - header.vertexDataOffset), obj.submeshes, obj.numSubmeshes * sizeof(Submesh));
+        header.checksum = hashBytes64(data, dataSize);
+    }
+    free(encodedVertices);
+    free(encodedIndices);
+    if(!data)
+        return false;
+
+    unsigned char padding[16] = {};
+    FILE* file = fopen(filename, "wb");
+    bool success = (file != NULL);
+    if(success) {
+        success &= fwrite(&header, sizeof(header), 1, file) == 1;
+        success &= fwrite(padding, header.vertexDataOffset - sizeof(header), 1, file) == 1 || header.vertexDataOffset == sizeof(header);
+        success &= fwrite(data, dataSize, 1, file) == 1 || dataSize == 0;
+        success &= fclose(file) == 0;
+    }
+    free(data);
+    return success;
+}
+
+bool loadBakedMesh(const char* filename, BakedMesh* result)
+{
+    *result = {};
+    if(!mapFile(filename, &result->file))
+        return false;
+
+    const BakedMeshHeader* header = (const BakedMeshHeader*)result->file.data;
+    bool isValid = result->file.numBytes >= sizeof(BakedMeshHeader)
+        && header->magic == BAKED_MESH_MAGIC
+        && header->version == BAKED_MESH_VERSION
+        && header->headerSize == sizeof(BakedMeshHeader)
+        && header->fileSize == result->file.numBytes
+        && (header->flags & ~BAKED_MESH_COMPRESSED) == 0
+        && (header->bytesPerIndex == 2 || header->bytesPerIndex == 4)
+        && header->vertexDataOffset >= sizeof(BakedMeshHeader)
+        && (uint64_t)header->vertexDataOffset + header->vertexDataSize <= header->indexDataOffset
+        && (uint64_t)header->indexDataOffset + header->indexDataSize <= header->submeshDataOffset
+        && header->submeshDataOffset % 4 == 0
+        && (uint64_t)header->submeshDataOffset + (uint64_t)header->numSubmeshes * sizeof(Submesh) <= header->fileSize
+        && header->numLods >= 1 && header->numLods <= MAX_MESH_LODS
+        && header->lods[0].firstIndex == 0 && header->lods[0].numIndices == header->numIndices;
+    // Each level has to fit in the index buffer
+    uint64_t totalNumIndices = 0;
+    for(uint32_t i=0; isValid && i<header->numLods; ++i) {
+        uint64_t lodEnd = (uint64_t)header->lods[i].firstIndex + header->lods[i].numIndices;
+        totalNumIndices = CLAMP_ABOVE(totalNumIndices, lodEnd);
+    }
+    // Submeshes have to cover the full mesh in order, with terminated names
+    // Only look at the rest of the header once we know it's all there
+    const char* fileBytes = (const char*)result->file.data;
+    const Submesh* submeshes = NULL;
+    bool isCompressed = false;
+    if(isValid) {
+        submeshes = (const Submesh*)(fileBytes + header->submeshDataOffset);
+        isCompressed = (header->flags & BAKED_MESH_COMPRESSED) != 0;
+    }
+    uint32_t numSubmeshIndices = 0;
+    for(uint32_t i=0; isValid && i<header->numSubmeshes; ++i) {
+        const Submesh &submesh = submeshes[i];
+        isValid = submesh.firstIndex == numSubmeshIndices && submesh.numIndices <= header->numIndices - numSubmeshIndices
+            && submesh.objectName[SUBMESH_MAX_NAME_LENGTH-1] == '\0'
+            && submesh.groupName[SUBMESH_MAX_NAME_LENGTH-1] == '\0'
+            && submesh.materialName[SUBMESH_MAX_NAME_LENGTH-1] == '\0';
+        numSubmeshIndices += submesh.numIndices;
+    }
+    isValid = isValid && (header->numSubmeshes == 0 || numSubmeshIndices == header->numIndices);
+    if(isValid && !isCompressed) {
+        isValid = header->vertexDataSize == (uint64_t)header->numVertices * sizeof(VertexData)
+            && totalNumIndices * header->bytesPerIndex <= header->indexDataSize;
+    }
+    if(!isValid) {
+        unmapFile(&result->file);
+        *result = {};
+        return false;
+    }
+
+    result->header = header;
+    result->obj.numVertices = header->numVertices;
+    result->obj.numIndices = header->numIndices;
+    result->obj.bytesPerIndex = header->bytesPerIndex;
+    result->obj.numLods = header->numLods;
+    result->obj.bounds = header->bounds;
+    result->obj.numSubmeshes = header->numSubmeshes;
+    result->obj.submeshes = (Submesh*)submeshes;
+    memcpy(result->obj.lods, header->lods, header->numLods * sizeof(MeshLod));
+
+    if(isCompressed)
+    {
+        size_t vertexBufferSize = (size_t)header->numVertices * sizeof(VertexData);
+        // Round up so the index buffer stays aligned
+        size_t indexBufferOffset = (vertexBufferSize + 15) & ~(size_t)15;
+        // The encoded index data covers every level of detail
+        uint32_t numEncodedIndices = (uint32_t)totalNumIndices;
+        result->decodedData = malloc(indexBufferOffset + (size_t)numEncodedIndices * header->bytesPerIndex);
+        bool decoded = result->decodedData != NULL;
+        if(decoded) {
+            result->obj.vertexBuffer = (VertexData*)result->decodedData;
+            result->obj.indexBuffer = (char*)result->decodedData + indexBufferOffset;
+            decoded = decodeVertexBuffer(result->obj.vertexBuffer, header->numVertices, sizeof(VertexData),
+                    (const uint8_t*)fileBytes + header->vertexDataOffset, header->vertexDataSize)
+                && decodeIndexBuffer(result->obj.indexBuffer, numEncodedIndices, header->bytesPerIndex,
+                    (const uint8_t*)fileBytes + header->indexDataOffset, header->indexDataSize);
+        }
+        if(!decoded) {
+            unloadBakedMesh(result);
+            return false;
+        }
+    }
+    else
+    {
+        result->obj.vertexBuffer = (VertexData*)(fileBytes + header->vertexDataOffset);
+        result->obj.indexBuffer = (void*)(fileBytes + header->indexDataOffset);
+    }
+
+    return true;
+}
+
+bool bakedMeshChecksumIsValid(const BakedMesh &mesh)
+{
+    const char* fileBytes = (const char*)mesh.file.data;
+    size_t dataSize = (size_t)(mesh.header->fileSize - mesh.header->vertexDataOffset);
+    return hashBytes64(fileBytes + mesh.header->vertexDataOffset, dataSize) == mesh.header->checksum;
+}
+
+void unloadBakedMesh(BakedMesh* mesh)
+{
+    free(mesh->decodedData);
+    unmapFile(&mesh->file);
+    *mesh = {};
+}
+
+#pragma warning(pop)
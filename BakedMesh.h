@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include "3DMaths.h"
+#include "FileMapping.h"
+#include "ObjLoading.h"
+
+// Binary mesh format storing the final vertex and index buffers produced
+// by loadObj(), so they can be memory-mapped and handed straight to the
+// GPU without any parsing. Use tools/objbake to convert .obj files.
+//
+// Layout (little-endian):
+//   BakedMeshHeader
+//   VertexData[numVertices]            at header.vertexDataOffset
+//   uint16_t/uint32_t[...]             at header.indexDataOffset, every level
+//                                      of detail in header.lods back to back
+//   Submesh[numSubmeshes]              at header.submeshDataOffset
+//
+// If BAKED_MESH_COMPRESSED is set the two sections are instead encoded with
+// encodeVertexBuffer() and encodeIndexBuffer() (see MeshCompression.h),
+// vertexDataSize and indexDataSize are always the sizes on disk.
+//
+// The checksum covers everything after the header.
+
+#define BAKED_MESH_MAGIC 0x4853454d // "MESH"
+#define BAKED_MESH_VERSION 5
+
+// BakedMeshHeader::flags
+#define BAKED_MESH_COMPRESSED 0x1
+
+struct BakedMeshHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint32_t bytesPerIndex;
+    uint32_t flags;
+    uint32_t vertexDataOffset;
+    uint32_t vertexDataSize;
+    uint32_t indexDataOffset;
+    uint32_t indexDataSize;
+    uint32_t numSubmeshes;
+    uint32_t submeshDataOffset;
+    uint64_t fileSize;
+    uint64_t checksum;
+    MeshBounds bounds;
+    uint32_t numLods;
+    MeshLod lods[MAX_MESH_LODS]; // lods[0] is the full mesh, see LoadedObj::lods
+};
+
+struct BakedMesh
+{
+    MappedFile file;
+    const BakedMeshHeader* header;
+
+    // Points into the mapped file, or into decodedData for compressed
+    // meshes. Do NOT call freeLoadedObj() on it and don't write to the buffers
+    LoadedObj obj;
+    void* decodedData;
+};
+
+// Compressed buffers take 40-80% of the space on disk for our test meshes,
+// at the cost of decoding them at load time (a few GB/s)
+bool writeBakedMesh(const char* filename, const LoadedObj &obj, bool compress = false);
+
+// Maps `filename` and validates its header. Uncompressed meshes are used
+// straight from the mapped file without looking at the vertex or index
+// data, call bakedMeshChecksumIsValid() to check for corruption.
+// Compressed meshes are decoded here, which fails on most corruption but
+// not all of it.
+bool loadBakedMesh(const char* filename, BakedMesh* result);
+bool bakedMeshChecksumIsValid(const BakedMesh &mesh);
+void unloadBakedMesh(BakedMesh* mesh);
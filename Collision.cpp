@@ -1,84 +1,507 @@
 #include "Collision.h"
 
 #include <assert.h>
-#include <stdlib.h> // malloc
+#include <math.h>
+#include <stdlib.h> // malloc, qsort
+#include <string.h> // memcpy
 
+#include "GJK.h"
+#include "Hash.h"
 #include "ObjLoading.h"
 
+// Triangles whose normals are closer than this (cos of ~0.8 degrees) and whose
+// planes are within COPLANAR_DISTANCE_TOLERANCE of the mesh's size from
+// each other are merged into one face
+#define COPLANAR_NORMAL_TOLERANCE 0.9999f
+#define COPLANAR_DISTANCE_TOLERANCE 0.0001f
+// Edge directions closer than this are treated as parallel
+#define PARALLEL_EDGE_TOLERANCE 0.9999f
+// Polyhedron pairs with more pairs of edges than this go through checkCollisionGjk()
+#define POLYHEDRON_SAT_MAX_EDGE_PAIRS 1024
+
+// Returns the index of `pos` in `vertices`, adding it if it isn't there yet.
+// `hashTable` holds indices into `vertices` plus one, 0 for empty slots.
+static u32 weldColliderVertex(vec3 pos, vec4* vertices, u32* numVertices, u32* hashTable, u32 hashTableMask)
+{
+    pos += vec3{}; // So -0 and 0 hash the same
+    u32 slot = (u32)hashBytes64(&pos, sizeof(pos)) & hashTableMask;
+    while(hashTable[slot] != 0)
+    {
+        u32 index = hashTable[slot] - 1;
+        if(vertices[index].x == pos.x && vertices[index].y == pos.y && vertices[index].z == pos.z)
+            return index;
+        slot = (slot + 1) & hashTableMask;
+    }
+    u32 index = (*numVertices)++;
+    vertices[index] = v4(pos, 1.f);
+    hashTable[slot] = index + 1;
+    return index;
+}
+
+// One for each edge of each triangle, sorting them groups the copies of each edge together
+struct ColliderHalfEdge
+{
+    u64 key; // Vertex indices, lower one in the high bits
+    u32 face;
+};
+
+static int compareHalfEdges(const void* a, const void* b)
+{
+    u64 keyA = ((const ColliderHalfEdge*)a)->key;
+    u64 keyB = ((const ColliderHalfEdge*)b)->key;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+// NOTE: The arrays are allocated for the worst case (nothing merged)
+// rather than shrunk to fit, colliders are small
 ColliderPolyhedron createColliderPolyhedron(const LoadedObj &obj)
 {
     ColliderPolyhedron result = {};
+    u32 numTriangles = obj.numIndices / 3;
+    result.vertices = (vec4*)malloc(obj.numVertices * sizeof(vec4));
+    result.planes = (Plane*)malloc(numTriangles * sizeof(Plane));
+    result.edges = (Edge*)malloc(numTriangles * 3 * sizeof(Edge));
+    result.edgeDirections = (vec3*)malloc(numTriangles * 3 * sizeof(vec3));
+
+    // Weld vertices by position, the mesh will have split them
+    // wherever the UVs or normals change
+    u32 hashTableSize = 1;
+    while(hashTableSize < obj.numVertices * 2)
+        hashTableSize *= 2;
+    u32* hashTable = (u32*)calloc(hashTableSize, sizeof(u32));
+    u32* weldedIndices = (u32*)malloc(obj.numVertices * sizeof(u32));
+    ColliderHalfEdge* halfEdges = (ColliderHalfEdge*)malloc(numTriangles * 3 * sizeof(ColliderHalfEdge));
+    assert(result.vertices && result.planes && result.edges && result.edgeDirections && hashTable && weldedIndices && halfEdges);
 
-    result.numVertices = obj.numVertices;
-    result.vertices = (vec4*)malloc(result.numVertices * sizeof(vec4));
-
-    vec4* destVertex = result.vertices;
     vec3 sumOfVertices = {};
     for(u32 i=0; i<obj.numVertices; ++i) {
-        *destVertex++ = v4(obj.vertexBuffer[i].pos, 1.f);
-        sumOfVertices += obj.vertexBuffer[i].pos;
+        u32 numVerticesBefore = result.numVertices;
+        weldedIndices[i] = weldColliderVertex(obj.vertexBuffer[i].pos, result.vertices, &result.numVertices, hashTable, hashTableSize - 1);
+        if(result.numVertices > numVerticesBefore)
+            sumOfVertices += obj.vertexBuffer[i].pos;
+    }
+    result.centroid = sumOfVertices / (float)result.numVertices;
+    result.boundingSphereCenter = obj.bounds.sphereCenter;
+    result.boundingSphereRadius = obj.bounds.sphereRadius;
+    free(hashTable);
+
+    // Merge coplanar triangles into faces, remembering which face each
+    // triangle's edges belong to
+    float distanceTolerance = length(obj.bounds.aabbMax - obj.bounds.aabbMin) * COPLANAR_DISTANCE_TOLERANCE;
+    u32 numHalfEdges = 0;
+    for(u32 i=0; i<obj.numIndices; i+=3) {
+        u32 triangle[3] = {
+            weldedIndices[getIndex(obj, i)],
+            weldedIndices[getIndex(obj, i+1)],
+            weldedIndices[getIndex(obj, i+2)]
+        };
+        vec3 a = result.vertices[triangle[0]].xyz;
+        vec3 b = result.vertices[triangle[1]].xyz;
+        vec3 c = result.vertices[triangle[2]].xyz;
+        vec3 n = normaliseOrZero(cross(b-a, c-a));
+        // Degenerate triangles don't have a plane, and their edges
+        // will come from their neighbours anyway
+        if(lengthSquared(n) == 0)
+            continue;
+
+        u32 face = 0;
+        for(; face<result.numPlanes; ++face) {
+            const Plane &plane = result.planes[face];
+            if(dot(plane.normal, n) >= COPLANAR_NORMAL_TOLERANCE && fabsf(dot(a - plane.point.xyz, plane.normal)) <= distanceTolerance)
+                break;
+        }
+        if(face == result.numPlanes) {
+            result.planes[face] = { v4(a, 1.f), n };
+            ++result.numPlanes;
+        }
+
+        for(u32 j=0; j<3; ++j) {
+            u32 v0 = triangle[j];
+            u32 v1 = triangle[(j+1) % 3];
+            u64 key = (v0 < v1) ? ((u64)v0 << 32) | v1 : ((u64)v1 << 32) | v0;
+            halfEdges[numHalfEdges++] = { key, face };
+        }
+    }
+    free(weldedIndices);
+
+    // Keep one edge for each pair of vertices that's on the boundary
+    // between two faces, the rest are inside a face
+    qsort(halfEdges, numHalfEdges, sizeof(ColliderHalfEdge), compareHalfEdges);
+    for(u32 first=0; first<numHalfEdges;) {
+        u32 faces[2] = { halfEdges[first].face, COLLIDER_NO_FACE };
+        u32 end = first + 1;
+        for(; end<numHalfEdges && halfEdges[end].key == halfEdges[first].key; ++end) {
+            if(halfEdges[end].face != faces[0] && faces[1] == COLLIDER_NO_FACE)
+                faces[1] = halfEdges[end].face;
+        }
+        // An edge of only one triangle is on the boundary of an open mesh, keep it too
+        if(faces[1] != COLLIDER_NO_FACE || end - first == 1) {
+            u64 key = halfEdges[first].key;
+            Edge* edge = result.edges + result.numEdges++;
+            edge->p0 = result.vertices[key >> 32].xyz;
+            edge->p1 = result.vertices[key & 0xffffffff].xyz;
+            edge->faces[0] = faces[0];
+            edge->faces[1] = faces[1];
+        }
+        first = end;
+    }
+    free(halfEdges);
+
+    // Parallel edges give the same separating axes, so only keep one direction for them
+    for(u32 i=0; i<result.numEdges; ++i) {
+        vec3 dir = normalise(result.edges[i].p1 - result.edges[i].p0);
+        u32 j = 0;
+        for(; j<result.numEdgeDirections; ++j) {
+            if(fabsf(dot(dir, result.edgeDirections[j])) >= PARALLEL_EDGE_TOLERANCE)
+                break;
+        }
+        if(j == result.numEdgeDirections)
+            result.edgeDirections[result.numEdgeDirections++] = dir;
     }
-    result.centroid = sumOfVertices / (float)obj.numVertices;
 
-    // Note: We will have redundant planes here since we're adding one for each triangle rather than each face
-    // This will be fixed when we actually generate collision data offline
-    result.numPlanes = obj.numIndices / 3;
-    result.planes = (Plane*)malloc(result.numPlanes * sizeof(Plane));
+    return result;
+}
 
-    Plane* destPlane = result.planes;
-    for(u32 i=0; i<obj.numIndices; i+=3) {
-        vec3 a = obj.vertexBuffer[obj.indexBuffer[i]].pos;
-        vec3 b = obj.vertexBuffer[obj.indexBuffer[i+1]].pos;
-        vec3 c = obj.vertexBuffer[obj.indexBuffer[i+2]].pos;
-        vec3 n = normalise(cross(b-a, c-a));
-
-        destPlane->point = v4(a, 1.f);
-        destPlane->normal = n;
-        ++destPlane;
+void freeColliderPolyhedron(ColliderPolyhedron collider)
+{
+    free(collider.vertices);
+    free(collider.planes);
+    free(collider.edges);
+    free(collider.edgeDirections);
+}
+
+void setColliderTransform(ColliderPolyhedron* collider, const mat4 &modelMatrix, const mat3 &normalMatrix)
+{
+    collider->modelMatrix = modelMatrix;
+    collider->normalMatrix = normalMatrix;
+    collider->worldSpaceIsUpToDate = false;
+}
+
+// Rounds `count` up to the padded length of the world space plane and vertex arrays
+static u32 getPaddedColliderCount(u32 count)
+{
+    return (count + COLLIDER_SOA_PADDING - 1) & ~(u32)(COLLIDER_SOA_PADDING - 1);
+}
+
+void updateColliderWorldSpace(ColliderPolyhedron* collider)
+{
+    if(collider->worldSpaceIsUpToDate)
+        return;
+
+    u32 numPaddedPlanes = getPaddedColliderCount(collider->numPlanes);
+    u32 numPaddedVertices = getPaddedColliderCount(collider->numVertices);
+
+    // All the arrays share one allocation, made the first time round
+    if(!collider->worldSpaceMemory)
+    {
+        size_t planesSize = 4 * numPaddedPlanes * sizeof(float);
+        size_t verticesSize = 3 * numPaddedVertices * sizeof(float);
+        size_t edgesSize = collider->numEdges * sizeof(Edge);
+        size_t edgeArcsSize = collider->numEdges * sizeof(EdgeArc);
+        char* memory = (char*)malloc(planesSize + verticesSize + edgesSize + edgeArcsSize);
+        assert(memory);
+        collider->worldSpaceMemory = memory;
+        float* floats = (float*)memory;
+        collider->worldPlaneNormalX = floats;
+        collider->worldPlaneNormalY = floats + numPaddedPlanes;
+        collider->worldPlaneNormalZ = floats + 2*numPaddedPlanes;
+        collider->worldPlaneD = floats + 3*numPaddedPlanes;
+        collider->worldVertexX = floats + 4*numPaddedPlanes;
+        collider->worldVertexY = floats + 4*numPaddedPlanes + numPaddedVertices;
+        collider->worldVertexZ = floats + 4*numPaddedPlanes + 2*numPaddedVertices;
+        collider->worldEdges = (Edge*)(memory + planesSize + verticesSize);
+        collider->worldEdgeArcs = (EdgeArc*)(memory + planesSize + verticesSize + edgesSize);
     }
 
-    // NOTE: We will have duplicate edges here. Just doing the simplest thing for now.
-    // This will be fixed when we actually generate collision data offline
-    result.numEdges = obj.numIndices;
-    result.edges = (Edge*)malloc(result.numEdges * sizeof(Edge));
+    const mat4 &modelMatrix = collider->modelMatrix;
+    for(u32 i=0; i<numPaddedPlanes; ++i) {
+        vec3 normal = {};
+        float d = 1E+37;
+        if(i < collider->numPlanes) {
+            vec3 point = (collider->planes[i].point * modelMatrix).xyz;
+            normal = normalise(collider->planes[i].normal * collider->normalMatrix);
+            d = dot(normal, point);
+        }
+        collider->worldPlaneNormalX[i] = normal.x;
+        collider->worldPlaneNormalY[i] = normal.y;
+        collider->worldPlaneNormalZ[i] = normal.z;
+        collider->worldPlaneD[i] = d;
+    }
+    vec3 vertex = {};
+    for(u32 i=0; i<numPaddedVertices; ++i) {
+        if(i < collider->numVertices)
+            vertex = (collider->vertices[i] * modelMatrix).xyz;
+        collider->worldVertexX[i] = vertex.x;
+        collider->worldVertexY[i] = vertex.y;
+        collider->worldVertexZ[i] = vertex.z;
+    }
+    for(u32 i=0; i<collider->numEdges; ++i) {
+        Edge* edge = collider->worldEdges + i;
+        *edge = collider->edges[i];
+        edge->p0 = (v4(edge->p0, 1) * modelMatrix).xyz;
+        edge->p1 = (v4(edge->p1, 1) * modelMatrix).xyz;
+    }
+    for(u32 i=0; i<collider->numEdges; ++i) {
+        const Edge &edge = collider->edges[i];
+        EdgeArc* arc = collider->worldEdgeArcs + i;
+        arc->normal0 = vec3{collider->worldPlaneNormalX[edge.faces[0]], collider->worldPlaneNormalY[edge.faces[0]], collider->worldPlaneNormalZ[edge.faces[0]]};
+        arc->normal1 = {};
+        if(edge.faces[1] != COLLIDER_NO_FACE)
+            arc->normal1 = vec3{collider->worldPlaneNormalX[edge.faces[1]], collider->worldPlaneNormalY[edge.faces[1]], collider->worldPlaneNormalZ[edge.faces[1]]};
+        arc->arcNormal = cross(arc->normal1, arc->normal0);
+    }
+    collider->worldCentroid = (v4(collider->centroid, 1) * modelMatrix).xyz;
 
-    Edge* destEdge = result.edges;
-    for(u32 i=0; i<obj.numIndices; i+=3) {
-        vec3 a = obj.vertexBuffer[obj.indexBuffer[i]].pos;
-        vec3 b = obj.vertexBuffer[obj.indexBuffer[i+1]].pos;
-        vec3 c = obj.vertexBuffer[obj.indexBuffer[i+2]].pos;
-        
-        *destEdge++ = {a, b};
-        *destEdge++ = {b, c};
-        *destEdge++ = {c, a};
+    collider->worldSpaceIsUpToDate = true;
+}
+
+void freeColliderWorldSpace(ColliderPolyhedron* collider)
+{
+    free(collider->worldSpaceMemory);
+    collider->worldSpaceMemory = NULL;
+    collider->worldPlaneNormalX = NULL;
+    collider->worldPlaneNormalY = NULL;
+    collider->worldPlaneNormalZ = NULL;
+    collider->worldPlaneD = NULL;
+    collider->worldVertexX = NULL;
+    collider->worldVertexY = NULL;
+    collider->worldVertexZ = NULL;
+    collider->worldEdges = NULL;
+    collider->worldEdgeArcs = NULL;
+    collider->worldSpaceIsUpToDate = false;
+}
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define COLLISION_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_SIMD_WIDTH 4
+#endif
+
+// The scalar versions are only needed without SIMD, or to compare against in
+// tools/collisionbench.cpp
+#if !defined(COLLISION_SIMD_WIDTH) || defined(COLLISION_BENCHMARK)
+
+// Returns the smallest dot(vertex, axis) over the world space vertices of `poly`.
+// The largest is -findMinProjection(poly, -axis).
+static float findMinProjectionScalar(const ColliderPolyhedron &poly, vec3 axis)
+{
+    float minDist = 1E+37;
+    for(u32 i=0; i<poly.numVertices; ++i)
+    {
+        float dist = poly.worldVertexX[i]*axis.x + poly.worldVertexY[i]*axis.y + poly.worldVertexZ[i]*axis.z;
+        minDist = CLAMP_BELOW(minDist, dist);
     }
+    return minDist;
+}
 
+// How far a shape is behind each plane of `poly`, for shapes made of a line
+// segment {p0,p1} swept by a sphere or a disc of `radius`: the furthest
+// point on the shape behind a plane with normal n is the endpoint with the
+// smallest dot(endpoint, n), moved back by radius*sqrt(1 - dot(n, discNormal)^2).
+// Spheres and capsules pass a zero `discNormal` so that's always just
+// `radius`, cylinders pass their normalised axis.
+// Returns the smallest penetration distance and its plane in `minPlane`,
+// stopping as soon as one is negative, i.e. a separating axis.
+static float findMinPlanePenetrationScalar(const ColliderPolyhedron &poly, vec3 p0, vec3 p1, float radius, vec3 discNormal, u32* minPlane)
+{
+    bool isDisc = lengthSquared(discNormal) > 0;
+    float minPenetration = 1E+37;
+    *minPlane = 0;
+    for(u32 i=0; i<poly.numPlanes; ++i)
+    {
+        vec3 normal = {poly.worldPlaneNormalX[i], poly.worldPlaneNormalY[i], poly.worldPlaneNormalZ[i]};
+        float dist0 = dot(p0, normal);
+        float dist1 = dot(p1, normal);
+        float radiusScale = 1;
+        if(isDisc) {
+            float cosAngle = dot(normal, discNormal);
+            radiusScale = sqrtf(CLAMP_ABOVE(1 - cosAngle*cosAngle, 0.f));
+        }
+        float penetration = poly.worldPlaneD[i] - CLAMP_BELOW(dist0, dist1) + radius*radiusScale;
+        if(penetration < 0) {
+            *minPlane = i;
+            return penetration;
+        }
+        if(penetration < minPenetration) {
+            minPenetration = penetration;
+            *minPlane = i;
+        }
+    }
+    return minPenetration;
+}
+
+#endif
+
+#ifdef COLLISION_SIMD_WIDTH
+
+// Wrappers so the kernels below are written once for both widths
+#if COLLISION_SIMD_WIDTH == 8
+typedef __m256 floatN;
+#define loadN(p) _mm256_loadu_ps(p)
+#define storeN(p, a) _mm256_storeu_ps((p), (a))
+#define setN(x) _mm256_set1_ps(x)
+#define addN(a, b) _mm256_add_ps((a), (b))
+#define subN(a, b) _mm256_sub_ps((a), (b))
+#define mulN(a, b) _mm256_mul_ps((a), (b))
+#define minN(a, b) _mm256_min_ps((a), (b))
+#define maxN(a, b) _mm256_max_ps((a), (b))
+#define sqrtN(a) _mm256_sqrt_ps(a)
+#define lessThanN(a, b) _mm256_cmp_ps((a), (b), _CMP_LT_OQ)
+#define selectN(mask, a, b) _mm256_blendv_ps((b), (a), (mask))
+#define movemaskN(a) _mm256_movemask_ps(a)
+#else
+typedef __m128 floatN;
+#define loadN(p) _mm_loadu_ps(p)
+#define storeN(p, a) _mm_storeu_ps((p), (a))
+#define setN(x) _mm_set1_ps(x)
+#define addN(a, b) _mm_add_ps((a), (b))
+#define subN(a, b) _mm_sub_ps((a), (b))
+#define mulN(a, b) _mm_mul_ps((a), (b))
+#define minN(a, b) _mm_min_ps((a), (b))
+#define maxN(a, b) _mm_max_ps((a), (b))
+#define sqrtN(a) _mm_sqrt_ps(a)
+#define lessThanN(a, b) _mm_cmplt_ps((a), (b))
+// No blendv in SSE2
+#define selectN(mask, a, b) _mm_or_ps(_mm_and_ps((mask), (a)), _mm_andnot_ps((mask), (b)))
+#define movemaskN(a) _mm_movemask_ps(a)
+#endif
+
+// Same as findMinProjectionScalar(), COLLISION_SIMD_WIDTH vertices at a time.
+// The padding repeats the last vertex so it never changes the result.
+static float findMinProjection(const ColliderPolyhedron &poly, vec3 axis)
+{
+    floatN axisX = setN(axis.x);
+    floatN axisY = setN(axis.y);
+    floatN axisZ = setN(axis.z);
+    floatN minDist = setN(1E+37f);
+    for(u32 i=0; i<poly.numVertices; i+=COLLISION_SIMD_WIDTH)
+    {
+        floatN dist = addN(addN(
+            mulN(loadN(poly.worldVertexX + i), axisX),
+            mulN(loadN(poly.worldVertexY + i), axisY)),
+            mulN(loadN(poly.worldVertexZ + i), axisZ));
+        minDist = minN(minDist, dist);
+    }
+    float lanes[COLLISION_SIMD_WIDTH];
+    storeN(lanes, minDist);
+    float result = lanes[0];
+    for(u32 i=1; i<COLLISION_SIMD_WIDTH; ++i)
+        result = CLAMP_BELOW(result, lanes[i]);
+    return result;
+}
+
+// Same as findMinPlanePenetrationScalar(), COLLISION_SIMD_WIDTH planes at a time.
+// The padding planes are so far away they're never negative or the smallest.
+static float findMinPlanePenetration(const ColliderPolyhedron &poly, vec3 p0, vec3 p1, float radius, vec3 discNormal, u32* minPlane)
+{
+    floatN p0X = setN(p0.x), p0Y = setN(p0.y), p0Z = setN(p0.z);
+    floatN p1X = setN(p1.x), p1Y = setN(p1.y), p1Z = setN(p1.z);
+    floatN discX = setN(discNormal.x), discY = setN(discNormal.y), discZ = setN(discNormal.z);
+    bool isDisc = lengthSquared(discNormal) > 0;
+    floatN radiusN = setN(radius);
+    floatN zero = setN(0);
+    floatN one = setN(1);
+    floatN laneStep = setN((float)COLLISION_SIMD_WIDTH);
+
+    // Plane indices are kept as floats so they can be selected like the distances
+    float firstIndices[COLLISION_SIMD_WIDTH];
+    for(u32 i=0; i<COLLISION_SIMD_WIDTH; ++i)
+        firstIndices[i] = (float)i;
+    floatN indices = loadN(firstIndices);
+    floatN minPenetration = setN(1E+37f);
+    floatN minIndices = zero;
+
+    for(u32 i=0; i<poly.numPlanes; i+=COLLISION_SIMD_WIDTH)
+    {
+        floatN normalX = loadN(poly.worldPlaneNormalX + i);
+        floatN normalY = loadN(poly.worldPlaneNormalY + i);
+        floatN normalZ = loadN(poly.worldPlaneNormalZ + i);
+        floatN dist0 = addN(addN(mulN(p0X, normalX), mulN(p0Y, normalY)), mulN(p0Z, normalZ));
+        floatN dist1 = addN(addN(mulN(p1X, normalX), mulN(p1Y, normalY)), mulN(p1Z, normalZ));
+        floatN radiusOffset = radiusN;
+        if(isDisc) {
+            floatN cosAngle = addN(addN(mulN(discX, normalX), mulN(discY, normalY)), mulN(discZ, normalZ));
+            radiusOffset = mulN(radiusN, sqrtN(maxN(subN(one, mulN(cosAngle, cosAngle)), zero)));
+        }
+        floatN penetration = addN(subN(loadN(poly.worldPlaneD + i), minN(dist0, dist1)), radiusOffset);
+
+        if(movemaskN(lessThanN(penetration, zero))) {
+            float lanes[COLLISION_SIMD_WIDTH];
+            storeN(lanes, penetration);
+            for(u32 j=0; j<COLLISION_SIMD_WIDTH; ++j) {
+                if(lanes[j] < 0) {
+                    *minPlane = i + j;
+                    return lanes[j];
+                }
+            }
+        }
+
+        floatN isSmaller = lessThanN(penetration, minPenetration);
+        minPenetration = selectN(isSmaller, penetration, minPenetration);
+        minIndices = selectN(isSmaller, indices, minIndices);
+        indices = addN(indices, laneStep);
+    }
+
+    // Each lane has the first smallest plane it saw, take the smallest of
+    // those, and the first one on ties to match the scalar version
+    float lanePenetrations[COLLISION_SIMD_WIDTH];
+    float laneIndices[COLLISION_SIMD_WIDTH];
+    storeN(lanePenetrations, minPenetration);
+    storeN(laneIndices, minIndices);
+    float result = lanePenetrations[0];
+    float resultIndex = laneIndices[0];
+    for(u32 i=1; i<COLLISION_SIMD_WIDTH; ++i) {
+        if(lanePenetrations[i] < result || (lanePenetrations[i] == result && laneIndices[i] < resultIndex)) {
+            result = lanePenetrations[i];
+            resultIndex = laneIndices[i];
+        }
+    }
+    *minPlane = (u32)resultIndex;
     return result;
 }
 
+#undef loadN
+#undef storeN
+#undef setN
+#undef addN
+#undef subN
+#undef mulN
+#undef minN
+#undef maxN
+#undef sqrtN
+#undef lessThanN
+#undef selectN
+#undef movemaskN
+
+#else
+
+static float findMinProjection(const ColliderPolyhedron &poly, vec3 axis)
+{
+    return findMinProjectionScalar(poly, axis);
+}
+
+static float findMinPlanePenetration(const ColliderPolyhedron &poly, vec3 p0, vec3 p1, float radius, vec3 discNormal, u32* minPlane)
+{
+    return findMinPlanePenetrationScalar(poly, p0, p1, radius, discNormal, minPlane);
+}
+
+#endif
+
 // Check if any of the plane normals of `b` are a separating axis for the vertices of `a`
 static CollisionResult separatingAxisTest(const ColliderPolyhedron &a, const ColliderPolyhedron &b)
 {
+    assert(a.worldSpaceIsUpToDate && b.worldSpaceIsUpToDate);
     CollisionResult result = {
         true, 1E+37, {}
     };
     for(u32 i=0; i<b.numPlanes; ++i)
     {
-        Plane plane = {
-            b.planes[i].point * b.modelMatrix,
-            normalise(b.planes[i].normal * b.normalMatrix)
-        };
+        vec3 normal = {b.worldPlaneNormalX[i], b.worldPlaneNormalY[i], b.worldPlaneNormalZ[i]};
 
         // Find how far the vertices of `a` are behind the current plane
-        float currentPenetrationDistance = -1E+37;
-        for(u32 j=0; j<a.numVertices; ++j)
-        {
-            vec4 vertex = a.vertices[j] * a.modelMatrix;
-            float dist = dot(plane.point.xyz - vertex.xyz, plane.normal);
-            if(dist > currentPenetrationDistance) {
-                currentPenetrationDistance = dist;
-            }
-        }
+        float currentPenetrationDistance = b.worldPlaneD[i] - findMinProjection(a, normal);
 
         // If all of a's vertices are in front of current plane,
         // we have found a separating axis and there is no collision
@@ -90,13 +513,93 @@ static CollisionResult separatingAxisTest(const ColliderPolyhedron &a, const Col
         // so we can resolve the collision
         if(currentPenetrationDistance < result.penetrationDistance) {
             result.penetrationDistance = currentPenetrationDistance;
-            result.normal = plane.normal;
+            result.normal = normal;
         }
     }
     return result;
 }
 
-CollisionResult checkCollision(const ColliderPolyhedron &a, const ColliderPolyhedron &b)
+// Gauss map test from "The Separating Axis Test between Convex Polyhedra"
+// by Dirk Gregorius (GDC 2013). The cross product of two edges is only a
+// face of the Minkowski difference of the polyhedra, and so worth testing
+// as a separating axis, if the edges' arcs cross on the Gauss map (with the
+// arc of `b`'s edge negated, since it's a difference).
+static bool isMinkowskiFace(const EdgeArc &arcA, const EdgeArc &arcB)
+{
+    // Which side of the great circle through arcA each end of -arcB is on, and vice versa
+    float cba = -dot(arcB.normal0, arcA.arcNormal);
+    float dba = -dot(arcB.normal1, arcA.arcNormal);
+    if(cba * dba >= 0)
+        return false;
+    float adc = dot(arcA.normal0, arcB.arcNormal);
+    float bdc = dot(arcA.normal1, arcB.arcNormal);
+    // Both arcs also have to be in the same hemisphere, not opposite each other
+    return adc * bdc < 0 && cba * bdc > 0;
+}
+
+// Check if the cross product of an edge of `a` with an edge of `b` is a
+// separating axis. Faces alone miss polyhedra that are only separated
+// edge-to-edge.
+// Only pairs of edges that pass isMinkowskiFace() are tested, and for those
+// the two edges are the supporting features on the axis, so the distance
+// between them along it comes straight from their endpoints without
+// projecting any vertices. Edges of open meshes only have one face, so
+// pairs involving them fall back to projecting both colliders.
+// The normal points from `b` towards `a`, like the plane normals of `b` in separatingAxisTest(a, b)
+static CollisionResult edgeAxisTest(const ColliderPolyhedron &a, const ColliderPolyhedron &b)
+{
+    CollisionResult result = {
+        true, 1E+37, {}
+    };
+    vec3 centroidOffset = a.worldCentroid - b.worldCentroid;
+    for(u32 i=0; i<a.numEdges; ++i)
+    {
+        const Edge &edgeA = a.worldEdges[i];
+        const EdgeArc &arcA = a.worldEdgeArcs[i];
+        bool edgeAIsClosed = edgeA.faces[1] != COLLIDER_NO_FACE;
+        for(u32 j=0; j<b.numEdges; ++j)
+        {
+            const Edge &edgeB = b.worldEdges[j];
+            bool isClosedPair = edgeAIsClosed && edgeB.faces[1] != COLLIDER_NO_FACE;
+            if(isClosedPair && !isMinkowskiFace(arcA, b.worldEdgeArcs[j]))
+                continue;
+
+            vec3 dirA = edgeA.p1 - edgeA.p0;
+            vec3 dirB = edgeB.p1 - edgeB.p0;
+            vec3 axis = cross(dirA, dirB);
+            // Parallel edges, the face tests cover this
+            if(lengthSquared(axis) < 0.000001f * lengthSquared(dirA) * lengthSquared(dirB))
+                continue;
+            axis = normalise(axis);
+
+            float currentPenetrationDistance;
+            if(isClosedPair) {
+                // Point the axis out of `b` at edgeB, then edgeA is the deepest part of `a` along it
+                if(dot(axis, edgeB.p0 - b.worldCentroid) < 0)
+                    axis = -axis;
+                currentPenetrationDistance = dot(axis, edgeB.p0 - edgeA.p0);
+            }
+            else {
+                if(dot(axis, centroidOffset) < 0)
+                    axis = -axis;
+                float minA = findMinProjection(a, axis);
+                float maxB = -findMinProjection(b, -axis);
+                currentPenetrationDistance = maxB - minA;
+            }
+            if(currentPenetrationDistance < 0) {
+                result.isColliding = false;
+                return result;
+            }
+            if(currentPenetrationDistance < result.penetrationDistance) {
+                result.penetrationDistance = currentPenetrationDistance;
+                result.normal = axis;
+            }
+        }
+    }
+    return result;
+}
+
+static CollisionResult checkCollisionSat(const ColliderPolyhedron &a, const ColliderPolyhedron &b)
 {
     CollisionResult resultA = separatingAxisTest(a, b);
     if(!resultA.isColliding)
@@ -104,11 +607,25 @@ CollisionResult checkCollision(const ColliderPolyhedron &a, const ColliderPolyhe
     CollisionResult resultB = separatingAxisTest(b, a);
     if(!resultB.isColliding)
         return resultB;
+    CollisionResult resultEdges = edgeAxisTest(a, b);
+    if(!resultEdges.isColliding)
+        return resultEdges;
+
+    CollisionResult result = resultA;
+    if(resultB.penetrationDistance < result.penetrationDistance)
+        result = resultB;
+    if(resultEdges.penetrationDistance < result.penetrationDistance)
+        result = resultEdges;
+    return result;
+}
 
-    if(resultA.penetrationDistance < resultB.penetrationDistance)
-        return resultA;
-    else
-        return resultB;
+CollisionResult checkCollision(const ColliderPolyhedron &a, const ColliderPolyhedron &b)
+{
+    // Even with the Gauss map pruning the edge test looks at every pair of
+    // edges, GJK is cheaper past a handful of edges each
+    if((u64)a.numEdges * b.numEdges > POLYHEDRON_SAT_MAX_EDGE_PAIRS)
+        return checkCollisionGjk(makeConvexShape(a), makeConvexShape(b));
+    return checkCollisionSat(a, b);
 }
 
 // Returns closest point to p that lies on line segment ab.
@@ -123,28 +640,18 @@ static vec3 findClosestPointOnLineSegment(vec3 p, vec3 a, vec3 b)
 
 CollisionResult checkCollision(const ColliderPolyhedron &poly, const ColliderSphere &sphere)
 {
+    assert(poly.worldSpaceIsUpToDate);
     CollisionResult result = {
         true, 1E+37, {}
     };
-    for(u32 i=0; i<poly.numPlanes; ++i)
-    {
-        Plane plane = {
-            poly.planes[i].point * poly.modelMatrix,
-            normalise(poly.planes[i].normal * poly.normalMatrix)
-        };
-        vec3 furthestPointOnSphere = sphere.pos - plane.normal*sphere.radius;
-        float currentPenetrationDistance = dot(plane.point.xyz - furthestPointOnSphere, plane.normal);
-        if(currentPenetrationDistance < 0) {
-            result.isColliding = false;
-            return result;
-        }
-        
-        // Keep track of which plane gives the smallest penetration 
-        // so we can resolve the collision
-        if(currentPenetrationDistance < result.penetrationDistance) {
-            result.penetrationDistance = currentPenetrationDistance;
-            result.normal = -plane.normal;
-        }
+    // Find the plane the sphere is least far behind, a sphere is a capsule with no length
+    u32 minPlane;
+    result.penetrationDistance = findMinPlanePenetration(poly, sphere.pos, sphere.pos, sphere.radius, vec3{}, &minPlane);
+    if(poly.numPlanes > 0)
+        result.normal = -vec3{poly.worldPlaneNormalX[minPlane], poly.worldPlaneNormalY[minPlane], poly.worldPlaneNormalZ[minPlane]};
+    if(result.penetrationDistance < 0) {
+        result.isColliding = false;
+        return result;
     }
 
     // Did not find separating axis using polyhedron's faces. Find closest edge and test 
@@ -154,10 +661,7 @@ CollisionResult checkCollision(const ColliderPolyhedron &poly, const ColliderSph
     { // Find closest edge point on polyhedron to sphere center
         for(u32 i=0; i<poly.numEdges; ++i)
         {
-            Edge edge = {
-                (v4(poly.edges[i].p0, 1) * poly.modelMatrix).xyz,
-                (v4(poly.edges[i].p1, 1) * poly.modelMatrix).xyz
-            };
+            const Edge &edge = poly.worldEdges[i];
             
             vec3 closestPointOnEdge = findClosestPointOnLineSegment(sphere.pos, edge.p0, edge.p1);
             float distSquared = lengthSquared(closestPointOnEdge - sphere.pos);
@@ -169,8 +673,7 @@ CollisionResult checkCollision(const ColliderPolyhedron &poly, const ColliderSph
         }
     }
     // Use the vector from the polyhedron's centroid to the closest edge as its "normal"
-    vec3 transformedCentroid = (v4(poly.centroid, 1.0) * poly.modelMatrix).xyz;
-    vec3 closestEdgeNormal = normalise(overallClosestEdgePoint - transformedCentroid);
+    vec3 closestEdgeNormal = normalise(overallClosestEdgePoint - poly.worldCentroid);
     vec3 furthestPointOnSphere = sphere.pos - closestEdgeNormal * sphere.radius;
     
     float penetrationDistance = dot(overallClosestEdgePoint - furthestPointOnSphere, closestEdgeNormal);
@@ -277,31 +780,19 @@ static void findClosestPointsOnLineSegments(vec3 p1, vec3 q1, vec3 p2, vec3 q2,
 
 CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderPolyhedron &poly)
 {
+    assert(poly.worldSpaceIsUpToDate);
     CollisionResult result = {
         true, 1E+37, {}
     };
 
-    for(u32 i=0; i<poly.numPlanes; ++i)
-    {
-        Plane plane = {
-            poly.planes[i].point * poly.modelMatrix,
-            normalise(poly.planes[i].normal * poly.normalMatrix)
-        };
-        
-        vec3 furthestPointOnCylinder = getFurthestPointInDir(cylinder, -plane.normal);
-        
-        float currentPenetrationDistance = dot(plane.point.xyz - furthestPointOnCylinder, plane.normal);
-        if(currentPenetrationDistance < 0) {
-            result.isColliding = false;
-            return result;
-        }
-        
-        // Keep track of which plane gives the smallest penetration 
-        // so we can resolve the collision
-        if(currentPenetrationDistance < result.penetrationDistance) {
-            result.penetrationDistance = currentPenetrationDistance;
-            result.normal = plane.normal;
-        }
+    // Find the plane the cylinder is least far behind
+    u32 minPlane;
+    result.penetrationDistance = findMinPlanePenetration(poly, cylinder.p0, cylinder.p1, cylinder.radius, normalise(cylinder.p1 - cylinder.p0), &minPlane);
+    if(poly.numPlanes > 0)
+        result.normal = vec3{poly.worldPlaneNormalX[minPlane], poly.worldPlaneNormalY[minPlane], poly.worldPlaneNormalZ[minPlane]};
+    if(result.penetrationDistance < 0) {
+        result.isColliding = false;
+        return result;
     }
 
     // Did not find separating axis using polyhedron's faces. Find closest edge and test 
@@ -311,10 +802,7 @@ CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderP
     { // Find closest edge point on polyhedron to sphere center
         for(u32 i=0; i<poly.numEdges; ++i)
         {
-            Edge edge = {
-                (v4(poly.edges[i].p0, 1) * poly.modelMatrix).xyz,
-                (v4(poly.edges[i].p1, 1) * poly.modelMatrix).xyz
-            };
+            const Edge &edge = poly.worldEdges[i];
             
             vec3 closestPointOnCylinder, closestPointOnEdge;
             findClosestPointsOnLineSegments(
@@ -333,8 +821,7 @@ CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderP
 
     // Find how far behind closest edge cylinder is
     // Use the vector from the polyhedron's centroid to the closest edge as its "normal"
-    vec3 transformedCentroid = (v4(poly.centroid, 1.0) * poly.modelMatrix).xyz;
-    vec3 closestEdgeNormal = normalise(overallClosestEdgePoint - transformedCentroid);
+    vec3 closestEdgeNormal = normalise(overallClosestEdgePoint - poly.worldCentroid);
     vec3 furthestPointOnCylinder = getFurthestPointInDir(cylinder, -closestEdgeNormal);
     
     float penetrationDistance = dot(overallClosestEdgePoint - furthestPointOnCylinder, closestEdgeNormal);
@@ -362,31 +849,19 @@ static vec3 getFurthestPointInDir(const ColliderCapsule& capsule, vec3 dir)
 
 CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderPolyhedron &poly)
 {
+    assert(poly.worldSpaceIsUpToDate);
     CollisionResult result = {
         true, 1E+37, {}
     };
 
-    for(u32 i=0; i<poly.numPlanes; ++i)
-    {
-        Plane plane = {
-            poly.planes[i].point * poly.modelMatrix,
-            normalise(poly.planes[i].normal * poly.normalMatrix)
-        };
-        
-        vec3 furthestPointOnCapsule = getFurthestPointInDir(capsule, -plane.normal);
-        
-        float currentPenetrationDistance = dot(plane.point.xyz - furthestPointOnCapsule, plane.normal);
-        if(currentPenetrationDistance < 0) {
-            result.isColliding = false;
-            return result;
-        }
-        
-        // Keep track of which plane gives the smallest penetration 
-        // so we can resolve the collision
-        if(currentPenetrationDistance < result.penetrationDistance) {
-            result.penetrationDistance = currentPenetrationDistance;
-            result.normal = plane.normal;
-        }
+    // Find the plane the capsule is least far behind
+    u32 minPlane;
+    result.penetrationDistance = findMinPlanePenetration(poly, capsule.p0, capsule.p1, capsule.radius, vec3{}, &minPlane);
+    if(poly.numPlanes > 0)
+        result.normal = vec3{poly.worldPlaneNormalX[minPlane], poly.worldPlaneNormalY[minPlane], poly.worldPlaneNormalZ[minPlane]};
+    if(result.penetrationDistance < 0) {
+        result.isColliding = false;
+        return result;
     }
 
     // Did not find separating axis using polyhedron's faces. Find closest edge and test 
@@ -396,10 +871,7 @@ CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderPol
     { // Find closest edge point on polyhedron to sphere center
         for(u32 i=0; i<poly.numEdges; ++i)
         {
-            Edge edge = {
-                (v4(poly.edges[i].p0, 1) * poly.modelMatrix).xyz,
-                (v4(poly.edges[i].p1, 1) * poly.modelMatrix).xyz
-            };
+            const Edge &edge = poly.worldEdges[i];
             
             vec3 closestPointOnCapsule, closestPointOnEdge;
             findClosestPointsOnLineSegments(
@@ -418,8 +890,7 @@ CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderPol
 
     // Find how far behind closest edge capsule is
     // Use the vector from the polyhedron's centroid to the closest edge as its "normal"
-    vec3 transformedCentroid = (v4(poly.centroid, 1.0) * poly.modelMatrix).xyz;
-    vec3 closestEdgeNormal = normalise(overallClosestEdgePoint - transformedCentroid);
+    vec3 closestEdgeNormal = normalise(overallClosestEdgePoint - poly.worldCentroid);
     vec3 furthestPointOnCapsule = getFurthestPointInDir(capsule, -closestEdgeNormal);
     
     float penetrationDistance = dot(overallClosestEdgePoint - furthestPointOnCapsule, closestEdgeNormal);
@@ -448,3 +919,28 @@ CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderSph
 
     return result;
 }
+
+CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderSphere &sphere)
+{
+    return checkCollisionGjk(makeConvexShape(cylinder), makeConvexShape(sphere));
+}
+
+CollisionResult checkCollision(const ColliderCylinder &cylinderA, const ColliderCylinder &cylinderB)
+{
+    return checkCollisionGjk(makeConvexShape(cylinderA), makeConvexShape(cylinderB));
+}
+
+CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderCapsule &capsule)
+{
+    return checkCollisionGjk(makeConvexShape(cylinder), makeConvexShape(capsule));
+}
+
+CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderCylinder &cylinder)
+{
+    return checkCollisionGjk(makeConvexShape(capsule), makeConvexShape(cylinder));
+}
+
+CollisionResult checkCollision(const ColliderCapsule &capsuleA, const ColliderCapsule &capsuleB)
+{
+    return checkCollisionGjk(makeConvexShape(capsuleA), makeConvexShape(capsuleB));
+}
@@ -9,24 +9,79 @@ struct Plane
     vec3 normal;
 };
 
+// Edge::faces entry for an edge with only one face, i.e. the mesh wasn't closed
+#define COLLIDER_NO_FACE 0xffffffff
+
 struct Edge
 {
     vec3 p0;
     vec3 p1;
+    u32 faces[2]; // Indices into ColliderPolyhedron::planes of the faces either side
+};
+
+// An edge's arc on the Gauss map (the unit sphere of face normals), which
+// runs between the normals of the faces either side of it. The edge axis
+// tests only look at pairs of edges whose arcs cross.
+struct EdgeArc
+{
+    vec3 normal0; // World space normals of Edge::faces
+    vec3 normal1; // Zero if the edge only has one face
+    vec3 arcNormal; // cross(normal1, normal0), parallel to the edge
 };
 
+// World space planes and vertices are padded to a multiple of this,
+// enough for the widest SIMD path in Collision.cpp
+#define COLLIDER_SOA_PADDING 8
+
+// Built from a triangle mesh with the minimum set of features for the
+// separating axis tests: duplicate vertices (e.g. from UV seams) are welded,
+// coplanar triangles are merged into one face (so a cube has 6 planes, not
+// 12) and edges are only kept where two faces meet, once each (12 for a
+// cube, not 36). Each edge knows the faces either side of it, which the
+// edge axis tests use to skip pairs of edges that can't be touching (see
+// EdgeArc). The unique edge directions (3 for a cube) are stored too.
 struct ColliderPolyhedron
 {
     u32 numVertices;
     vec4* vertices;
     u32 numPlanes;
-    Plane* planes;
+    Plane* planes; // One per face
     u32 numEdges;
     Edge* edges;
+    u32 numEdgeDirections;
+    vec3* edgeDirections; // Normalised, and no two are parallel or anti-parallel
     vec3 centroid;
+    // Model space, for rejecting far away pairs before the full tests
+    vec3 boundingSphereCenter;
+    float boundingSphereRadius;
 
+    // Set with setColliderTransform()
     mat4 modelMatrix;
     mat3 normalMatrix;
+
+    // World space copies of the features above, rebuilt by
+    // updateColliderWorldSpace() when the transform has changed so the
+    // collision tests don't have to transform anything themselves.
+    // Planes are stored as a normalised normal and d, so points p on the
+    // plane have dot(normal, p) == d.
+    // Planes and vertices are split into one array per component so the
+    // tests can work on several at once with SIMD. Both are padded to a
+    // multiple of COLLIDER_SOA_PADDING, vertices by repeating the last one
+    // and planes with ones so far away that nothing is ever outside them.
+    // NOTE: These are owned by each instance, copy a collider before
+    // giving it a transform rather than after.
+    bool worldSpaceIsUpToDate;
+    void* worldSpaceMemory;
+    float* worldPlaneNormalX;
+    float* worldPlaneNormalY;
+    float* worldPlaneNormalZ;
+    float* worldPlaneD;
+    float* worldVertexX;
+    float* worldVertexY;
+    float* worldVertexZ;
+    Edge* worldEdges;
+    EdgeArc* worldEdgeArcs; // One per edge
+    vec3 worldCentroid;
 };
 
 struct ColliderSphere
@@ -49,8 +104,31 @@ struct ColliderCapsule
     float radius;
 };
 
+// Builds the collider from a render mesh. This is too slow to do for every
+// collider at level load, bake them offline with tools/colliderbake
+// and load them with loadBakedCollider() (see BakedCollider.h) instead.
 struct LoadedObj;
 ColliderPolyhedron createColliderPolyhedron(const LoadedObj &obj);
+// Only for colliders from createColliderPolyhedron(), not baked ones
+void freeColliderPolyhedron(ColliderPolyhedron collider);
+
+// Marks the collider's world space data as out of date. The tests assert
+// if updateColliderWorldSpace() hasn't been called since.
+// Static colliders only need this once.
+//
+// Usage:
+// ColliderPolyhedron instance = bakedCollider.collider;
+// setColliderTransform(&instance, modelMat, normalMat);
+// updateColliderWorldSpace(&instance);
+// ... // Each frame, for colliders that moved:
+// setColliderTransform(&instance, newModelMat, newNormalMat);
+// updateColliderWorldSpace(&instance);
+// ...
+// freeColliderWorldSpace(&instance);
+void setColliderTransform(ColliderPolyhedron* collider, const mat4 &modelMatrix, const mat3 &normalMatrix);
+// Does nothing unless the transform changed since the last update
+void updateColliderWorldSpace(ColliderPolyhedron* collider);
+void freeColliderWorldSpace(ColliderPolyhedron* collider);
 
 struct CollisionResult
 {
@@ -59,15 +137,20 @@ struct CollisionResult
     vec3 normal;
 };
 
+// The normal points from the second shape towards the first, moving the
+// first shape along it by penetrationDistance separates them.
+// Pairs marked GJK go through checkCollisionGjk() (see GJK.h), which
+// also handles any pair not listed here. Polyhedron pairs use the separating
+// axis tests when both have only a few edges, otherwise GJK.
 CollisionResult checkCollision(const ColliderPolyhedron &polyA, const ColliderPolyhedron &polyB);
 CollisionResult checkCollision(const ColliderPolyhedron &poly, const ColliderSphere &sphere);
 
 CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderPolyhedron &poly);
-// CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderSphere &sphere); // TODO
-// CollisionResult checkCollision(const ColliderCylinder &cylinderA, const ColliderCylinder &cylinderB); // TODO
-// CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderCapsule &capsule); // TODO
+CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderSphere &sphere); // GJK
+CollisionResult checkCollision(const ColliderCylinder &cylinderA, const ColliderCylinder &cylinderB); // GJK
+CollisionResult checkCollision(const ColliderCylinder &cylinder, const ColliderCapsule &capsule); // GJK
 
 CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderPolyhedron &poly);
 CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderSphere &sphere);
-// CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderCylinder &cylinder); // TODO
-// CollisionResult checkCollision(const ColliderCapsule &capsuleA, const ColliderCapsule &capsuleB); // TODO
+CollisionResult checkCollision(const ColliderCapsule &capsule, const ColliderCylinder &cylinder); // GJK
+CollisionResult checkCollision(const ColliderCapsule &capsuleA, const ColliderCapsule &capsuleB); // GJK
@@ -199,6 +199,11 @@ bool _d3d11CompileShader(LPCWSTR fileName, LPCSTR shaderEntryPoint, ID3DBlob** s
 }
 
 bool d3d11CreateVertexShaderAndInputLayout(ID3D11Device1* device, LPCWSTR fileName, LPCSTR shaderEntryPoint, ID3D11VertexShader** vertexShader, D3D11_INPUT_ELEMENT_DESC inputElementDesc[], int numInputElements, ID3D11InputLayout** inputLayout)
+{
+    return d3d11CreateVertexShaderAndInputLayouts(device, fileName, shaderEntryPoint, vertexShader, &inputElementDesc, &numInputElements, 1, inputLayout);
+}
+
+bool d3d11CreateVertexShaderAndInputLayouts(ID3D11Device1* device, LPCWSTR fileName, LPCSTR shaderEntryPoint, ID3D11VertexShader** vertexShader, D3D11_INPUT_ELEMENT_DESC* inputElementDescs[], int numInputElements[], int numInputLayouts, ID3D11InputLayout* inputLayouts[])
 {
     ID3DBlob* shaderByteCode;
     _d3d11CompileShader(fileName, shaderEntryPoint, &shaderByteCode, ShaderType_VERTEX);
@@ -206,8 +211,10 @@ bool d3d11CreateVertexShaderAndInputLayout(ID3D11Device1* device, LPCWSTR fileNa
     HRESULT hResult = device->CreateVertexShader(shaderByteCode->GetBufferPointer(), shaderByteCode->GetBufferSize(), nullptr, vertexShader);
     assert(SUCCEEDED(hResult));
 
-    hResult = device->CreateInputLayout(inputElementDesc, numInputElements, shaderByteCode->GetBufferPointer(), shaderByteCode->GetBufferSize(), inputLayout);
-    assert(SUCCEEDED(hResult));
+    for(int i=0; i<numInputLayouts; ++i) {
+        hResult = device->CreateInputLayout(inputElementDescs[i], numInputElements[i], shaderByteCode->GetBufferPointer(), shaderByteCode->GetBufferSize(), &inputLayouts[i]);
+        assert(SUCCEEDED(hResult));
+    }
 
     shaderByteCode->Release();
 
@@ -233,23 +240,47 @@ Mesh d3d11CreateMesh(ID3D11Device1* device, const LoadedObj &obj)
 {
     Mesh mesh;
 
-    mesh.stride = sizeof(VertexData);
     mesh.numVertices = obj.numVertices;
     mesh.offset = 0;
     mesh.numIndices = obj.numIndices;
+    mesh.bounds = obj.bounds;
+    mesh.indexFormat = (obj.bytesPerIndex == sizeof(uint16_t)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    if(obj.numLods == 0) {
+        mesh.numLods = 1;
+        mesh.lods[0] = { 0, obj.numIndices, 0.f };
+    }
+    else {
+        mesh.numLods = obj.numLods;
+        for(UINT i=0; i<obj.numLods; ++i)
+            mesh.lods[i] = obj.lods[i];
+    }
+
+    const void* vertexData;
+    if(obj.quantisedVertexBuffer) {
+        mesh.vertexFormat = VertexFormat_QUANTISED;
+        mesh.stride = sizeof(QuantisedVertexData);
+        mesh.dequantisationMat = scaleMat(obj.positionScale) * translationMat(obj.positionOffset);
+        vertexData = obj.quantisedVertexBuffer;
+    }
+    else {
+        mesh.vertexFormat = VertexFormat_FLOAT;
+        mesh.stride = sizeof(VertexData);
+        mesh.dequantisationMat = scaleMat(1.f);
+        vertexData = obj.vertexBuffer;
+    }
 
     D3D11_BUFFER_DESC vertexBufferDesc = {};
-    vertexBufferDesc.ByteWidth = obj.numVertices * sizeof(VertexData);
+    vertexBufferDesc.ByteWidth = obj.numVertices * mesh.stride;
     vertexBufferDesc.Usage     = D3D11_USAGE_IMMUTABLE;
     vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
-    D3D11_SUBRESOURCE_DATA vertexSubresourceData = { obj.vertexBuffer };
+    D3D11_SUBRESOURCE_DATA vertexSubresourceData = { vertexData };
 
     HRESULT hResult = device->CreateBuffer(&vertexBufferDesc, &vertexSubresourceData, &mesh.vertexBuffer);
     assert(SUCCEEDED(hResult));
 
     D3D11_BUFFER_DESC indexBufferDesc = {};
-    indexBufferDesc.ByteWidth = obj.numIndices * sizeof(uint16_t);
+    indexBufferDesc.ByteWidth = getTotalNumIndices(obj) * obj.bytesPerIndex;
     indexBufferDesc.Usage     = D3D11_USAGE_IMMUTABLE;
     indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 
@@ -2,6 +2,9 @@
 
 #include <d3d11_1.h>
 
+#include "3DMaths.h"
+#include "ObjLoading.h" // MeshLod
+
 struct D3D11Data {
     ID3D11Device1* device;
     ID3D11DeviceContext1* deviceContext;
@@ -19,8 +22,17 @@ bool d3d11InitRenderTargetsAndDepthBuffer(D3D11Data* d3d11);
 
 bool d3d11CreateVertexShaderAndInputLayout(ID3D11Device1* device, LPCWSTR fileName, LPCSTR shaderEntryPoint, ID3D11VertexShader** vertexShader, D3D11_INPUT_ELEMENT_DESC inputElementDesc[], int numInputElements, ID3D11InputLayout** inputLayout);
 
+// Creates one input layout per entry in `inputElementDescs` for the same vertex shader
+bool d3d11CreateVertexShaderAndInputLayouts(ID3D11Device1* device, LPCWSTR fileName, LPCSTR shaderEntryPoint, ID3D11VertexShader** vertexShader, D3D11_INPUT_ELEMENT_DESC* inputElementDescs[], int numInputElements[], int numInputLayouts, ID3D11InputLayout* inputLayouts[]);
+
 ID3D11PixelShader* d3d11CreatePixelShader(ID3D11Device1* device, LPCWSTR fileName, LPCSTR shaderEntryPoint);
 
+enum VertexFormat {
+    VertexFormat_FLOAT, // VertexData
+    VertexFormat_QUANTISED, // QuantisedVertexData
+    VertexFormat_COUNT
+};
+
 struct Mesh 
 {
     ID3D11Buffer* vertexBuffer;
@@ -29,9 +41,20 @@ struct Mesh
     UINT numIndices;
     UINT stride;
     UINT offset;
+    DXGI_FORMAT indexFormat;
+    VertexFormat vertexFormat;
+    // Maps the vertex buffer's positions to model space, apply before the model matrix.
+    // Identity unless the vertices are quantised.
+    mat4 dequantisationMat;
+    // Index ranges for each level of detail, lods[0] is the full mesh. See LoadedObj::lods
+    UINT numLods;
+    MeshLod lods[MAX_MESH_LODS];
+    // Model space, i.e. after dequantisationMat
+    MeshBounds bounds;
 };
 
-struct LoadedObj;
+// Uploads obj.quantisedVertexBuffer if it exists, otherwise obj.vertexBuffer.
+// The index buffer includes every level of detail.
 Mesh d3d11CreateMesh(ID3D11Device1* device, const LoadedObj &obj);
 
 struct Texture
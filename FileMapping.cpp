@@ -0,0 +1,111 @@
+#include "FileMapping.h"
+
+#include <stdint.h>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+bool mapFile(const char* filename, MappedFile* result)
+{
+    *result = {};
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    result->fileHandle = file;
+    result->numBytes = (size_t)fileSize.QuadPart;
+
+    // Can't create a mapping of an empty file
+    if(result->numBytes == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(!mapping) {
+        CloseHandle(file);
+        *result = {};
+        return false;
+    }
+    result->mappingHandle = mapping;
+
+    result->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!result->data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        *result = {};
+        return false;
+    }
+    return true;
+}
+
+void unmapFile(MappedFile* file)
+{
+    if(file->data)
+        UnmapViewOfFile(file->data);
+    if(file->mappingHandle)
+        CloseHandle((HANDLE)file->mappingHandle);
+    if(file->fileHandle)
+        CloseHandle((HANDLE)file->fileHandle);
+    *file = {};
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool mapFile(const char* filename, MappedFile* result)
+{
+    *result = {};
+
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return false;
+    }
+    result->numBytes = (size_t)fileStat.st_size;
+
+    // mmap() fails for zero-length mappings
+    if(result->numBytes > 0)
+    {
+        void* data = mmap(NULL, result->numBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED) {
+            close(fd);
+            *result = {};
+            return false;
+        }
+        madvise(data, result->numBytes, MADV_SEQUENTIAL);
+        result->data = data;
+    }
+
+    // The mapping stays valid after the file is closed
+    close(fd);
+    return true;
+}
+
+void unmapFile(MappedFile* file)
+{
+    if(file->data)
+        munmap((void*)file->data, file->numBytes);
+    *file = {};
+}
+
+#endif
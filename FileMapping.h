@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file.
+// Uses CreateFileMapping()/MapViewOfFile() on Windows and mmap() elsewhere.
+//
+// Usage:
+// MappedFile file;
+// if(mapFile("test.obj", &file)) {
+//     ... // Read file.numBytes bytes from file.data
+//     unmapFile(&file);
+// }
+struct MappedFile
+{
+    const void* data;
+    size_t numBytes;
+
+    // Platform handles, only used by unmapFile()
+    void* fileHandle;
+    void* mappingHandle;
+};
+
+// Returns false if the file could not be opened or mapped.
+// Note: data is NULL for an empty file.
+bool mapFile(const char* filename, MappedFile* result);
+void unmapFile(MappedFile* file);
@@ -0,0 +1,642 @@
+#include "GJK.h"
+
+#include <assert.h>
+#include <math.h>
+
+// GJK stops when the distance estimate can't improve by more than this fraction of itself
+#define GJK_RELATIVE_TOLERANCE 0.00001f
+// Distances smaller than this fraction of the shapes' size count as touching
+#define GJK_INTERSECTION_TOLERANCE 0.00001f
+#define GJK_MAX_ITERATIONS 64
+
+// EPA stops when the polytope is within this fraction of the shapes' size of the real surface
+#define EPA_TOLERANCE 0.0001f
+#define EPA_MAX_ITERATIONS 128
+#define EPA_MAX_VERTICES (EPA_MAX_ITERATIONS + 4)
+#define EPA_MAX_FACES (2 * EPA_MAX_VERTICES)
+
+ConvexShape makeConvexShape(const ColliderPolyhedron &poly)
+{
+    ConvexShape result = {};
+    result.type = ConvexShapeType_POLYHEDRON;
+    result.polyhedron = &poly;
+    return result;
+}
+
+ConvexShape makeConvexShape(const ColliderSphere &sphere)
+{
+    ConvexShape result = {};
+    result.type = ConvexShapeType_SPHERE;
+    result.p0 = sphere.pos;
+    result.p1 = sphere.pos;
+    result.radius = sphere.radius;
+    return result;
+}
+
+ConvexShape makeConvexShape(const ColliderCapsule &capsule)
+{
+    ConvexShape result = {};
+    result.type = ConvexShapeType_CAPSULE;
+    result.p0 = capsule.p0;
+    result.p1 = capsule.p1;
+    result.radius = capsule.radius;
+    return result;
+}
+
+ConvexShape makeConvexShape(const ColliderCylinder &cylinder)
+{
+    ConvexShape result = {};
+    result.type = ConvexShapeType_CYLINDER;
+    result.p0 = cylinder.p0;
+    result.p1 = cylinder.p1;
+    result.radius = cylinder.radius;
+    return result;
+}
+
+// The radius around the point/segment of spheres and capsules, which GJK leaves out
+static float getShapeMargin(const ConvexShape &shape)
+{
+    bool isRounded = (shape.type == ConvexShapeType_SPHERE || shape.type == ConvexShapeType_CAPSULE);
+    return isRounded ? shape.radius : 0;
+}
+
+static vec3 getShapeCenter(const ConvexShape &shape)
+{
+    if(shape.type == ConvexShapeType_POLYHEDRON)
+        return shape.polyhedron->worldCentroid;
+    return (shape.p0 + shape.p1) * 0.5f;
+}
+
+// Finds the furthest point on `shape` in direction `dir` (which doesn't need
+// to be normalised), leaving out the margin of spheres and capsules
+static vec3 findSupportPoint(const ConvexShape &shape, vec3 dir)
+{
+    switch(shape.type)
+    {
+        case ConvexShapeType_POLYHEDRON:
+        {
+            const ColliderPolyhedron &poly = *shape.polyhedron;
+            assert(poly.worldSpaceIsUpToDate && poly.numVertices > 0);
+            u32 furthestVertex = 0;
+            float furthestDist = -1E+37;
+            for(u32 i=0; i<poly.numVertices; ++i)
+            {
+                float dist = poly.worldVertexX[i]*dir.x + poly.worldVertexY[i]*dir.y + poly.worldVertexZ[i]*dir.z;
+                if(dist > furthestDist) {
+                    furthestDist = dist;
+                    furthestVertex = i;
+                }
+            }
+            return vec3{poly.worldVertexX[furthestVertex], poly.worldVertexY[furthestVertex], poly.worldVertexZ[furthestVertex]};
+        }
+        case ConvexShapeType_SPHERE:
+            return shape.p0;
+        case ConvexShapeType_CAPSULE:
+            return (dot(shape.p0, dir) > dot(shape.p1, dir)) ? shape.p0 : shape.p1;
+        case ConvexShapeType_CYLINDER:
+        {
+            vec3 furthestEndpoint = (dot(shape.p0, dir) > dot(shape.p1, dir)) ? shape.p0 : shape.p1;
+            // Project direction onto plane of cylinder end cap
+            vec3 cylinderUpDir = normalise(shape.p1 - shape.p0);
+            vec3 projection = dir - (cylinderUpDir * dot(dir, cylinderUpDir));
+            float projectionLengthSquared = lengthSquared(projection);
+            if(projectionLengthSquared <= 0.000001f * lengthSquared(dir))
+                return furthestEndpoint;
+            return furthestEndpoint + projection * (shape.radius / sqrtf(projectionLengthSquared));
+        }
+    }
+    assert(false);
+    return {};
+}
+
+// A point on the Minkowski difference a - b, and the points on each shape it came from
+struct SimplexVertex
+{
+    vec3 w;
+    vec3 a;
+    vec3 b;
+};
+
+static SimplexVertex findMinkowskiSupport(const ConvexShape &a, const ConvexShape &b, vec3 dir)
+{
+    SimplexVertex result;
+    result.a = findSupportPoint(a, dir);
+    result.b = findSupportPoint(b, -dir);
+    result.w = result.a - result.b;
+    return result;
+}
+
+// The closest point to the origin on the simplex is the weighted sum of its vertices
+struct Simplex
+{
+    SimplexVertex vertices[4];
+    float weights[4];
+    u32 numVertices;
+};
+
+static vec3 getClosestPoint(const Simplex &simplex)
+{
+    vec3 result = {};
+    for(u32 i=0; i<simplex.numVertices; ++i)
+        result += simplex.vertices[i].w * simplex.weights[i];
+    return result;
+}
+
+static void getClosestPointsOnShapes(const Simplex &simplex, vec3* closestA, vec3* closestB)
+{
+    *closestA = {};
+    *closestB = {};
+    for(u32 i=0; i<simplex.numVertices; ++i) {
+        *closestA += simplex.vertices[i].a * simplex.weights[i];
+        *closestB += simplex.vertices[i].b * simplex.weights[i];
+    }
+}
+
+// Reduce the simplex to the vertices its closest point lies between
+static void keepSimplexVertex(Simplex* simplex, u32 i)
+{
+    simplex->vertices[0] = simplex->vertices[i];
+    simplex->weights[0] = 1;
+    simplex->numVertices = 1;
+}
+
+static void keepSimplexEdge(Simplex* simplex, u32 i, u32 j, float t)
+{
+    SimplexVertex vi = simplex->vertices[i];
+    SimplexVertex vj = simplex->vertices[j];
+    simplex->vertices[0] = vi;
+    simplex->vertices[1] = vj;
+    simplex->weights[0] = 1 - t;
+    simplex->weights[1] = t;
+    simplex->numVertices = 2;
+}
+
+static void solveSimplexEdge(Simplex* simplex)
+{
+    vec3 a = simplex->vertices[0].w;
+    vec3 ab = simplex->vertices[1].w - a;
+    float t = -dot(a, ab);
+    if(t <= 0)
+        keepSimplexVertex(simplex, 0);
+    else if(t >= lengthSquared(ab))
+        keepSimplexVertex(simplex, 1);
+    else
+        keepSimplexEdge(simplex, 0, 1, t / lengthSquared(ab));
+}
+
+// Closest point on a triangle to the origin, by finding which Voronoi region it's in.
+// From Real-Time Collision Detection
+static void solveSimplexTriangle(Simplex* simplex)
+{
+    vec3 a = simplex->vertices[0].w;
+    vec3 b = simplex->vertices[1].w;
+    vec3 c = simplex->vertices[2].w;
+    vec3 ab = b - a;
+    vec3 ac = c - a;
+
+    float d1 = -dot(ab, a);
+    float d2 = -dot(ac, a);
+    if(d1 <= 0 && d2 <= 0) {
+        keepSimplexVertex(simplex, 0);
+        return;
+    }
+
+    float d3 = -dot(ab, b);
+    float d4 = -dot(ac, b);
+    if(d3 >= 0 && d4 <= d3) {
+        keepSimplexVertex(simplex, 1);
+        return;
+    }
+
+    float vc = d1*d4 - d3*d2;
+    if(vc <= 0 && d1 >= 0 && d3 <= 0) {
+        keepSimplexEdge(simplex, 0, 1, d1 / (d1 - d3));
+        return;
+    }
+
+    float d5 = -dot(ab, c);
+    float d6 = -dot(ac, c);
+    if(d6 >= 0 && d5 <= d6) {
+        keepSimplexVertex(simplex, 2);
+        return;
+    }
+
+    float vb = d5*d2 - d1*d6;
+    if(vb <= 0 && d2 >= 0 && d6 <= 0) {
+        keepSimplexEdge(simplex, 0, 2, d2 / (d2 - d6));
+        return;
+    }
+
+    float va = d3*d6 - d5*d4;
+    if(va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        keepSimplexEdge(simplex, 1, 2, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        return;
+    }
+
+    // Inside the face
+    float denom = 1.f / (va + vb + vc);
+    simplex->weights[1] = vb * denom;
+    simplex->weights[2] = vc * denom;
+    simplex->weights[0] = 1 - simplex->weights[1] - simplex->weights[2];
+    simplex->numVertices = 3;
+}
+
+// Returns true if the origin is inside the tetrahedron, otherwise reduces
+// it to the face, edge or vertex closest to the origin
+static bool solveSimplexTetrahedron(Simplex* simplex)
+{
+    static const u32 FACES[4][4] = {
+        {0, 1, 2, 3}, // Last index is the vertex opposite the face
+        {0, 2, 3, 1},
+        {0, 3, 1, 2},
+        {1, 3, 2, 0},
+    };
+
+    bool isOutsideAnyFace = false;
+    float closestDistSquared = 1E+37;
+    Simplex closest = {};
+    for(u32 i=0; i<4; ++i)
+    {
+        vec3 a = simplex->vertices[FACES[i][0]].w;
+        vec3 b = simplex->vertices[FACES[i][1]].w;
+        vec3 c = simplex->vertices[FACES[i][2]].w;
+        vec3 d = simplex->vertices[FACES[i][3]].w;
+        vec3 normal = cross(b - a, c - a);
+        float originSide = -dot(a, normal);
+        float oppositeSide = dot(d - a, normal);
+        // Flat tetrahedra don't contain anything, so test all their faces
+        bool isFlat = oppositeSide*oppositeSide <= 0.000001f * lengthSquared(normal) * lengthSquared(d - a);
+        if(!isFlat && originSide * oppositeSide >= 0)
+            continue;
+
+        isOutsideAnyFace = true;
+        Simplex face = {};
+        face.vertices[0] = simplex->vertices[FACES[i][0]];
+        face.vertices[1] = simplex->vertices[FACES[i][1]];
+        face.vertices[2] = simplex->vertices[FACES[i][2]];
+        face.numVertices = 3;
+        solveSimplexTriangle(&face);
+        float distSquared = lengthSquared(getClosestPoint(face));
+        if(distSquared < closestDistSquared) {
+            closestDistSquared = distSquared;
+            closest = face;
+        }
+    }
+    if(!isOutsideAnyFace)
+        return true;
+    *simplex = closest;
+    return false;
+}
+
+// Runs GJK on the shapes without their margins. Returns true if they
+// intersect (or touch), otherwise `simplex` is left with the closest points.
+static bool runGjk(const ConvexShape &a, const ConvexShape &b, Simplex* simplex)
+{
+    vec3 dir = getShapeCenter(a) - getShapeCenter(b);
+    if(lengthSquared(dir) < 0.000001f)
+        dir = vec3{1, 0, 0};
+    simplex->vertices[0] = findMinkowskiSupport(a, b, dir);
+    simplex->weights[0] = 1;
+    simplex->numVertices = 1;
+
+    // Scales the tolerances to the size of the shapes
+    float maxLengthSquared = lengthSquared(simplex->vertices[0].w);
+
+    vec3 closestPoint = simplex->vertices[0].w;
+    for(u32 iteration=0; iteration<GJK_MAX_ITERATIONS; ++iteration)
+    {
+        float distSquared = lengthSquared(closestPoint);
+        if(distSquared <= GJK_INTERSECTION_TOLERANCE * GJK_INTERSECTION_TOLERANCE * maxLengthSquared)
+            return true;
+
+        SimplexVertex newVertex = findMinkowskiSupport(a, b, -closestPoint);
+        // The new vertex isn't any closer to the origin than the current
+        // closest point, so that's as close as the shapes get
+        if(distSquared - dot(closestPoint, newVertex.w) <= GJK_RELATIVE_TOLERANCE * distSquared)
+            break;
+        maxLengthSquared = CLAMP_ABOVE(maxLengthSquared, lengthSquared(newVertex.w));
+
+        Simplex previousSimplex = *simplex;
+        simplex->vertices[simplex->numVertices] = newVertex;
+        simplex->numVertices++;
+        if(simplex->numVertices == 2)
+            solveSimplexEdge(simplex);
+        else if(simplex->numVertices == 3)
+            solveSimplexTriangle(simplex);
+        else if(solveSimplexTetrahedron(simplex))
+            return true;
+
+        // Rounding can stop it making progress near the end, keep the last good simplex
+        vec3 newClosestPoint = getClosestPoint(*simplex);
+        if(lengthSquared(newClosestPoint) >= distSquared) {
+            *simplex = previousSimplex;
+            break;
+        }
+        closestPoint = newClosestPoint;
+    }
+    return false;
+}
+
+// Adds vertices to the simplex GJK finished with until it's a tetrahedron,
+// so EPA has a volume to expand. Returns false if the shapes' Minkowski
+// difference is flat (e.g. two spheres, or capsules lying on top of each
+// other) and writes a direction the shapes have no depth in to `flatNormal`.
+static bool completeEpaTetrahedron(const ConvexShape &a, const ConvexShape &b, SimplexVertex* vertices, u32* numVertices, float tolerance, vec3* flatNormal)
+{
+    static const vec3 AXES[3] = { {1, 0, 0}, {0, 1, 0}, {0, 0, 1} };
+    float toleranceSquared = tolerance * tolerance;
+
+    if(*numVertices == 1)
+    {
+        *flatNormal = AXES[0];
+        for(u32 i=0; i<6 && *numVertices == 1; ++i) {
+            vec3 dir = (i & 1) ? -AXES[i/2] : AXES[i/2];
+            SimplexVertex vertex = findMinkowskiSupport(a, b, dir);
+            if(lengthSquared(vertex.w - vertices[0].w) > toleranceSquared)
+                vertices[(*numVertices)++] = vertex;
+        }
+        if(*numVertices == 1)
+            return false;
+    }
+
+    if(*numVertices == 2)
+    {
+        vec3 line = normalise(vertices[1].w - vertices[0].w);
+        // Use the axis least like the line to find perpendicular directions
+        u32 axis = 0;
+        if(fabsf(line.y) < fabsf(line.x)) axis = 1;
+        if(fabsf(line.z) < fabsf(axis == 0 ? line.x : line.y)) axis = 2;
+        vec3 perpendicular0 = normalise(cross(line, AXES[axis]));
+        vec3 perpendicular1 = cross(line, perpendicular0);
+        vec3 dirs[4] = { perpendicular0, -perpendicular0, perpendicular1, -perpendicular1 };
+        *flatNormal = perpendicular0;
+        for(u32 i=0; i<4 && *numVertices == 2; ++i) {
+            SimplexVertex vertex = findMinkowskiSupport(a, b, dirs[i]);
+            if(lengthSquared(cross(vertex.w - vertices[0].w, line)) > toleranceSquared)
+                vertices[(*numVertices)++] = vertex;
+            else if(i == 1)
+                *flatNormal = perpendicular1;
+        }
+        if(*numVertices == 2)
+            return false;
+    }
+
+    if(*numVertices == 3)
+    {
+        vec3 normal = cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w);
+        if(lengthSquared(normal) <= toleranceSquared * toleranceSquared) {
+            // Too thin to be a triangle, start again from one of its edges
+            *numVertices = 2;
+            return completeEpaTetrahedron(a, b, vertices, numVertices, tolerance, flatNormal);
+        }
+        normal = normalise(normal);
+        *flatNormal = normal;
+        for(u32 i=0; i<2 && *numVertices == 3; ++i) {
+            SimplexVertex vertex = findMinkowskiSupport(a, b, i ? -normal : normal);
+            if(fabsf(dot(vertex.w - vertices[0].w, normal)) > tolerance)
+                vertices[(*numVertices)++] = vertex;
+        }
+        if(*numVertices == 3)
+            return false;
+    }
+    return true;
+}
+
+struct EpaFace
+{
+    u32 indices[3];
+    vec3 normal; // Points out of the polytope
+    float distance; // From the origin to the face's plane
+};
+
+struct EpaEdge
+{
+    u32 indices[2];
+};
+
+static EpaFace makeEpaFace(const SimplexVertex* vertices, u32 i0, u32 i1, u32 i2)
+{
+    EpaFace face;
+    face.indices[0] = i0;
+    face.indices[1] = i1;
+    face.indices[2] = i2;
+    vec3 normal = cross(vertices[i1].w - vertices[i0].w, vertices[i2].w - vertices[i0].w);
+    float normalLength = length(normal);
+    if(normalLength > 0) {
+        face.normal = normal / normalLength;
+        face.distance = dot(face.normal, vertices[i0].w);
+    }
+    else {
+        // Degenerate, never the closest face
+        face.normal = {};
+        face.distance = 1E+37;
+    }
+    return face;
+}
+
+static bool epaFacesShareEdge(const EpaFace &a, const EpaFace &b)
+{
+    // Neighbouring faces have the shared edge the opposite way round
+    for(u32 i=0; i<3; ++i) {
+        for(u32 j=0; j<3; ++j) {
+            if(a.indices[i] == b.indices[(j+1)%3] && a.indices[(i+1)%3] == b.indices[j])
+                return true;
+        }
+    }
+    return false;
+}
+
+// Adds the edge to the horizon, or removes it if its twin is already there,
+// i.e. it's between two faces that are both being removed
+static void addHorizonEdge(EpaEdge* edges, u32* numEdges, u32 i0, u32 i1)
+{
+    for(u32 i=0; i<*numEdges; ++i) {
+        if(edges[i].indices[0] == i1 && edges[i].indices[1] == i0) {
+            edges[i] = edges[--(*numEdges)];
+            return;
+        }
+    }
+    edges[*numEdges].indices[0] = i0;
+    edges[*numEdges].indices[1] = i1;
+    (*numEdges)++;
+}
+
+// Expands a polytope inside the shapes' Minkowski difference (which contains
+// the origin) towards its surface until the face closest to the origin is on
+// it. That face's normal and distance are the penetration normal and depth,
+// for the shapes without their margins.
+// Returns false if the Minkowski difference is flat, see completeEpaTetrahedron().
+static bool runEpa(const ConvexShape &a, const ConvexShape &b, const Simplex &simplex, vec3* normal, float* depth)
+{
+    SimplexVertex vertices[EPA_MAX_VERTICES];
+    u32 numVertices = simplex.numVertices;
+    float maxLengthSquared = 0;
+    for(u32 i=0; i<numVertices; ++i) {
+        vertices[i] = simplex.vertices[i];
+        maxLengthSquared = CLAMP_ABOVE(maxLengthSquared, lengthSquared(vertices[i].w));
+    }
+    // The simplex can be tiny when the shapes only just touch, so
+    // include the shapes themselves in their size
+    vec3 extent = findMinkowskiSupport(a, b, vec3{1, 0, 0}).w - findMinkowskiSupport(a, b, vec3{-1, 0, 0}).w;
+    float tolerance = EPA_TOLERANCE * CLAMP_ABOVE(sqrtf(maxLengthSquared), length(extent));
+
+    vec3 flatNormal;
+    if(!completeEpaTetrahedron(a, b, vertices, &numVertices, tolerance, &flatNormal)) {
+        // Point it from a to b, like the normals of a - b's faces nearest the origin
+        if(dot(flatNormal, getShapeCenter(b) - getShapeCenter(a)) < 0)
+            flatNormal = -flatNormal;
+        *normal = flatNormal;
+        *depth = 0;
+        return false;
+    }
+
+    // Wind the faces so their normals point outwards
+    if(dot(cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w), vertices[3].w - vertices[0].w) > 0) {
+        SimplexVertex temp = vertices[1];
+        vertices[1] = vertices[2];
+        vertices[2] = temp;
+    }
+    EpaFace faces[EPA_MAX_FACES];
+    u32 numFaces = 4;
+    faces[0] = makeEpaFace(vertices, 0, 1, 2);
+    faces[1] = makeEpaFace(vertices, 0, 3, 1);
+    faces[2] = makeEpaFace(vertices, 0, 2, 3);
+    faces[3] = makeEpaFace(vertices, 1, 3, 2);
+
+    u32 closestFace = 0;
+    for(u32 iteration=0; iteration<EPA_MAX_ITERATIONS; ++iteration)
+    {
+        closestFace = 0;
+        for(u32 i=1; i<numFaces; ++i) {
+            if(faces[i].distance < faces[closestFace].distance)
+                closestFace = i;
+        }
+
+        SimplexVertex newVertex = findMinkowskiSupport(a, b, faces[closestFace].normal);
+        // The closest face is on the surface, or as near as makes no difference
+        if(dot(newVertex.w, faces[closestFace].normal) - faces[closestFace].distance <= tolerance)
+            break;
+        if(numVertices == EPA_MAX_VERTICES)
+            break;
+
+        // Remove the faces the new vertex is in front of, leaving a hole
+        // bounded by the horizon edges, and fill it with faces to the new vertex.
+        // NOTE: Only faces connected to the closest face are removed. On curved
+        // shapes rounding can make a face elsewhere look visible too, and
+        // removing that would leave two holes and break the polytope.
+        bool isRemoved[EPA_MAX_FACES] = {};
+        isRemoved[closestFace] = true;
+        bool removedAny = true;
+        while(removedAny)
+        {
+            removedAny = false;
+            for(u32 i=0; i<numFaces; ++i)
+            {
+                const EpaFace &face = faces[i];
+                if(isRemoved[i] || dot(face.normal, newVertex.w - vertices[face.indices[0]].w) <= 0)
+                    continue;
+                for(u32 j=0; j<numFaces; ++j) {
+                    if(isRemoved[j] && epaFacesShareEdge(face, faces[j])) {
+                        isRemoved[i] = true;
+                        removedAny = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        EpaEdge edges[3 * EPA_MAX_FACES];
+        u32 numEdges = 0;
+        u32 numKeptFaces = 0;
+        for(u32 i=0; i<numFaces; ++i)
+        {
+            const EpaFace &face = faces[i];
+            if(isRemoved[i]) {
+                addHorizonEdge(edges, &numEdges, face.indices[0], face.indices[1]);
+                addHorizonEdge(edges, &numEdges, face.indices[1], face.indices[2]);
+                addHorizonEdge(edges, &numEdges, face.indices[2], face.indices[0]);
+            }
+            else {
+                ++numKeptFaces;
+            }
+        }
+        // Out of room, settle for the closest face so far
+        if(numKeptFaces + numEdges > EPA_MAX_FACES)
+            break;
+
+        numKeptFaces = 0;
+        for(u32 i=0; i<numFaces; ++i) {
+            if(!isRemoved[i])
+                faces[numKeptFaces++] = faces[i];
+        }
+        numFaces = numKeptFaces;
+        u32 newIndex = numVertices++;
+        vertices[newIndex] = newVertex;
+        for(u32 i=0; i<numEdges; ++i)
+            faces[numFaces++] = makeEpaFace(vertices, edges[i].indices[0], edges[i].indices[1], newIndex);
+    }
+
+    // Faces were added after the last search if it ran out of iterations
+    closestFace = 0;
+    for(u32 i=1; i<numFaces; ++i) {
+        if(faces[i].distance < faces[closestFace].distance)
+            closestFace = i;
+    }
+    *normal = faces[closestFace].normal;
+    *depth = CLAMP_ABOVE(faces[closestFace].distance, 0.f);
+    return true;
+}
+
+GjkDistanceResult findDistanceGjk(const ConvexShape &a, const ConvexShape &b)
+{
+    GjkDistanceResult result = {};
+    result.isIntersecting = true;
+
+    Simplex simplex;
+    if(runGjk(a, b, &simplex))
+        return result;
+
+    vec3 closestA, closestB;
+    getClosestPointsOnShapes(simplex, &closestA, &closestB);
+    vec3 offset = closestA - closestB;
+    float distance = length(offset);
+    float marginA = getShapeMargin(a);
+    float marginB = getShapeMargin(b);
+    if(distance <= marginA + marginB)
+        return result;
+
+    // Move the closest points out from the point/segments to the surfaces
+    vec3 normal = offset / distance;
+    result.isIntersecting = false;
+    result.distance = distance - marginA - marginB;
+    result.closestPointA = closestA - normal * marginA;
+    result.closestPointB = closestB + normal * marginB;
+    return result;
+}
+
+CollisionResult checkCollisionGjk(const ConvexShape &a, const ConvexShape &b)
+{
+    CollisionResult result = {};
+    float margin = getShapeMargin(a) + getShapeMargin(b);
+
+    Simplex simplex;
+    if(!runGjk(a, b, &simplex))
+    {
+        // Only the margins can overlap
+        vec3 closestA, closestB;
+        getClosestPointsOnShapes(simplex, &closestA, &closestB);
+        vec3 offset = closestA - closestB;
+        float distance = length(offset);
+        if(distance < margin)
+            result = {true, margin - distance, offset / distance};
+        return result;
+    }
+
+    // EPA's normal points out of the Minkowski difference a - b, so `a`
+    // has to move the opposite way to get out of `b`
+    vec3 normal;
+    float depth;
+    runEpa(a, b, simplex, &normal, &depth);
+    result = {true, depth + margin, -normal};
+    return result;
+}
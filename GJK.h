@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types.h"
+#include "3DMaths.h"
+#include "Collision.h"
+
+// Narrowphase for any pair of convex shapes, using GJK (Gilbert-Johnson-Keerthi)
+// to find the distance between them and EPA (Expanding Polytope Algorithm)
+// for the penetration depth and normal when they overlap. Both only ever
+// ask a shape for its furthest point in some direction, so any pair of
+// shape types works without a dedicated checkCollision() overload.
+//
+// Spheres and capsules are treated as a point and a line segment with a
+// radius around them: GJK finds the distance between those and the radius
+// is taken off afterwards, so the rounded surfaces never need iterating
+// towards and EPA is only needed when the inner point/segments overlap.
+//
+// Polyhedra use their world space vertices, so call
+// updateColliderWorldSpace() first. Each support query is one pass over
+// the vertices and GJK usually needs a handful, so unlike the separating
+// axis tests the cost doesn't grow with the number of planes and edges.
+//
+// Usage:
+// ConvexShape a = makeConvexShape(playerCapsule);
+// ConvexShape b = makeConvexShape(cubeCollider);
+// CollisionResult result = checkCollisionGjk(a, b);
+// if(result.isColliding)
+//     playerPos += result.normal * result.penetrationDistance;
+// ...
+// GjkDistanceResult distance = findDistanceGjk(a, b);
+// if(!distance.isIntersecting && distance.distance < 0.1f)
+//     ... // Close enough to grab
+
+enum ConvexShapeType
+{
+    ConvexShapeType_POLYHEDRON,
+    ConvexShapeType_SPHERE,
+    ConvexShapeType_CAPSULE,
+    ConvexShapeType_CYLINDER
+};
+
+struct ConvexShape
+{
+    ConvexShapeType type;
+    const ColliderPolyhedron* polyhedron; // Not copied, keep it alive while using the shape
+    // The sphere's center is p0 and p1
+    vec3 p0;
+    vec3 p1;
+    float radius;
+};
+
+ConvexShape makeConvexShape(const ColliderPolyhedron &poly);
+ConvexShape makeConvexShape(const ColliderSphere &sphere);
+ConvexShape makeConvexShape(const ColliderCapsule &capsule);
+ConvexShape makeConvexShape(const ColliderCylinder &cylinder);
+
+struct GjkDistanceResult
+{
+    bool isIntersecting;
+    float distance; // Between the surfaces, 0 when intersecting
+    // Closest points on the surface of each shape, only set when not intersecting
+    vec3 closestPointA;
+    vec3 closestPointB;
+};
+
+GjkDistanceResult findDistanceGjk(const ConvexShape &a, const ConvexShape &b);
+
+// Same convention as checkCollision(): moving `a` along normal by
+// penetrationDistance separates the shapes
+CollisionResult checkCollisionGjk(const ConvexShape &a, const ConvexShape &b);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // memcpy()
+
+// Fast non-cryptographic 64-bit hash, processes 8 bytes at a time.
+// Good enough for checksums and content-addressing, not for security.
+
+inline uint64_t hashMix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t hashBytes64(const void* data, size_t numBytes, uint64_t seed = 0)
+{
+    const uint64_t PRIME = 0x9E3779B185EBCA87ull;
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t h = seed ^ (numBytes * PRIME);
+
+    size_t numWords = numBytes / 8;
+    for(size_t i=0; i<numWords; ++i)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i*8, 8);
+        h = (h ^ hashMix64(word)) * PRIME;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + numWords*8, numBytes - numWords*8);
+    h = (h ^ hashMix64(tail)) * PRIME;
+
+    return hashMix64(h);
+}
@@ -0,0 +1,587 @@
+#include "MeshCompression.h"
+
+#include <assert.h>
+#include <string.h>
+
+// Index codec
+
+#define INDEX_CODEC_VERSION 0xe1
+
+// Both FIFOs have 16 slots, but a code can only reach 15 of the edges and
+// 14 of the vertices since the other values of each nibble are used as flags
+#define INDEX_FIFO_SIZE 16
+
+// High nibble of a triangle's code when none of its edges are in the FIFO
+#define INDEX_CODE_NO_EDGE 15
+
+// Vertex codes, 1-14 are positions in the vertex FIFO
+#define VERTEX_CODE_NEXT 0 // The next vertex that hasn't been used yet
+#define VERTEX_CODE_EXPLICIT 15 // Delta from the last explicit vertex follows
+
+// Triangle layout:
+//   1 byte code: edge FIFO position (or INDEX_CODE_NO_EDGE) << 4 | vertex code
+//   If there was no edge, 1 more byte with the vertex codes of the second
+//   and third corners.
+//   A varint for each corner coded as VERTEX_CODE_EXPLICIT
+//
+// Codes for the whole buffer come first, then the extra bytes, so the
+// decoder can walk both streams forwards.
+struct IndexCodecState
+{
+    uint32_t edgeFifo[INDEX_FIFO_SIZE][2];
+    uint32_t vertexFifo[INDEX_FIFO_SIZE];
+    uint32_t edgeFifoOffset;
+    uint32_t vertexFifoOffset;
+    uint32_t nextVertex; // One more than the highest VERTEX_CODE_NEXT vertex so far
+    uint32_t lastExplicitVertex;
+};
+
+static void initIndexCodecState(IndexCodecState* state)
+{
+    // Vertex 0xffffffff can't exist, so empty slots never match
+    memset(state, 0xff, sizeof(*state));
+    state->edgeFifoOffset = 0;
+    state->vertexFifoOffset = 0;
+    state->nextVertex = 0;
+    state->lastExplicitVertex = 0;
+}
+
+static void pushEdge(IndexCodecState* state, uint32_t a, uint32_t b)
+{
+    uint32_t* slot = state->edgeFifo[state->edgeFifoOffset & (INDEX_FIFO_SIZE - 1)];
+    slot[0] = a;
+    slot[1] = b;
+    ++state->edgeFifoOffset;
+}
+
+static void pushVertex(IndexCodecState* state, uint32_t v)
+{
+    state->vertexFifo[state->vertexFifoOffset & (INDEX_FIFO_SIZE - 1)] = v;
+    ++state->vertexFifoOffset;
+}
+
+// A neighbouring triangle uses a shared edge in the opposite direction,
+// so edges go in the FIFO backwards
+static void pushTriangleEdges(IndexCodecState* state, uint32_t a, uint32_t b, uint32_t c)
+{
+    pushEdge(state, b, a);
+    pushEdge(state, c, b);
+    pushEdge(state, a, c);
+}
+
+static uint32_t zigzagEncode(int32_t x)
+{
+    return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+static int32_t zigzagDecode(uint32_t x)
+{
+    return (int32_t)(x >> 1) ^ -(int32_t)(x & 1);
+}
+
+static uint8_t* writeVarint(uint8_t* s, uint32_t x)
+{
+    while(x >= 0x80) {
+        *s++ = (uint8_t)(x | 0x80);
+        x >>= 7;
+    }
+    *s++ = (uint8_t)x;
+    return s;
+}
+
+static const uint8_t* readVarint(const uint8_t* s, const uint8_t* end, uint32_t* result)
+{
+    uint32_t x = 0;
+    for(uint32_t shift=0; shift<35; shift+=7)
+    {
+        if(s == end)
+            return NULL;
+        uint8_t byte = *s++;
+        x |= (uint32_t)(byte & 0x7f) << shift;
+        if(byte < 0x80) {
+            *result = x;
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t encodeVertex(IndexCodecState* state, uint32_t v, uint8_t** data)
+{
+    if(v == state->nextVertex) {
+        ++state->nextVertex;
+        pushVertex(state, v);
+        return VERTEX_CODE_NEXT;
+    }
+    for(uint32_t code=1; code<VERTEX_CODE_EXPLICIT; ++code) {
+        if(state->vertexFifo[(state->vertexFifoOffset - code) & (INDEX_FIFO_SIZE - 1)] == v)
+            return code;
+    }
+    *data = writeVarint(*data, zigzagEncode((int32_t)(v - state->lastExplicitVertex)));
+    state->lastExplicitVertex = v;
+    pushVertex(state, v);
+    return VERTEX_CODE_EXPLICIT;
+}
+
+// Returns false if the extra data runs out
+static bool decodeVertex(IndexCodecState* state, uint32_t code, const uint8_t** data, const uint8_t* dataEnd, uint32_t* v)
+{
+    if(code == VERTEX_CODE_NEXT) {
+        *v = state->nextVertex++;
+        pushVertex(state, *v);
+    }
+    else if(code == VERTEX_CODE_EXPLICIT) {
+        uint32_t delta;
+        *data = readVarint(*data, dataEnd, &delta);
+        if(!*data)
+            return false;
+        *v = state->lastExplicitVertex + (uint32_t)zigzagDecode(delta);
+        state->lastExplicitVertex = *v;
+        pushVertex(state, *v);
+    }
+    else {
+        *v = state->vertexFifo[(state->vertexFifoOffset - code) & (INDEX_FIFO_SIZE - 1)];
+    }
+    return true;
+}
+
+static uint32_t readIndex(const void* indices, uint32_t bytesPerIndex, uint32_t i)
+{
+    return (bytesPerIndex == 2) ? ((const uint16_t*)indices)[i] : ((const uint32_t*)indices)[i];
+}
+
+size_t getIndexBufferEncodeBound(uint32_t numIndices)
+{
+    // Worst case is a triangle with no edge match and three explicit vertices
+    size_t maxTriangleSize = 2 + 3*5;
+    return 1 + (size_t)(numIndices / 3) * maxTriangleSize;
+}
+
+size_t encodeIndexBuffer(uint8_t* dst, size_t dstCapacity, const void* indices, uint32_t numIndices, uint32_t bytesPerIndex)
+{
+    assert(numIndices % 3 == 0);
+    assert(bytesPerIndex == 2 || bytesPerIndex == 4);
+    uint32_t numTriangles = numIndices / 3;
+
+    // Codes are written up front and extra data as it's produced, checking
+    // the capacity against the worst case saves checking every write
+    if(dstCapacity < getIndexBufferEncodeBound(numIndices))
+        return 0;
+    uint8_t* codes = dst + 1;
+    uint8_t* data = codes + numTriangles;
+    dst[0] = INDEX_CODEC_VERSION;
+
+    IndexCodecState state;
+    initIndexCodecState(&state);
+    for(uint32_t t=0; t<numTriangles; ++t)
+    {
+        uint32_t triangle[3] = {
+            readIndex(indices, bytesPerIndex, 3*t),
+            readIndex(indices, bytesPerIndex, 3*t + 1),
+            readIndex(indices, bytesPerIndex, 3*t + 2)
+        };
+
+        // Look for a recent edge matching any of the triangle's edges
+        uint32_t edgeCode = INDEX_CODE_NO_EDGE;
+        uint32_t rotation = 0;
+        for(uint32_t e=0; e<INDEX_CODE_NO_EDGE && edgeCode == INDEX_CODE_NO_EDGE; ++e)
+        {
+            const uint32_t* edge = state.edgeFifo[(state.edgeFifoOffset - 1 - e) & (INDEX_FIFO_SIZE - 1)];
+            for(uint32_t r=0; r<3; ++r) {
+                if(edge[0] == triangle[r] && edge[1] == triangle[(r + 1) % 3]) {
+                    edgeCode = e;
+                    rotation = r;
+                    break;
+                }
+            }
+        }
+
+        if(edgeCode != INDEX_CODE_NO_EDGE)
+        {
+            uint32_t a = triangle[rotation];
+            uint32_t b = triangle[(rotation + 1) % 3];
+            uint32_t c = triangle[(rotation + 2) % 3];
+            uint32_t vertexCode = encodeVertex(&state, c, &data);
+            codes[t] = (uint8_t)((edgeCode << 4) | vertexCode);
+            pushEdge(&state, c, b);
+            pushEdge(&state, a, c);
+        }
+        else
+        {
+            uint32_t a = triangle[0], b = triangle[1], c = triangle[2];
+            uint8_t* extra = data++;
+            uint32_t codeA = encodeVertex(&state, a, &data);
+            uint32_t codeB = encodeVertex(&state, b, &data);
+            uint32_t codeC = encodeVertex(&state, c, &data);
+            codes[t] = (uint8_t)((INDEX_CODE_NO_EDGE << 4) | codeA);
+            *extra = (uint8_t)((codeB << 4) | codeC);
+            pushTriangleEdges(&state, a, b, c);
+        }
+    }
+    return data - dst;
+}
+
+bool decodeIndexBuffer(void* indices, uint32_t numIndices, uint32_t bytesPerIndex, const uint8_t* src, size_t srcSize)
+{
+    assert(bytesPerIndex == 2 || bytesPerIndex == 4);
+    uint32_t numTriangles = numIndices / 3;
+    if(numIndices % 3 != 0 || srcSize < 1 + (size_t)numTriangles || src[0] != INDEX_CODEC_VERSION)
+        return false;
+
+    const uint8_t* codes = src + 1;
+    const uint8_t* data = codes + numTriangles;
+    const uint8_t* dataEnd = src + srcSize;
+    // 0xffffffff also catches edges and vertices read from empty FIFO slots
+    uint32_t maxIndex = (bytesPerIndex == 2) ? 0xffff : 0xfffffffe;
+
+    IndexCodecState state;
+    initIndexCodecState(&state);
+    for(uint32_t t=0; t<numTriangles; ++t)
+    {
+        uint32_t code = codes[t];
+        uint32_t edgeCode = code >> 4;
+        uint32_t a, b, c;
+        if(edgeCode != INDEX_CODE_NO_EDGE)
+        {
+            const uint32_t* edge = state.edgeFifo[(state.edgeFifoOffset - 1 - edgeCode) & (INDEX_FIFO_SIZE - 1)];
+            a = edge[0];
+            b = edge[1];
+            if(!decodeVertex(&state, code & 15, &data, dataEnd, &c))
+                return false;
+            pushEdge(&state, c, b);
+            pushEdge(&state, a, c);
+        }
+        else
+        {
+            if(data == dataEnd)
+                return false;
+            uint32_t extra = *data++;
+            if(!decodeVertex(&state, code & 15, &data, dataEnd, &a)
+                || !decodeVertex(&state, extra >> 4, &data, dataEnd, &b)
+                || !decodeVertex(&state, extra & 15, &data, dataEnd, &c))
+                return false;
+            pushTriangleEdges(&state, a, b, c);
+        }
+
+        if(a > maxIndex || b > maxIndex || c > maxIndex)
+            return false;
+        if(bytesPerIndex == 2) {
+            uint16_t* triangle = (uint16_t*)indices + 3*t;
+            triangle[0] = (uint16_t)a; triangle[1] = (uint16_t)b; triangle[2] = (uint16_t)c;
+        }
+        else {
+            uint32_t* triangle = (uint32_t*)indices + 3*t;
+            triangle[0] = a; triangle[1] = b; triangle[2] = c;
+        }
+    }
+    return data == dataEnd;
+}
+
+// Vertex codec
+
+#define VERTEX_CODEC_VERSION 0xa1
+
+// Vertices per block. A block's planes fit in L1 cache when decoding.
+#define VERTEX_BLOCK_SIZE 256
+// Values packed with the same number of bits
+#define VERTEX_GROUP_SIZE 16
+
+// How each group is packed, 2 bits per group in each plane's header
+enum VertexGroupMode
+{
+    VertexGroupMode_ZERO, // All zero, no data
+    VertexGroupMode_BITS2, // 4 bytes
+    VertexGroupMode_BITS4, // 8 bytes
+    VertexGroupMode_BITS8 // 16 bytes
+};
+
+static const uint32_t vertexGroupModeSizes[4] = { 0, 4, 8, 16 };
+
+// Block layout, for each byte of the vertex:
+//   Group modes, 4 to a byte with the first group in the low bits
+//   Packed groups, with the first value of each byte in the low bits
+//
+// Values are the zigzag-coded difference from the same byte of the previous
+// vertex (which carries across blocks), so small changes either way take
+// few bits.
+
+static size_t getVertexPlaneMaxSize(uint32_t numGroups)
+{
+    return (numGroups + 3) / 4 + numGroups * VERTEX_GROUP_SIZE;
+}
+
+size_t getVertexBufferEncodeBound(uint32_t numVertices, uint32_t vertexSize)
+{
+    uint32_t numFullBlocks = numVertices / VERTEX_BLOCK_SIZE;
+    uint32_t lastBlockNumVertices = numVertices % VERTEX_BLOCK_SIZE;
+    size_t fullBlockSize = getVertexPlaneMaxSize(VERTEX_BLOCK_SIZE / VERTEX_GROUP_SIZE);
+    size_t lastBlockSize = getVertexPlaneMaxSize((lastBlockNumVertices + VERTEX_GROUP_SIZE - 1) / VERTEX_GROUP_SIZE);
+    return 1 + vertexSize * (numFullBlocks * fullBlockSize + lastBlockSize);
+}
+
+static uint8_t* encodeVertexGroup(uint8_t* s, const uint8_t* values, uint32_t mode)
+{
+    switch(mode)
+    {
+        case VertexGroupMode_ZERO: break;
+        case VertexGroupMode_BITS2:
+            for(uint32_t i=0; i<VERTEX_GROUP_SIZE; i+=4)
+                *s++ = (uint8_t)(values[i] | (values[i+1] << 2) | (values[i+2] << 4) | (values[i+3] << 6));
+            break;
+        case VertexGroupMode_BITS4:
+            for(uint32_t i=0; i<VERTEX_GROUP_SIZE; i+=2)
+                *s++ = (uint8_t)(values[i] | (values[i+1] << 4));
+            break;
+        case VertexGroupMode_BITS8:
+            memcpy(s, values, VERTEX_GROUP_SIZE);
+            s += VERTEX_GROUP_SIZE;
+            break;
+    }
+    return s;
+}
+
+size_t encodeVertexBuffer(uint8_t* dst, size_t dstCapacity, const void* vertices, uint32_t numVertices, uint32_t vertexSize)
+{
+    assert(vertexSize > 0 && vertexSize <= VERTEX_CODEC_MAX_VERTEX_SIZE);
+    if(dstCapacity < getVertexBufferEncodeBound(numVertices, vertexSize))
+        return 0;
+
+    const uint8_t* vertexBytes = (const uint8_t*)vertices;
+    uint8_t* s = dst;
+    *s++ = VERTEX_CODEC_VERSION;
+
+    uint8_t lastVertex[VERTEX_CODEC_MAX_VERTEX_SIZE] = {};
+    for(uint32_t blockStart=0; blockStart<numVertices; blockStart+=VERTEX_BLOCK_SIZE)
+    {
+        uint32_t blockNumVertices = numVertices - blockStart;
+        if(blockNumVertices > VERTEX_BLOCK_SIZE)
+            blockNumVertices = VERTEX_BLOCK_SIZE;
+        uint32_t numGroups = (blockNumVertices + VERTEX_GROUP_SIZE - 1) / VERTEX_GROUP_SIZE;
+
+        for(uint32_t k=0; k<vertexSize; ++k)
+        {
+            // Padding past the end of the buffer is zero so it packs for free
+            uint8_t values[VERTEX_BLOCK_SIZE] = {};
+            uint8_t previous = lastVertex[k];
+            for(uint32_t i=0; i<blockNumVertices; ++i)
+            {
+                uint8_t byte = vertexBytes[(size_t)(blockStart + i) * vertexSize + k];
+                uint8_t delta = (uint8_t)(byte - previous);
+                values[i] = (uint8_t)((delta << 1) ^ ((int8_t)delta >> 7));
+                previous = byte;
+            }
+            lastVertex[k] = previous;
+
+            uint8_t* modes = s;
+            s += (numGroups + 3) / 4;
+            memset(modes, 0, s - modes);
+            for(uint32_t g=0; g<numGroups; ++g)
+            {
+                const uint8_t* group = values + g * VERTEX_GROUP_SIZE;
+                uint8_t maxValue = 0;
+                for(uint32_t i=0; i<VERTEX_GROUP_SIZE; ++i)
+                    maxValue |= group[i];
+                uint32_t mode = (maxValue == 0) ? VertexGroupMode_ZERO
+                    : (maxValue < 4) ? VertexGroupMode_BITS2
+                    : (maxValue < 16) ? VertexGroupMode_BITS4
+                    : VertexGroupMode_BITS8;
+                modes[g / 4] |= (uint8_t)(mode << ((g % 4) * 2));
+                s = encodeVertexGroup(s, group, mode);
+            }
+        }
+    }
+    return s - dst;
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VERTEX_CODEC_SSE2
+#endif
+
+#ifdef VERTEX_CODEC_SSE2
+
+// Unpacks a group into 16 zigzag-coded values
+static __m128i decodeVertexGroup(const uint8_t* s, uint32_t mode)
+{
+    switch(mode)
+    {
+        case VertexGroupMode_BITS2:
+        {
+            int32_t packed;
+            memcpy(&packed, s, 4);
+            __m128i bytes = _mm_cvtsi32_si128(packed);
+            __m128i mask = _mm_set1_epi8(3);
+            // 16-bit shifts leak bits between bytes, the mask clears them
+            __m128i v0 = _mm_and_si128(bytes, mask);
+            __m128i v1 = _mm_and_si128(_mm_srli_epi16(bytes, 2), mask);
+            __m128i v2 = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+            __m128i v3 = _mm_and_si128(_mm_srli_epi16(bytes, 6), mask);
+            return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+        }
+        case VertexGroupMode_BITS4:
+        {
+            __m128i bytes = _mm_loadl_epi64((const __m128i*)s);
+            __m128i mask = _mm_set1_epi8(15);
+            __m128i low = _mm_and_si128(bytes, mask);
+            __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+            return _mm_unpacklo_epi8(low, high);
+        }
+        case VertexGroupMode_BITS8: return _mm_loadu_si128((const __m128i*)s);
+        default: return _mm_setzero_si128();
+    }
+}
+
+// Undoes the zigzag and delta coding of 16 values, `previous` holds the
+// byte before them in every lane and is updated to the last one
+static __m128i unpackVertexDeltas(__m128i values, __m128i* previous)
+{
+    __m128i one = _mm_set1_epi8(1);
+    __m128i halved = _mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(0x7f));
+    __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, one));
+    __m128i x = _mm_xor_si128(halved, sign);
+
+    // Prefix sum in log2(16) steps
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi8(x, *previous);
+
+    // Broadcast the last byte
+    __m128i last = _mm_unpackhi_epi8(x, x);
+    last = _mm_shufflehi_epi16(last, 0xff);
+    *previous = _mm_shuffle_epi32(last, 0xff);
+    return x;
+}
+
+#else
+
+static void decodeVertexGroup(const uint8_t* s, uint32_t mode, uint8_t* values)
+{
+    switch(mode)
+    {
+        case VertexGroupMode_BITS2:
+            for(uint32_t i=0; i<VERTEX_GROUP_SIZE; ++i)
+                values[i] = (s[i / 4] >> ((i % 4) * 2)) & 3;
+            break;
+        case VertexGroupMode_BITS4:
+            for(uint32_t i=0; i<VERTEX_GROUP_SIZE; ++i)
+                values[i] = (s[i / 2] >> ((i % 2) * 4)) & 15;
+            break;
+        case VertexGroupMode_BITS8:
+            memcpy(values, s, VERTEX_GROUP_SIZE);
+            break;
+        default:
+            memset(values, 0, VERTEX_GROUP_SIZE);
+    }
+}
+
+#endif
+
+// Copies a block's planes into interleaved vertices
+static void transposeVertexPlanes(uint8_t (*planes)[VERTEX_BLOCK_SIZE], uint32_t numVertices, uint32_t vertexSize, uint8_t* vertices)
+{
+    uint32_t i = 0;
+#ifdef VERTEX_CODEC_SSE2
+    // 4 planes of 16 vertices at a time, storing 4 bytes per vertex
+    if(vertexSize % 4 == 0)
+    {
+        for(; i + VERTEX_GROUP_SIZE <= numVertices; i += VERTEX_GROUP_SIZE)
+        {
+            for(uint32_t k=0; k<vertexSize; k+=4)
+            {
+                __m128i p0 = _mm_loadu_si128((const __m128i*)(planes[k] + i));
+                __m128i p1 = _mm_loadu_si128((const __m128i*)(planes[k+1] + i));
+                __m128i p2 = _mm_loadu_si128((const __m128i*)(planes[k+2] + i));
+                __m128i p3 = _mm_loadu_si128((const __m128i*)(planes[k+3] + i));
+                __m128i p01Low = _mm_unpacklo_epi8(p0, p1);
+                __m128i p01High = _mm_unpackhi_epi8(p0, p1);
+                __m128i p23Low = _mm_unpacklo_epi8(p2, p3);
+                __m128i p23High = _mm_unpackhi_epi8(p2, p3);
+                __m128i quads[4] = {
+                    _mm_unpacklo_epi16(p01Low, p23Low),
+                    _mm_unpackhi_epi16(p01Low, p23Low),
+                    _mm_unpacklo_epi16(p01High, p23High),
+                    _mm_unpackhi_epi16(p01High, p23High)
+                };
+                uint8_t* out = vertices + (size_t)i * vertexSize + k;
+                for(uint32_t q=0; q<4; ++q)
+                {
+                    uint32_t words[4];
+                    _mm_storeu_si128((__m128i*)words, quads[q]);
+                    for(uint32_t w=0; w<4; ++w)
+                        memcpy(out + (q*4 + w) * vertexSize, words + w, 4);
+                }
+            }
+        }
+    }
+#endif
+    for(; i<numVertices; ++i)
+        for(uint32_t k=0; k<vertexSize; ++k)
+            vertices[(size_t)i * vertexSize + k] = planes[k][i];
+}
+
+bool decodeVertexBuffer(void* vertices, uint32_t numVertices, uint32_t vertexSize, const uint8_t* src, size_t srcSize)
+{
+    if(vertexSize == 0 || vertexSize > VERTEX_CODEC_MAX_VERTEX_SIZE || srcSize < 1 || src[0] != VERTEX_CODEC_VERSION)
+        return false;
+    const uint8_t* s = src + 1;
+    const uint8_t* end = src + srcSize;
+    uint8_t* vertexBytes = (uint8_t*)vertices;
+
+    uint8_t planes[VERTEX_CODEC_MAX_VERTEX_SIZE][VERTEX_BLOCK_SIZE];
+#ifdef VERTEX_CODEC_SSE2
+    __m128i lastVertex[VERTEX_CODEC_MAX_VERTEX_SIZE];
+    for(uint32_t k=0; k<vertexSize; ++k)
+        lastVertex[k] = _mm_setzero_si128();
+#else
+    uint8_t lastVertex[VERTEX_CODEC_MAX_VERTEX_SIZE] = {};
+#endif
+
+    for(uint32_t blockStart=0; blockStart<numVertices; blockStart+=VERTEX_BLOCK_SIZE)
+    {
+        uint32_t blockNumVertices = numVertices - blockStart;
+        if(blockNumVertices > VERTEX_BLOCK_SIZE)
+            blockNumVertices = VERTEX_BLOCK_SIZE;
+        uint32_t numGroups = (blockNumVertices + VERTEX_GROUP_SIZE - 1) / VERTEX_GROUP_SIZE;
+        uint32_t numModeBytes = (numGroups + 3) / 4;
+
+        for(uint32_t k=0; k<vertexSize; ++k)
+        {
+            // Check the whole plane fits before decoding any of it
+            if((size_t)(end - s) < numModeBytes)
+                return false;
+            const uint8_t* modes = s;
+            s += numModeBytes;
+            size_t planeSize = 0;
+            for(uint32_t g=0; g<numGroups; ++g)
+                planeSize += vertexGroupModeSizes[(modes[g / 4] >> ((g % 4) * 2)) & 3];
+            if((size_t)(end - s) < planeSize)
+                return false;
+
+            for(uint32_t g=0; g<numGroups; ++g)
+            {
+                uint32_t mode = (modes[g / 4] >> ((g % 4) * 2)) & 3;
+                uint8_t* plane = planes[k] + g * VERTEX_GROUP_SIZE;
+#ifdef VERTEX_CODEC_SSE2
+                // BITS2 reads 4 bytes and BITS4 reads 8, so no overreads
+                __m128i values = decodeVertexGroup(s, mode);
+                _mm_storeu_si128((__m128i*)plane, unpackVertexDeltas(values, lastVertex + k));
+#else
+                uint8_t values[VERTEX_GROUP_SIZE];
+                decodeVertexGroup(s, mode, values);
+                uint8_t previous = lastVertex[k];
+                for(uint32_t i=0; i<VERTEX_GROUP_SIZE; ++i) {
+                    uint8_t delta = (uint8_t)((values[i] >> 1) ^ -(values[i] & 1));
+                    previous = (uint8_t)(previous + delta);
+                    plane[i] = previous;
+                }
+                lastVertex[k] = previous;
+#endif
+                s += vertexGroupModeSizes[mode];
+            }
+        }
+        transposeVertexPlanes(planes, blockNumVertices, vertexSize, vertexBytes + (size_t)blockStart * vertexSize);
+    }
+    return s == end;
+}
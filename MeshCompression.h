@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Lossless compression for vertex and index buffers, used by the .mesh
+// format (see BakedMesh.h) to make files smaller and faster to read.
+//
+// Index buffers: each triangle is coded against a short FIFO of recently
+// seen edges and another of recently seen vertices, so a triangle that
+// shares an edge with one of the last few triangles and uses a brand new
+// vertex (the common case once optimiseVertexCache() and
+// optimiseVertexFetch() have run) costs a single byte.
+// Triangles keep their order and winding but may come back starting from
+// a different corner, which doesn't change what gets drawn.
+//
+// Vertex buffers: the vertices are split into blocks and each block is
+// transposed into byte planes (all the first bytes, then all the second
+// bytes...). Each plane is delta coded against the previous vertex and
+// packed 16 values at a time into 0, 2, 4 or 8 bits each, whichever is the
+// smallest that fits. Neighbouring vertices tend to be similar so most
+// planes end up as small deltas, and the output is exactly the input.
+//
+// Usage:
+// size_t maxSize = getVertexBufferEncodeBound(numVertices, sizeof(VertexData));
+// uint8_t* encoded = (uint8_t*)malloc(maxSize);
+// size_t encodedSize = encodeVertexBuffer(encoded, maxSize, vertices, numVertices, sizeof(VertexData));
+// ... // Write to disk, read back
+// if(!decodeVertexBuffer(vertices, numVertices, sizeof(VertexData), encoded, encodedSize))
+//     ... // Corrupt data
+
+// Upper bound on the encoded size of an index buffer
+size_t getIndexBufferEncodeBound(uint32_t numIndices);
+
+// `numIndices` must be a multiple of 3. Returns the number of bytes written
+// to `dst`, or 0 if `dstCapacity` is too small.
+size_t encodeIndexBuffer(uint8_t* dst, size_t dstCapacity, const void* indices, uint32_t numIndices, uint32_t bytesPerIndex);
+
+// Returns false if `src` isn't a valid encoding of `numIndices` indices
+bool decodeIndexBuffer(void* indices, uint32_t numIndices, uint32_t bytesPerIndex, const uint8_t* src, size_t srcSize);
+
+#define VERTEX_CODEC_MAX_VERTEX_SIZE 64
+
+// Upper bound on the encoded size of a vertex buffer
+size_t getVertexBufferEncodeBound(uint32_t numVertices, uint32_t vertexSize);
+
+// `vertexSize` must be at most VERTEX_CODEC_MAX_VERTEX_SIZE. Returns the
+// number of bytes written to `dst`, or 0 if `dstCapacity` is too small.
+size_t encodeVertexBuffer(uint8_t* dst, size_t dstCapacity, const void* vertices, uint32_t numVertices, uint32_t vertexSize);
+
+// Returns false if `src` isn't a valid encoding of `numVertices` vertices
+bool decodeVertexBuffer(void* vertices, uint32_t numVertices, uint32_t vertexSize, const uint8_t* src, size_t srcSize);
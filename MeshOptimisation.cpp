@@ -0,0 +1,635 @@
+#include "MeshOptimisation.h"
+
+#include <assert.h>
+#include <math.h> // floorf(), ceilf()
+#include <stdlib.h> // qsort()
+#include <string.h>
+
+#include "ObjLoading.h"
+
+VertexCacheStats analyseVertexCache(const LoadedObj &obj, uint32_t cacheSize)
+{
+    VertexCacheStats result = {};
+
+    // FIFO cache, each entry records when the vertex was added
+    uint32_t* cacheTimestamps = (uint32_t*)calloc(obj.numVertices, sizeof(uint32_t));
+    assert(cacheTimestamps || obj.numVertices == 0);
+
+    uint32_t timestamp = cacheSize + 1;
+    for(uint32_t i=0; i<obj.numIndices; ++i)
+    {
+        uint32_t index = getIndex(obj, i);
+        if(timestamp - cacheTimestamps[index] > cacheSize) {
+            cacheTimestamps[index] = timestamp++;
+            ++result.numVertexShaderInvocations;
+        }
+    }
+    free(cacheTimestamps);
+
+    uint32_t numTriangles = obj.numIndices / 3;
+    result.acmr = numTriangles ? (float)result.numVertexShaderInvocations / numTriangles : 0;
+    result.atvr = obj.numVertices ? (float)result.numVertexShaderInvocations / obj.numVertices : 0;
+    return result;
+}
+
+// Triangles using each vertex, stored contiguously per vertex. Sized for
+// the whole mesh and rebuilt for each submesh, only the entries of the
+// vertices a submesh uses are valid.
+struct VertexTriangleAdjacency
+{
+    uint32_t* counts;
+    uint32_t* offsets;
+    uint32_t* triangles;
+    uint32_t* vertices; // Used by the submesh, in order of first use
+    uint32_t numVertices;
+};
+
+static VertexTriangleAdjacency allocateVertexTriangleAdjacency(const LoadedObj &obj)
+{
+    VertexTriangleAdjacency result;
+    result.counts = (uint32_t*)calloc(obj.numVertices, sizeof(uint32_t));
+    result.offsets = (uint32_t*)malloc(obj.numVertices * sizeof(uint32_t));
+    result.triangles = (uint32_t*)malloc(obj.numIndices * sizeof(uint32_t));
+    result.vertices = (uint32_t*)malloc(obj.numIndices * sizeof(uint32_t));
+    result.numVertices = 0;
+    assert((result.counts && result.offsets) || obj.numVertices == 0);
+    assert((result.triangles && result.vertices) || obj.numIndices == 0);
+    return result;
+}
+
+// `adjacency` must have been cleared, either freshly allocated or by clearVertexTriangleAdjacency()
+static void buildVertexTriangleAdjacency(VertexTriangleAdjacency* adjacency, const LoadedObj &submesh)
+{
+    adjacency->numVertices = 0;
+    for(uint32_t i=0; i<submesh.numIndices; ++i) {
+        uint32_t v = getIndex(submesh, i);
+        if(adjacency->counts[v]++ == 0)
+            adjacency->vertices[adjacency->numVertices++] = v;
+    }
+
+    uint32_t offset = 0;
+    for(uint32_t i=0; i<adjacency->numVertices; ++i) {
+        uint32_t v = adjacency->vertices[i];
+        adjacency->offsets[v] = offset;
+        offset += adjacency->counts[v];
+    }
+
+    // Fill in triangles, using counts as a cursor then restoring them
+    for(uint32_t i=0; i<adjacency->numVertices; ++i)
+        adjacency->counts[adjacency->vertices[i]] = 0;
+    for(uint32_t i=0; i<submesh.numIndices; ++i) {
+        uint32_t v = getIndex(submesh, i);
+        adjacency->triangles[adjacency->offsets[v] + adjacency->counts[v]++] = i / 3;
+    }
+}
+
+static void clearVertexTriangleAdjacency(VertexTriangleAdjacency* adjacency)
+{
+    for(uint32_t i=0; i<adjacency->numVertices; ++i)
+        adjacency->counts[adjacency->vertices[i]] = 0;
+    adjacency->numVertices = 0;
+}
+
+static void freeVertexTriangleAdjacency(VertexTriangleAdjacency adjacency)
+{
+    free(adjacency.counts);
+    free(adjacency.offsets);
+    free(adjacency.triangles);
+    free(adjacency.vertices);
+}
+
+// Working memory for optimiseVertexCache(), allocated once for the whole
+// mesh and shared by its submeshes so each only costs O(its own indices)
+struct VertexCacheOptimiser
+{
+    VertexTriangleAdjacency adjacency;
+    uint32_t* liveTriangles; // Number of triangles using each vertex that haven't been emitted yet
+    uint32_t* cacheTimestamps;
+    bool* emitted;
+    uint32_t* deadEndStack; // Vertices of recently emitted triangles, used to escape dead ends
+    uint32_t* candidates; // Vertices of the triangles emitted while fanning around the current vertex
+    uint32_t* newIndices;
+};
+
+static void optimiseSubmeshVertexCache(LoadedObj* submesh, VertexCacheOptimiser* optimiser, uint32_t cacheSize)
+{
+    uint32_t numTriangles = submesh->numIndices / 3;
+    if(numTriangles == 0)
+        return;
+    assert(submesh->numIndices % 3 == 0);
+
+    VertexTriangleAdjacency* adjacency = &optimiser->adjacency;
+    buildVertexTriangleAdjacency(adjacency, *submesh);
+
+    uint32_t* liveTriangles = optimiser->liveTriangles;
+    uint32_t* cacheTimestamps = optimiser->cacheTimestamps;
+    for(uint32_t i=0; i<adjacency->numVertices; ++i) {
+        uint32_t v = adjacency->vertices[i];
+        liveTriangles[v] = adjacency->counts[v];
+        cacheTimestamps[v] = 0;
+    }
+
+    bool* emitted = optimiser->emitted;
+    memset(emitted, 0, numTriangles * sizeof(bool));
+
+    uint32_t* deadEndStack = optimiser->deadEndStack;
+    uint32_t deadEndStackSize = 0;
+    uint32_t* candidates = optimiser->candidates;
+    uint32_t* newIndices = optimiser->newIndices;
+    uint32_t numNewIndices = 0;
+
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t inputCursor = 0; // Into adjacency->vertices
+    int64_t fanningVertex = adjacency->vertices[0];
+    while(fanningVertex >= 0)
+    {
+        uint32_t numCandidates = 0;
+
+        // Emit all remaining triangles around the fanning vertex
+        const uint32_t* triangles = adjacency->triangles + adjacency->offsets[fanningVertex];
+        uint32_t numAdjacentTriangles = adjacency->counts[fanningVertex];
+        for(uint32_t i=0; i<numAdjacentTriangles; ++i)
+        {
+            uint32_t triangle = triangles[i];
+            if(emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+
+            for(uint32_t j=0; j<3; ++j)
+            {
+                uint32_t v = getIndex(*submesh, triangle*3 + j);
+                newIndices[numNewIndices++] = v;
+                deadEndStack[deadEndStackSize++] = v;
+                candidates[numCandidates++] = v;
+                --liveTriangles[v];
+
+                if(timestamp - cacheTimestamps[v] > cacheSize)
+                    cacheTimestamps[v] = timestamp++;
+            }
+        }
+
+        // Pick the next fanning vertex: prefer candidates that will still be
+        // in the cache after their remaining triangles are emitted, oldest first
+        fanningVertex = -1;
+        int64_t bestPriority = -1;
+        for(uint32_t i=0; i<numCandidates; ++i)
+        {
+            uint32_t v = candidates[i];
+            if(liveTriangles[v] == 0)
+                continue;
+
+            int64_t priority = 0;
+            if(timestamp - cacheTimestamps[v] + 2*liveTriangles[v] <= cacheSize)
+                priority = timestamp - cacheTimestamps[v];
+            if(priority > bestPriority) {
+                bestPriority = priority;
+                fanningVertex = v;
+            }
+        }
+
+        // Dead end: try recently used vertices, then fall back to input order
+        if(fanningVertex < 0)
+        {
+            while(deadEndStackSize > 0) {
+                uint32_t v = deadEndStack[--deadEndStackSize];
+                if(liveTriangles[v] > 0) {
+                    fanningVertex = v;
+                    break;
+                }
+            }
+        }
+        if(fanningVertex < 0)
+        {
+            while(inputCursor < adjacency->numVertices) {
+                uint32_t v = adjacency->vertices[inputCursor];
+                if(liveTriangles[v] > 0) {
+                    fanningVertex = v;
+                    break;
+                }
+                ++inputCursor;
+            }
+        }
+    }
+    assert(numNewIndices == submesh->numIndices);
+
+    for(uint32_t i=0; i<numNewIndices; ++i)
+        setIndex(submesh, i, newIndices[i]);
+
+    clearVertexTriangleAdjacency(adjacency);
+}
+
+void optimiseVertexCache(LoadedObj* obj, uint32_t cacheSize)
+{
+    if(obj->numIndices == 0)
+        return;
+
+    VertexCacheOptimiser optimiser;
+    optimiser.adjacency = allocateVertexTriangleAdjacency(*obj);
+    optimiser.liveTriangles = (uint32_t*)malloc(obj->numVertices * sizeof(uint32_t));
+    optimiser.cacheTimestamps = (uint32_t*)malloc(obj->numVertices * sizeof(uint32_t));
+    optimiser.emitted = (bool*)malloc(obj->numIndices / 3 * sizeof(bool) + 1);
+    optimiser.deadEndStack = (uint32_t*)malloc(obj->numIndices * sizeof(uint32_t));
+    optimiser.candidates = (uint32_t*)malloc(obj->numIndices * sizeof(uint32_t));
+    optimiser.newIndices = (uint32_t*)malloc(obj->numIndices * sizeof(uint32_t));
+    assert(optimiser.liveTriangles && optimiser.cacheTimestamps && optimiser.emitted);
+    assert(optimiser.deadEndStack && optimiser.candidates && optimiser.newIndices);
+
+    if(obj->numSubmeshes > 1) {
+        for(uint32_t i=0; i<obj->numSubmeshes; ++i) {
+            LoadedObj submeshView = getSubmeshView(*obj, i);
+            optimiseSubmeshVertexCache(&submeshView, &optimiser, cacheSize);
+        }
+    }
+    else
+        optimiseSubmeshVertexCache(obj, &optimiser, cacheSize);
+
+    free(optimiser.newIndices);
+    free(optimiser.candidates);
+    free(optimiser.deadEndStack);
+    free(optimiser.emitted);
+    free(optimiser.cacheTimestamps);
+    free(optimiser.liveTriangles);
+    freeVertexTriangleAdjacency(optimiser.adjacency);
+}
+
+VertexFetchStats analyseVertexFetch(const LoadedObj &obj)
+{
+    VertexFetchStats result = {};
+
+    // Direct-mapped cache, each entry holds which line of the vertex buffer is loaded
+    uint32_t cacheLines[VERTEX_FETCH_CACHE_NUM_LINES];
+    memset(cacheLines, 0xff, sizeof(cacheLines));
+
+    for(uint32_t i=0; i<obj.numIndices; ++i)
+    {
+        uint32_t index = getIndex(obj, i);
+        uint32_t firstByte = index * sizeof(VertexData);
+        uint32_t lastByte = firstByte + sizeof(VertexData) - 1;
+        for(uint32_t line = firstByte / VERTEX_FETCH_CACHE_LINE_SIZE; line <= lastByte / VERTEX_FETCH_CACHE_LINE_SIZE; ++line)
+        {
+            uint32_t* cacheLine = cacheLines + (line % VERTEX_FETCH_CACHE_NUM_LINES);
+            if(*cacheLine != line) {
+                *cacheLine = line;
+                result.bytesFetched += VERTEX_FETCH_CACHE_LINE_SIZE;
+            }
+        }
+    }
+
+    uint32_t vertexBufferSize = obj.numVertices * sizeof(VertexData);
+    result.overfetch = vertexBufferSize ? (float)result.bytesFetched / vertexBufferSize : 0;
+    return result;
+}
+
+void optimiseVertexFetch(LoadedObj* obj)
+{
+    uint32_t* remap = (uint32_t*)malloc(obj->numVertices * sizeof(uint32_t));
+    VertexData* newVertexBuffer = (VertexData*)malloc(obj->numVertices * sizeof(VertexData));
+    assert((remap && newVertexBuffer) || obj->numVertices == 0);
+    memset(remap, 0xff, obj->numVertices * sizeof(uint32_t));
+
+    // Covers every level of detail so they all stay valid. The simplified
+    // levels only use vertices from the full mesh so they don't change the order.
+    uint32_t numNewVertices = 0;
+    uint32_t totalNumIndices = getTotalNumIndices(*obj);
+    for(uint32_t i=0; i<totalNumIndices; ++i)
+    {
+        uint32_t index = getIndex(*obj, i);
+        if(remap[index] == 0xffffffff) {
+            remap[index] = numNewVertices;
+            newVertexBuffer[numNewVertices++] = obj->vertexBuffer[index];
+        }
+        setIndex(obj, i, remap[index]);
+    }
+
+    memcpy(obj->vertexBuffer, newVertexBuffer, numNewVertices * sizeof(VertexData));
+
+    // Keep the quantised vertices in the same order
+    if(obj->quantisedVertexBuffer)
+    {
+        QuantisedVertexData* newQuantisedVertexBuffer = (QuantisedVertexData*)malloc(numNewVertices * sizeof(QuantisedVertexData));
+        assert(newQuantisedVertexBuffer || numNewVertices == 0);
+        for(uint32_t i=0; i<obj->numVertices; ++i)
+            if(remap[i] != 0xffffffff)
+                newQuantisedVertexBuffer[remap[i]] = obj->quantisedVertexBuffer[i];
+        memcpy(obj->quantisedVertexBuffer, newQuantisedVertexBuffer, numNewVertices * sizeof(QuantisedVertexData));
+        free(newQuantisedVertexBuffer);
+    }
+    obj->numVertices = numNewVertices;
+
+    free(newVertexBuffer);
+    free(remap);
+}
+
+// Overdraw estimation
+// A tiny software rasteriser: orthographic projection of the mesh's
+// bounding box onto an OVERDRAW_GRID_SIZE^2 grid.
+
+#define OVERDRAW_GRID_SIZE 256
+
+struct OverdrawView
+{
+    // cross(right, up) == -forward so counter-clockwise triangles face the viewer
+    vec3 right;
+    vec3 up;
+    vec3 forward;
+};
+
+static void rasteriseTriangle(float* depthBuffer, OverdrawStats* stats, vec3 a, vec3 b, vec3 c)
+{
+    // Back-face culling: front faces are counter-clockwise
+    float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    if(area <= 0)
+        return;
+    float invArea = 1.f / area;
+
+    int minX = (int)floorf(CLAMP_BELOW(a.x, CLAMP_BELOW(b.x, c.x)));
+    int minY = (int)floorf(CLAMP_BELOW(a.y, CLAMP_BELOW(b.y, c.y)));
+    int maxX = (int)ceilf(CLAMP_ABOVE(a.x, CLAMP_ABOVE(b.x, c.x)));
+    int maxY = (int)ceilf(CLAMP_ABOVE(a.y, CLAMP_ABOVE(b.y, c.y)));
+    minX = CLAMP_ABOVE(minX, 0);
+    minY = CLAMP_ABOVE(minY, 0);
+    maxX = CLAMP_BELOW(maxX, OVERDRAW_GRID_SIZE - 1);
+    maxY = CLAMP_BELOW(maxY, OVERDRAW_GRID_SIZE - 1);
+
+    for(int y=minY; y<=maxY; ++y)
+    for(int x=minX; x<=maxX; ++x)
+    {
+        // Barycentric coordinates of the pixel centre
+        float px = x + 0.5f, py = y + 0.5f;
+        float wa = ((b.x - px) * (c.y - py) - (c.x - px) * (b.y - py)) * invArea;
+        float wb = ((c.x - px) * (a.y - py) - (a.x - px) * (c.y - py)) * invArea;
+        float wc = 1.f - wa - wb;
+        if(wa < 0 || wb < 0 || wc < 0)
+            continue;
+
+        float depth = wa*a.z + wb*b.z + wc*c.z;
+        float* pixel = depthBuffer + y*OVERDRAW_GRID_SIZE + x;
+        if(depth < *pixel) {
+            if(*pixel == 1E+37f)
+                ++stats->pixelsCovered;
+            ++stats->pixelsShaded;
+            *pixel = depth;
+        }
+    }
+}
+
+OverdrawStats analyseOverdraw(const LoadedObj &obj)
+{
+    OverdrawStats result = {};
+    if(obj.numVertices == 0)
+        return result;
+
+    vec3 boundsMin = obj.bounds.aabbMin;
+    vec3 boundsMax = obj.bounds.aabbMax;
+    vec3 extents = boundsMax - boundsMin;
+    float maxExtent = CLAMP_ABOVE(extents.x, CLAMP_ABOVE(extents.y, extents.z));
+    if(maxExtent <= 0)
+        return result;
+    float scale = (OVERDRAW_GRID_SIZE - 1) / maxExtent;
+
+    const OverdrawView views[] = {
+        { { 1, 0, 0}, {0, 1, 0}, { 0, 0,-1} },
+        { {-1, 0, 0}, {0, 1, 0}, { 0, 0, 1} },
+        { { 0, 0,-1}, {0, 1, 0}, {-1, 0, 0} },
+        { { 0, 0, 1}, {0, 1, 0}, { 1, 0, 0} },
+        { { 1, 0, 0}, {0, 0,-1}, { 0,-1, 0} },
+        { { 1, 0, 0}, {0, 0, 1}, { 0, 1, 0} },
+    };
+
+    float* depthBuffer = (float*)malloc(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE * sizeof(float));
+    assert(depthBuffer);
+
+    for(uint32_t viewIdx=0; viewIdx<sizeof(views)/sizeof(views[0]); ++viewIdx)
+    {
+        const OverdrawView &view = views[viewIdx];
+        for(uint32_t i=0; i<OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE; ++i)
+            depthBuffer[i] = 1E+37f;
+
+        // Project into grid space, offsetting so the bounds start at 0
+        vec3 gridOrigin = { dot(boundsMin, view.right), dot(boundsMin, view.up), 0 };
+        for(uint32_t corner=1; corner<8; ++corner) {
+            vec3 p = { (corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z };
+            gridOrigin.x = CLAMP_BELOW(gridOrigin.x, dot(p, view.right));
+            gridOrigin.y = CLAMP_BELOW(gridOrigin.y, dot(p, view.up));
+        }
+
+        for(uint32_t i=0; i+2<obj.numIndices; i+=3)
+        {
+            vec3 projected[3];
+            for(uint32_t j=0; j<3; ++j) {
+                vec3 p = obj.vertexBuffer[getIndex(obj, i+j)].pos;
+                projected[j] = {
+                    (dot(p, view.right) - gridOrigin.x) * scale,
+                    (dot(p, view.up) - gridOrigin.y) * scale,
+                    dot(p, view.forward)
+                };
+            }
+            rasteriseTriangle(depthBuffer, &result, projected[0], projected[1], projected[2]);
+        }
+    }
+    free(depthBuffer);
+
+    result.overdraw = result.pixelsCovered ? (float)result.pixelsShaded / result.pixelsCovered : 0;
+    return result;
+}
+
+// Returns the number of cache misses for the triangle starting at index `i`
+static uint32_t simulateTriangle(const LoadedObj &obj, uint32_t i, uint32_t* cacheTimestamps, uint32_t* timestamp, uint32_t cacheSize)
+{
+    uint32_t numMisses = 0;
+    for(uint32_t j=0; j<3; ++j) {
+        uint32_t index = getIndex(obj, i+j);
+        if(*timestamp - cacheTimestamps[index] > cacheSize) {
+            cacheTimestamps[index] = (*timestamp)++;
+            ++numMisses;
+        }
+    }
+    return numMisses;
+}
+
+// Empties the simulated cache by moving the clock more than `cacheSize` past
+// every entry, so starting a new cluster doesn't cost O(numVertices). The
+// array is only cleared once the clock gets near wrapping around.
+static void resetVertexCache(uint32_t* cacheTimestamps, uint32_t numVertices, uint32_t* timestamp, uint32_t cacheSize)
+{
+    *timestamp += cacheSize + 1;
+    if(*timestamp >= 0x80000000) {
+        memset(cacheTimestamps, 0, numVertices * sizeof(uint32_t));
+        *timestamp = cacheSize + 1;
+    }
+}
+
+struct OverdrawCluster
+{
+    uint32_t firstTriangle;
+    uint32_t numTriangles;
+    float sortKey;
+};
+
+static int compareClusters(const void* a, const void* b)
+{
+    const OverdrawCluster* clusterA = (const OverdrawCluster*)a;
+    const OverdrawCluster* clusterB = (const OverdrawCluster*)b;
+    // Descending sort key, ties keep their original order
+    if(clusterA->sortKey != clusterB->sortKey)
+        return (clusterA->sortKey > clusterB->sortKey) ? -1 : 1;
+    return (clusterA->firstTriangle < clusterB->firstTriangle) ? -1 : 1;
+}
+
+// Working memory for optimiseOverdraw(), allocated once for the whole mesh
+// and shared by its submeshes so each only costs O(its own indices)
+struct OverdrawOptimiser
+{
+    uint32_t* cacheTimestamps;
+    uint32_t timestamp;
+    uint32_t* vertexSubmesh; // Last submesh using each vertex plus one, for the submesh centroid
+    uint32_t* hardBoundaries;
+    OverdrawCluster* clusters;
+    uint32_t* newIndices;
+};
+
+static void optimiseSubmeshOverdraw(LoadedObj* submesh, uint32_t submeshIdx, OverdrawOptimiser* optimiser, float threshold, uint32_t cacheSize)
+{
+    uint32_t numTriangles = submesh->numIndices / 3;
+    if(numTriangles == 0)
+        return;
+
+    uint32_t* cacheTimestamps = optimiser->cacheTimestamps;
+    uint32_t* hardBoundaries = optimiser->hardBoundaries;
+    OverdrawCluster* clusters = optimiser->clusters;
+    uint32_t numVertices = submesh->numVertices;
+
+    // Hard boundaries are where the vertex cache optimiser jumped to a new
+    // part of the mesh, i.e. none of a triangle's vertices were in the cache
+    uint32_t numHardBoundaries = 0;
+    uint32_t timestamp = optimiser->timestamp;
+    {
+        resetVertexCache(cacheTimestamps, numVertices, &timestamp, cacheSize);
+        for(uint32_t t=0; t<numTriangles; ++t)
+            if(simulateTriangle(*submesh, t*3, cacheTimestamps, &timestamp, cacheSize) == 3)
+                hardBoundaries[numHardBoundaries++] = t;
+        if(numHardBoundaries == 0 || hardBoundaries[0] != 0) {
+            memmove(hardBoundaries + 1, hardBoundaries, numHardBoundaries * sizeof(uint32_t));
+            hardBoundaries[0] = 0;
+            ++numHardBoundaries;
+        }
+        hardBoundaries[numHardBoundaries] = numTriangles;
+    }
+
+    // Soft boundaries split each hard cluster further, wherever the ACMR of the
+    // triangles since the last split is already within `threshold` of the whole
+    // hard cluster's ACMR, so drawing them separately won't cost much
+    uint32_t numClusters = 0;
+    for(uint32_t h=0; h<numHardBoundaries; ++h)
+    {
+        uint32_t start = hardBoundaries[h];
+        uint32_t end = hardBoundaries[h+1];
+
+        resetVertexCache(cacheTimestamps, numVertices, &timestamp, cacheSize);
+        uint32_t clusterMisses = 0;
+        for(uint32_t t=start; t<end; ++t)
+            clusterMisses += simulateTriangle(*submesh, t*3, cacheTimestamps, &timestamp, cacheSize);
+        float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+        resetVertexCache(cacheTimestamps, numVertices, &timestamp, cacheSize);
+        uint32_t runningMisses = 0;
+        uint32_t runningTriangles = 0;
+        clusters[numClusters++].firstTriangle = start;
+        for(uint32_t t=start; t<end; ++t)
+        {
+            runningMisses += simulateTriangle(*submesh, t*3, cacheTimestamps, &timestamp, cacheSize);
+            ++runningTriangles;
+            if(t + 1 < end && (float)runningMisses / runningTriangles <= clusterThreshold)
+            {
+                clusters[numClusters++].firstTriangle = t + 1;
+                resetVertexCache(cacheTimestamps, numVertices, &timestamp, cacheSize);
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+    optimiser->timestamp = timestamp;
+
+    // Centroid of the vertices this submesh uses, each counted once
+    vec3 meshCentroid = {};
+    uint32_t numSubmeshVertices = 0;
+    for(uint32_t i=0; i<submesh->numIndices; ++i) {
+        uint32_t v = getIndex(*submesh, i);
+        if(optimiser->vertexSubmesh[v] != submeshIdx + 1) {
+            optimiser->vertexSubmesh[v] = submeshIdx + 1;
+            meshCentroid += submesh->vertexBuffer[v].pos;
+            ++numSubmeshVertices;
+        }
+    }
+    meshCentroid = meshCentroid / (float)numSubmeshVertices;
+
+    // Sort clusters by how much they face away from the centre of the mesh.
+    // Outward facing clusters on the outside of the mesh are the most likely
+    // to occlude the rest of it from any viewpoint.
+    for(uint32_t clusterIdx=0; clusterIdx<numClusters; ++clusterIdx)
+    {
+        OverdrawCluster* cluster = clusters + clusterIdx;
+        uint32_t end = (clusterIdx + 1 < numClusters) ? clusters[clusterIdx+1].firstTriangle : numTriangles;
+        cluster->numTriangles = end - cluster->firstTriangle;
+
+        vec3 centroid = {};
+        vec3 normal = {};
+        float totalArea = 0;
+        for(uint32_t t=cluster->firstTriangle; t<end; ++t)
+        {
+            vec3 a = submesh->vertexBuffer[getIndex(*submesh, t*3)].pos;
+            vec3 b = submesh->vertexBuffer[getIndex(*submesh, t*3+1)].pos;
+            vec3 c = submesh->vertexBuffer[getIndex(*submesh, t*3+2)].pos;
+            vec3 areaNormal = cross(b - a, c - a);
+            float area = length(areaNormal);
+            centroid += (a + b + c) * (area / 3.f);
+            normal += areaNormal;
+            totalArea += area;
+        }
+        if(totalArea > 0)
+            centroid = centroid / totalArea;
+        cluster->sortKey = dot(centroid - meshCentroid, normaliseOrZero(normal));
+    }
+    qsort(clusters, numClusters, sizeof(OverdrawCluster), compareClusters);
+
+    uint32_t* newIndices = optimiser->newIndices;
+    uint32_t numNewIndices = 0;
+    for(uint32_t c=0; c<numClusters; ++c)
+        for(uint32_t t=0; t<clusters[c].numTriangles; ++t)
+            for(uint32_t j=0; j<3; ++j)
+                newIndices[numNewIndices++] = getIndex(*submesh, (clusters[c].firstTriangle + t)*3 + j);
+    for(uint32_t i=0; i<numNewIndices; ++i)
+        setIndex(submesh, i, newIndices[i]);
+}
+
+void optimiseOverdraw(LoadedObj* obj, float threshold, uint32_t cacheSize)
+{
+    uint32_t numTriangles = obj->numIndices / 3;
+    if(numTriangles == 0)
+        return;
+
+    OverdrawOptimiser optimiser;
+    optimiser.cacheTimestamps = (uint32_t*)calloc(obj->numVertices, sizeof(uint32_t));
+    optimiser.timestamp = cacheSize + 1;
+    optimiser.vertexSubmesh = (uint32_t*)calloc(obj->numVertices, sizeof(uint32_t));
+    optimiser.hardBoundaries = (uint32_t*)malloc((numTriangles + 1) * sizeof(uint32_t));
+    optimiser.clusters = (OverdrawCluster*)malloc(numTriangles * sizeof(OverdrawCluster));
+    optimiser.newIndices = (uint32_t*)malloc(obj->numIndices * sizeof(uint32_t));
+    assert(optimiser.cacheTimestamps && optimiser.vertexSubmesh && optimiser.hardBoundaries);
+    assert(optimiser.clusters && optimiser.newIndices);
+
+    if(obj->numSubmeshes > 1) {
+        for(uint32_t i=0; i<obj->numSubmeshes; ++i) {
+            LoadedObj submeshView = getSubmeshView(*obj, i);
+            optimiseSubmeshOverdraw(&submeshView, i, &optimiser, threshold, cacheSize);
+        }
+    }
+    else
+        optimiseSubmeshOverdraw(obj, 0, &optimiser, threshold, cacheSize);
+
+    free(optimiser.newIndices);
+    free(optimiser.clusters);
+    free(optimiser.hardBoundaries);
+    free(optimiser.vertexSubmesh);
+    free(optimiser.cacheTimestamps);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+// Post-load optimisation stages that reorder the buffers of a LoadedObj
+// for faster rendering. None of them change what gets drawn.
+//
+// Usage:
+// LoadedObj myObj = loadObj("test.obj");
+// optimiseVertexCache(&myObj);
+// optimiseOverdraw(&myObj);
+// optimiseVertexFetch(&myObj);
+// ... // Send buffers to GPU
+//
+// They should be run in that order: optimiseOverdraw() needs a vertex cache
+// optimised index buffer, and optimiseVertexFetch() should be last since it
+// orders vertices by how the final index buffer uses them.
+// Meshes with several submeshes have each one optimised separately, so
+// triangles never move out of their submesh's range.
+
+struct LoadedObj;
+
+// Size of the simulated post-transform vertex cache. Real hardware
+// varies a lot, this is in the right ballpark for most GPUs.
+#define VERTEX_CACHE_SIZE 16
+
+struct VertexCacheStats
+{
+    uint32_t numVertexShaderInvocations; // cache misses
+    float acmr; // average cache miss ratio, misses per triangle (0.5 is ideal)
+    float atvr; // average transform to vertex ratio, misses per vertex (1.0 is ideal)
+};
+
+// Simulates a FIFO post-transform vertex cache of `cacheSize` entries
+VertexCacheStats analyseVertexCache(const LoadedObj &obj, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders triangles in the index buffer to reduce vertex shader invocations.
+// Uses Tipsify from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// by Sander, Nehab and Barczak (2007).
+void optimiseVertexCache(LoadedObj* obj, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Size of the simulated vertex fetch cache used by analyseVertexFetch()
+#define VERTEX_FETCH_CACHE_LINE_SIZE 64
+#define VERTEX_FETCH_CACHE_NUM_LINES 64
+
+struct VertexFetchStats
+{
+    uint32_t bytesFetched;
+    float overfetch; // bytesFetched / vertex buffer size (1.0 is ideal)
+};
+
+// Simulates fetching vertices through a small direct-mapped cache
+VertexFetchStats analyseVertexFetch(const LoadedObj &obj);
+
+// Reorders the vertex buffer in order of first use by the index buffer so
+// vertex fetches stream linearly through memory, and remaps the indices.
+// Vertices that aren't referenced by any triangle are removed.
+// Unlike the other stages this also updates the levels of detail in obj->lods.
+void optimiseVertexFetch(LoadedObj* obj);
+
+struct OverdrawStats
+{
+    uint32_t pixelsCovered;
+    uint32_t pixelsShaded;
+    float overdraw; // pixelsShaded / pixelsCovered (1.0 is ideal)
+};
+
+// Estimates overdraw by rasterising the mesh on the CPU from 6 axis-aligned
+// view directions with back-face culling and a depth test
+OverdrawStats analyseOverdraw(const LoadedObj &obj);
+
+// Splits a vertex cache optimised index buffer into clusters and sorts them
+// so the ones most likely to occlude the rest of the mesh are drawn first.
+// `threshold` is how much worse than the original the ACMR is allowed to get,
+// e.g. 1.05 allows 5% more vertex shader invocations; higher values make
+// smaller clusters, which gives more freedom to reduce overdraw.
+// Also from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+void optimiseOverdraw(LoadedObj* obj, float threshold = 1.05f, uint32_t cacheSize = VERTEX_CACHE_SIZE);
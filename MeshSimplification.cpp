@@ -0,0 +1,717 @@
+#include "MeshSimplification.h"
+
+#include <assert.h>
+#include <math.h> // sqrtf()
+#include <stdlib.h> // qsort()
+#include <string.h>
+
+#include "Hash.h"
+#include "ObjLoading.h"
+
+// Quadrics
+// Each vertex is a point in QUADRIC_DIMENSION dimensions: its position
+// (normalised to the mesh's size), uv and normal, the last two scaled by
+// their weights. A quadric measures the sum of squared distances from a
+// point to the planes of the triangles that were merged into it.
+
+#define QUADRIC_DIMENSION 8
+
+struct Quadric
+{
+    // Symmetric matrix stored as its upper triangle, row by row
+    float a[QUADRIC_DIMENSION*(QUADRIC_DIMENSION+1)/2];
+    float b[QUADRIC_DIMENSION];
+    float c;
+    float weight; // Total area (or edge length squared) that went into the quadric
+};
+
+// Error for point x is x^T*A*x + 2*b.x + c
+static float quadricEvaluate(const Quadric &q, const float* x)
+{
+    float result = q.c;
+    int k = 0;
+    for(int i=0; i<QUADRIC_DIMENSION; ++i)
+    {
+        result += 2.f * q.b[i] * x[i];
+        result += q.a[k++] * x[i] * x[i];
+        for(int j=i+1; j<QUADRIC_DIMENSION; ++j)
+            result += 2.f * q.a[k++] * x[i] * x[j];
+    }
+    return result;
+}
+
+static void quadricAdd(Quadric* q, const Quadric &other)
+{
+    float* dst = (float*)q;
+    const float* src = (const float*)&other;
+    for(size_t i=0; i<sizeof(Quadric)/sizeof(float); ++i)
+        dst[i] += src[i];
+}
+
+// Distance to the plane through p0, p1 and p2, weighted by the triangle's area.
+// From the Garland and Heckbert paper: with e1, e2 an orthonormal basis of
+// the plane, A = I - e1*e1^T - e2*e2^T, b = (p0.e1)*e1 + (p0.e2)*e2 - p0
+// and c = p0.p0 - (p0.e1)^2 - (p0.e2)^2
+static void quadricAddTriangle(Quadric* q, const float* p0, const float* p1, const float* p2, float area)
+{
+    float e1[QUADRIC_DIMENSION], e2[QUADRIC_DIMENSION];
+    float e1LengthSquared = 0;
+    for(int i=0; i<QUADRIC_DIMENSION; ++i) {
+        e1[i] = p1[i] - p0[i];
+        e1LengthSquared += e1[i] * e1[i];
+    }
+    if(e1LengthSquared == 0)
+        return;
+    float e1InverseLength = 1.f / sqrtf(e1LengthSquared);
+    float e1DotE2 = 0;
+    for(int i=0; i<QUADRIC_DIMENSION; ++i) {
+        e1[i] *= e1InverseLength;
+        e2[i] = p2[i] - p0[i];
+        e1DotE2 += e1[i] * e2[i];
+    }
+    float e2LengthSquared = 0;
+    for(int i=0; i<QUADRIC_DIMENSION; ++i) {
+        e2[i] -= e1DotE2 * e1[i];
+        e2LengthSquared += e2[i] * e2[i];
+    }
+    if(e2LengthSquared == 0)
+        return;
+    float e2InverseLength = 1.f / sqrtf(e2LengthSquared);
+    float p0DotE1 = 0, p0DotE2 = 0, p0DotP0 = 0;
+    for(int i=0; i<QUADRIC_DIMENSION; ++i) {
+        e2[i] *= e2InverseLength;
+        p0DotE1 += p0[i] * e1[i];
+        p0DotE2 += p0[i] * e2[i];
+        p0DotP0 += p0[i] * p0[i];
+    }
+
+    int k = 0;
+    for(int i=0; i<QUADRIC_DIMENSION; ++i)
+    {
+        for(int j=i; j<QUADRIC_DIMENSION; ++j)
+            q->a[k++] += area * ((i == j ? 1.f : 0.f) - e1[i]*e1[j] - e2[i]*e2[j]);
+        q->b[i] += area * (p0DotE1*e1[i] + p0DotE2*e2[i] - p0[i]);
+    }
+    q->c += area * (p0DotP0 - p0DotE1*p0DotE1 - p0DotE2*p0DotE2);
+    q->weight += area;
+}
+
+// Distance to the plane n.x + d = 0, only looks at the position part of x
+static void quadricAddPlane(Quadric* q, vec3 n, float d, float weight)
+{
+    float normal[3] = { n.x, n.y, n.z };
+    for(int i=0; i<3; ++i)
+    {
+        // Row i of the upper triangle starts at i*D - i*(i-1)/2
+        int rowStart = i*QUADRIC_DIMENSION - i*(i-1)/2;
+        for(int j=i; j<3; ++j)
+            q->a[rowStart + (j - i)] += weight * normal[i] * normal[j];
+        q->b[i] += weight * d * normal[i];
+    }
+    q->c += weight * d * d;
+    q->weight += weight;
+}
+
+// Hash set of directed edges, for finding the open edges of the mesh
+
+#define INVALID_VERTEX_INDEX 0xffffffff
+#define EMPTY_EDGE_KEY 0xffffffffffffffffull
+
+struct EdgeSet
+{
+    uint64_t* keys;
+    uint64_t mask;
+};
+
+static uint64_t edgeKey(uint32_t from, uint32_t to)
+{
+    return ((uint64_t)from << 32) | to;
+}
+
+static EdgeSet createEdgeSet(uint32_t maxEdges)
+{
+    uint64_t capacity = 16;
+    while(capacity < 2 * (uint64_t)maxEdges)
+        capacity *= 2;
+    EdgeSet result;
+    result.keys = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    assert(result.keys);
+    memset(result.keys, 0xff, capacity * sizeof(uint64_t));
+    result.mask = capacity - 1;
+    return result;
+}
+
+static void insertEdge(EdgeSet* set, uint64_t key)
+{
+    uint64_t slot = hashMix64(key) & set->mask;
+    while(set->keys[slot] != EMPTY_EDGE_KEY && set->keys[slot] != key)
+        slot = (slot + 1) & set->mask;
+    set->keys[slot] = key;
+}
+
+static bool containsEdge(const EdgeSet &set, uint64_t key)
+{
+    uint64_t slot = hashMix64(key) & set.mask;
+    while(set.keys[slot] != EMPTY_EDGE_KEY) {
+        if(set.keys[slot] == key)
+            return true;
+        slot = (slot + 1) & set.mask;
+    }
+    return false;
+}
+
+// For each vertex in `vertices`, finds the first one with the same position
+// (and uv if matchUvs is set) and writes its index to result[vertex].
+// NOTE: Adding 0 turns -0 into +0 so they hash the same
+static void groupEqualVertices(const VertexData* vertexBuffer, const uint32_t* vertices, uint32_t numVertices, bool matchUvs, uint32_t* result)
+{
+    uint32_t capacity = 16;
+    while(capacity < 2 * numVertices)
+        capacity *= 2;
+    uint32_t* table = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    assert(table);
+    memset(table, 0xff, capacity * sizeof(uint32_t));
+
+    for(uint32_t i=0; i<numVertices; ++i)
+    {
+        const VertexData &v = vertexBuffer[vertices[i]];
+        float key[5] = { v.pos.x + 0.f, v.pos.y + 0.f, v.pos.z + 0.f, v.uv.x + 0.f, v.uv.y + 0.f };
+        uint32_t slot = (uint32_t)hashBytes64(key, (matchUvs ? 5 : 3) * sizeof(float)) & (capacity - 1);
+        while(table[slot] != INVALID_VERTEX_INDEX) {
+            const VertexData &other = vertexBuffer[table[slot]];
+            if(other.pos.x == v.pos.x && other.pos.y == v.pos.y && other.pos.z == v.pos.z
+                && (!matchUvs || (other.uv.x == v.uv.x && other.uv.y == v.uv.y)))
+                break;
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if(table[slot] == INVALID_VERTEX_INDEX)
+            table[slot] = vertices[i];
+        result[vertices[i]] = table[slot];
+    }
+    free(table);
+}
+
+// Vertex classification
+// Vertices with the same position but different uvs/normals (wedges) must
+// move together or the mesh tears apart, so collapses are decided per
+// position. A position is one of:
+enum VertexKind
+{
+    VertexKind_MANIFOLD, // One wedge in the middle of a surface, can collapse onto any neighbour
+    VertexKind_BORDER, // One wedge on a hole's edge, can only collapse along the edge
+    VertexKind_SEAM, // Two wedges on a uv/normal seam, can only collapse along the seam
+    VertexKind_LOCKED // Anything more complicated, never collapsed
+};
+
+// Weight of the planes that stop borders and seams moving sideways,
+// relative to the triangle planes
+#define SIMPLIFY_BORDER_WEIGHT 10.f
+
+struct EdgeCollapse
+{
+    uint32_t from;
+    uint32_t to;
+    float error;
+};
+
+static int compareEdgeCollapses(const void* a, const void* b)
+{
+    const EdgeCollapse* collapseA = (const EdgeCollapse*)a;
+    const EdgeCollapse* collapseB = (const EdgeCollapse*)b;
+    if(collapseA->error != collapseB->error)
+        return (collapseA->error < collapseB->error) ? -1 : 1;
+    return (collapseA->from < collapseB->from) ? -1 : 1;
+}
+
+struct Simplifier
+{
+    uint32_t numVertices;
+    const VertexData* vertices;
+    const float* attributes; // QUADRIC_DIMENSION per vertex
+
+    uint32_t* positionClass; // Lowest index of a vertex with the same position
+    uint32_t* wedgeNext; // Circular list of vertices with the same position
+    uint8_t* kinds;
+    // For border and seam vertices, the other end of their open edge leaving/entering them
+    uint32_t* openOut;
+    uint32_t* openIn;
+
+    Quadric* quadrics;
+    uint32_t* collapseRemap;
+    uint8_t* collapseLocked; // Per position class, reset every pass
+    EdgeCollapse* bestCollapses; // Per position class
+
+    // Triangles using each position class, rebuilt every pass
+    uint32_t* adjacencyCounts;
+    uint32_t* adjacencyOffsets;
+    uint32_t* adjacencyTriangles;
+
+    uint32_t* indices;
+    uint32_t numIndices;
+};
+
+// For seams, finds the collapse the other wedge has to do alongside from->to
+static bool getSeamPartner(const Simplifier &s, uint32_t from, uint32_t to, uint32_t* partnerFrom, uint32_t* partnerTo)
+{
+    uint32_t sibling = s.wedgeNext[from];
+    uint32_t toClass = s.positionClass[to];
+    *partnerFrom = sibling;
+    if(s.openOut[sibling] != INVALID_VERTEX_INDEX && s.positionClass[s.openOut[sibling]] == toClass)
+        *partnerTo = s.openOut[sibling];
+    else if(s.openIn[sibling] != INVALID_VERTEX_INDEX && s.positionClass[s.openIn[sibling]] == toClass)
+        *partnerTo = s.openIn[sibling];
+    else
+        return false;
+    return true;
+}
+
+static bool canCollapse(const Simplifier &s, uint32_t from, uint32_t to)
+{
+    if(s.positionClass[from] == s.positionClass[to])
+        return false;
+
+    uint32_t partnerFrom, partnerTo;
+    switch(s.kinds[from])
+    {
+        case VertexKind_MANIFOLD:
+            return true;
+        case VertexKind_BORDER:
+            return to == s.openOut[from] || to == s.openIn[from];
+        case VertexKind_SEAM:
+            return (to == s.openOut[from] || to == s.openIn[from])
+                && getSeamPartner(s, from, to, &partnerFrom, &partnerTo);
+        default:
+            return false;
+    }
+}
+
+// Returns the root mean squared distance from the merged planes to `to`
+static float getCollapseError(const Simplifier &s, uint32_t from, uint32_t to)
+{
+    float error = quadricEvaluate(s.quadrics[from], s.attributes + to*QUADRIC_DIMENSION);
+    float weight = s.quadrics[from].weight;
+    uint32_t partnerFrom, partnerTo;
+    if(s.kinds[from] == VertexKind_SEAM && getSeamPartner(s, from, to, &partnerFrom, &partnerTo)) {
+        error += quadricEvaluate(s.quadrics[partnerFrom], s.attributes + partnerTo*QUADRIC_DIMENSION);
+        weight += s.quadrics[partnerFrom].weight;
+    }
+    if(error <= 0 || weight <= 0)
+        return 0;
+    return sqrtf(error / weight);
+}
+
+// Moving `from` onto `to` must not turn any of the remaining triangles around
+static bool collapseFlipsTriangles(const Simplifier &s, uint32_t from, uint32_t to)
+{
+    uint32_t fromClass = s.positionClass[from];
+    uint32_t toClass = s.positionClass[to];
+    vec3 newPos = s.vertices[to].pos;
+
+    uint32_t* triangles = s.adjacencyTriangles + s.adjacencyOffsets[fromClass];
+    for(uint32_t i=0; i<s.adjacencyCounts[fromClass]; ++i)
+    {
+        const uint32_t* triangle = s.indices + triangles[i]*3;
+        vec3 oldPositions[3], newPositions[3];
+        bool collapses = false;
+        for(int k=0; k<3; ++k) {
+            uint32_t c = s.positionClass[triangle[k]];
+            collapses |= (c == toClass);
+            oldPositions[k] = s.vertices[triangle[k]].pos;
+            newPositions[k] = (c == fromClass) ? newPos : oldPositions[k];
+        }
+        if(collapses)
+            continue;
+        vec3 oldNormal = cross(oldPositions[1] - oldPositions[0], oldPositions[2] - oldPositions[0]);
+        vec3 newNormal = cross(newPositions[1] - newPositions[0], newPositions[2] - newPositions[0]);
+        if(dot(oldNormal, newNormal) <= 0)
+            return true;
+    }
+    return false;
+}
+
+static void buildClassTriangleAdjacency(Simplifier* s)
+{
+    memset(s->adjacencyCounts, 0, s->numVertices * sizeof(uint32_t));
+    for(uint32_t i=0; i<s->numIndices; ++i)
+        ++s->adjacencyCounts[s->positionClass[s->indices[i]]];
+
+    uint32_t offset = 0;
+    for(uint32_t v=0; v<s->numVertices; ++v) {
+        s->adjacencyOffsets[v] = offset;
+        offset += s->adjacencyCounts[v];
+    }
+
+    memset(s->adjacencyCounts, 0, s->numVertices * sizeof(uint32_t));
+    for(uint32_t i=0; i<s->numIndices; ++i) {
+        uint32_t c = s->positionClass[s->indices[i]];
+        s->adjacencyTriangles[s->adjacencyOffsets[c] + s->adjacencyCounts[c]++] = i / 3;
+    }
+}
+
+// Does as many non-overlapping collapses as it can (cheapest first) until it
+// has removed enough triangles to reach targetNumIndices or the collapses
+// cost more than maxError. Returns the number of collapses done.
+static uint32_t performCollapsePass(Simplifier* s, uint32_t targetNumIndices, float maxError, float* maxCollapseError)
+{
+    buildClassTriangleAdjacency(s);
+
+    // Find the cheapest collapse for each position
+    for(uint32_t v=0; v<s->numVertices; ++v)
+        s->bestCollapses[v].error = -1;
+    for(uint32_t i=0; i<s->numIndices; ++i)
+    {
+        uint32_t a = s->indices[i];
+        uint32_t b = s->indices[(i % 3 == 2) ? i - 2 : i + 1];
+        for(int direction=0; direction<2; ++direction)
+        {
+            uint32_t from = direction ? b : a;
+            uint32_t to = direction ? a : b;
+            if(!canCollapse(*s, from, to))
+                continue;
+            float error = getCollapseError(*s, from, to);
+            EdgeCollapse* best = s->bestCollapses + s->positionClass[from];
+            if(best->error < 0 || error < best->error)
+                *best = { from, to, error };
+        }
+    }
+
+    uint32_t numCandidates = 0;
+    for(uint32_t v=0; v<s->numVertices; ++v)
+        if(s->bestCollapses[v].error >= 0 && s->bestCollapses[v].error <= maxError)
+            s->bestCollapses[numCandidates++] = s->bestCollapses[v];
+    qsort(s->bestCollapses, numCandidates, sizeof(EdgeCollapse), compareEdgeCollapses);
+
+    // Positions touched by a collapse are locked for the rest of the pass
+    // so the remap below never has to follow chains
+    memset(s->collapseLocked, 0, s->numVertices);
+    uint32_t trianglesToRemove = (s->numIndices - targetNumIndices) / 3;
+    uint32_t trianglesRemoved = 0;
+    uint32_t numCollapses = 0;
+    for(uint32_t i=0; i<numCandidates && trianglesRemoved < trianglesToRemove; ++i)
+    {
+        EdgeCollapse collapse = s->bestCollapses[i];
+        uint32_t fromClass = s->positionClass[collapse.from];
+        uint32_t toClass = s->positionClass[collapse.to];
+        if(s->collapseLocked[fromClass] || s->collapseLocked[toClass])
+            continue;
+        if(collapseFlipsTriangles(*s, collapse.from, collapse.to))
+            continue;
+
+        s->collapseRemap[collapse.from] = collapse.to;
+        quadricAdd(s->quadrics + collapse.to, s->quadrics[collapse.from]);
+        uint32_t partnerFrom, partnerTo;
+        if(s->kinds[collapse.from] == VertexKind_SEAM && getSeamPartner(*s, collapse.from, collapse.to, &partnerFrom, &partnerTo)) {
+            s->collapseRemap[partnerFrom] = partnerTo;
+            quadricAdd(s->quadrics + partnerTo, s->quadrics[partnerFrom]);
+        }
+
+        s->collapseLocked[fromClass] = 1;
+        s->collapseLocked[toClass] = 1;
+        trianglesRemoved += (s->kinds[collapse.from] == VertexKind_BORDER) ? 1 : 2;
+        *maxCollapseError = CLAMP_ABOVE(*maxCollapseError, collapse.error);
+        ++numCollapses;
+    }
+    if(numCollapses == 0)
+        return 0;
+
+    // Remap the indices and remove the triangles that collapsed
+    uint32_t numNewIndices = 0;
+    for(uint32_t i=0; i<s->numIndices; i+=3)
+    {
+        uint32_t i0 = s->collapseRemap[s->indices[i]];
+        uint32_t i1 = s->collapseRemap[s->indices[i+1]];
+        uint32_t i2 = s->collapseRemap[s->indices[i+2]];
+        uint32_t c0 = s->positionClass[i0], c1 = s->positionClass[i1], c2 = s->positionClass[i2];
+        if(c0 == c1 || c1 == c2 || c0 == c2)
+            continue;
+        s->indices[numNewIndices++] = i0;
+        s->indices[numNewIndices++] = i1;
+        s->indices[numNewIndices++] = i2;
+    }
+    s->numIndices = numNewIndices;
+
+    // Open edges that led to a collapsed vertex now lead to where it went.
+    // If that's the vertex itself the edge collapsed, so skip to the next one.
+    for(uint32_t v=0; v<s->numVertices; ++v)
+    {
+        if(s->collapseRemap[v] != v)
+            continue;
+        uint32_t* loops[2] = { s->openOut, s->openIn };
+        for(int l=0; l<2; ++l)
+        {
+            uint32_t next = loops[l][v];
+            if(next == INVALID_VERTEX_INDEX)
+                continue;
+            uint32_t remapped = s->collapseRemap[next];
+            if(remapped == v)
+                loops[l][v] = (loops[l][next] != INVALID_VERTEX_INDEX) ? s->collapseRemap[loops[l][next]] : INVALID_VERTEX_INDEX;
+            else
+                loops[l][v] = remapped;
+        }
+    }
+    return numCollapses;
+}
+
+uint32_t generateLods(LoadedObj* obj, const float* targetRatios, const float* maxErrors, uint32_t numTargets, float uvWeight, float normalWeight)
+{
+    if(obj->numLods == 0) {
+        obj->numLods = 1;
+        obj->lods[0] = { 0, obj->numIndices, 0.f };
+    }
+    assert(obj->numLods == 1); // Can't add levels to an existing chain
+    uint32_t numVertices = obj->numVertices;
+    uint32_t numIndices = obj->numIndices;
+    if(numIndices == 0 || numTargets == 0)
+        return obj->numLods;
+
+    Simplifier s = {};
+    s.numVertices = numVertices;
+    s.vertices = obj->vertexBuffer;
+
+    // Normalise positions so errors don't depend on the mesh's scale
+    vec3 boundsMin = obj->bounds.aabbMin;
+    vec3 extents = obj->bounds.aabbMax - boundsMin;
+    float extent = CLAMP_ABOVE(extents.x, CLAMP_ABOVE(extents.y, extents.z));
+    float inverseExtent = (extent > 0) ? 1.f / extent : 1.f;
+
+    float* attributes = (float*)malloc(numVertices * QUADRIC_DIMENSION * sizeof(float));
+    assert(attributes);
+    for(uint32_t i=0; i<numVertices; ++i)
+    {
+        const VertexData &v = obj->vertexBuffer[i];
+        float* x = attributes + i*QUADRIC_DIMENSION;
+        vec3 p = (v.pos - boundsMin) * inverseExtent;
+        x[0] = p.x; x[1] = p.y; x[2] = p.z;
+        x[3] = v.uv.x * uvWeight; x[4] = v.uv.y * uvWeight;
+        x[5] = v.norm.x * normalWeight; x[6] = v.norm.y * normalWeight; x[7] = v.norm.z * normalWeight;
+    }
+    s.attributes = attributes;
+
+    s.indices = (uint32_t*)malloc(numIndices * sizeof(uint32_t));
+    assert(s.indices);
+    for(uint32_t i=0; i<numIndices; ++i)
+        s.indices[i] = getIndex(*obj, i);
+    s.numIndices = numIndices;
+
+    // Vertices that only differ by normal are merged when normals are being
+    // ignored, so hard edges don't stop anything being collapsed
+    uint32_t* twins = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    uint32_t* uniqueVertices = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    assert(twins && uniqueVertices);
+    uint32_t numUniqueVertices = 0;
+    if(normalWeight == 0) {
+        for(uint32_t i=0; i<numVertices; ++i)
+            uniqueVertices[i] = i;
+        groupEqualVertices(obj->vertexBuffer, uniqueVertices, numVertices, true, twins);
+    }
+    else {
+        for(uint32_t i=0; i<numVertices; ++i)
+            twins[i] = i;
+    }
+    for(uint32_t i=0; i<numVertices; ++i)
+        if(twins[i] == i)
+            uniqueVertices[numUniqueVertices++] = i;
+
+    for(uint32_t i=0; i<numIndices; ++i)
+        s.indices[i] = twins[s.indices[i]];
+
+    // Group the rest by position
+    s.positionClass = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    s.wedgeNext = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    assert(s.positionClass && s.wedgeNext);
+    groupEqualVertices(obj->vertexBuffer, uniqueVertices, numUniqueVertices, false, s.positionClass);
+    for(uint32_t i=0; i<numVertices; ++i)
+    {
+        if(twins[i] != i) {
+            s.positionClass[i] = s.positionClass[twins[i]];
+            s.wedgeNext[i] = i;
+        }
+        else if(s.positionClass[i] == i) {
+            s.wedgeNext[i] = i;
+        }
+        else {
+            uint32_t c = s.positionClass[i];
+            s.wedgeNext[i] = s.wedgeNext[c];
+            s.wedgeNext[c] = i;
+        }
+    }
+    free(uniqueVertices);
+    free(twins);
+
+    // Find the open edges, i.e. directed edges without a twin going the other
+    // way. They're borders if no triangle has the twin edge's positions either,
+    // otherwise they're seams.
+    s.openOut = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    s.openIn = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    s.kinds = (uint8_t*)malloc(numVertices);
+    uint8_t* openOutCounts = (uint8_t*)calloc(numVertices, 1);
+    uint8_t* openInCounts = (uint8_t*)calloc(numVertices, 1);
+    uint8_t* borderCounts = (uint8_t*)calloc(numVertices, 1);
+    assert(s.openOut && s.openIn && s.kinds && openOutCounts && openInCounts && borderCounts);
+    memset(s.openOut, 0xff, numVertices * sizeof(uint32_t));
+    memset(s.openIn, 0xff, numVertices * sizeof(uint32_t));
+    memset(s.kinds, VertexKind_LOCKED, numVertices);
+
+    s.quadrics = (Quadric*)calloc(numVertices, sizeof(Quadric));
+    assert(s.quadrics);
+    {
+        EdgeSet indexEdges = createEdgeSet(numIndices);
+        EdgeSet positionEdges = createEdgeSet(numIndices);
+        for(uint32_t i=0; i<numIndices; ++i) {
+            uint32_t a = s.indices[i];
+            uint32_t b = s.indices[(i % 3 == 2) ? i - 2 : i + 1];
+            insertEdge(&indexEdges, edgeKey(a, b));
+            insertEdge(&positionEdges, edgeKey(s.positionClass[a], s.positionClass[b]));
+        }
+
+        for(uint32_t i=0; i<numIndices; i+=3)
+        {
+            const uint32_t* triangle = s.indices + i;
+            const float* p[3];
+            vec3 positions[3];
+            for(int k=0; k<3; ++k) {
+                p[k] = attributes + triangle[k]*QUADRIC_DIMENSION;
+                positions[k] = { p[k][0], p[k][1], p[k][2] };
+            }
+            vec3 triangleNormal = cross(positions[1] - positions[0], positions[2] - positions[0]);
+            float area = 0.5f * length(triangleNormal);
+            for(int k=0; k<3; ++k)
+                quadricAddTriangle(s.quadrics + triangle[k], p[0], p[1], p[2], area);
+
+            for(int k=0; k<3; ++k)
+            {
+                uint32_t a = triangle[k];
+                uint32_t b = triangle[(k + 1) % 3];
+                if(containsEdge(indexEdges, edgeKey(b, a)))
+                    continue;
+                s.openOut[a] = b;
+                s.openIn[b] = a;
+                openOutCounts[a] = (uint8_t)CLAMP_BELOW(openOutCounts[a] + 1, 255);
+                openInCounts[b] = (uint8_t)CLAMP_BELOW(openInCounts[b] + 1, 255);
+                if(!containsEdge(positionEdges, edgeKey(s.positionClass[b], s.positionClass[a]))) {
+                    borderCounts[a] = (uint8_t)CLAMP_BELOW(borderCounts[a] + 1, 255);
+                    borderCounts[b] = (uint8_t)CLAMP_BELOW(borderCounts[b] + 1, 255);
+                }
+
+                // Keep open edges in place with a plane through the edge,
+                // perpendicular to the triangle
+                vec3 edge = positions[(k + 1) % 3] - positions[k];
+                vec3 planeNormal = normaliseOrZero(cross(edge, triangleNormal));
+                float planeD = -dot(planeNormal, positions[k]);
+                float edgeWeight = SIMPLIFY_BORDER_WEIGHT * dot(edge, edge);
+                quadricAddPlane(s.quadrics + a, planeNormal, planeD, edgeWeight);
+                quadricAddPlane(s.quadrics + b, planeNormal, planeD, edgeWeight);
+            }
+        }
+        free(indexEdges.keys);
+        free(positionEdges.keys);
+    }
+
+    for(uint32_t v=0; v<numVertices; ++v)
+    {
+        if(s.positionClass[v] != v)
+            continue;
+        uint32_t sibling = s.wedgeNext[v];
+        uint8_t kind = VertexKind_LOCKED;
+        if(sibling == v)
+        {
+            if(openOutCounts[v] == 0 && openInCounts[v] == 0)
+                kind = VertexKind_MANIFOLD;
+            else if(openOutCounts[v] == 1 && openInCounts[v] == 1 && borderCounts[v] == 2)
+                kind = VertexKind_BORDER;
+        }
+        else if(s.wedgeNext[sibling] == v)
+        {
+            if(openOutCounts[v] == 1 && openInCounts[v] == 1 && borderCounts[v] == 0
+                && openOutCounts[sibling] == 1 && openInCounts[sibling] == 1 && borderCounts[sibling] == 0)
+                kind = VertexKind_SEAM;
+        }
+        uint32_t w = v;
+        do {
+            s.kinds[w] = kind;
+            w = s.wedgeNext[w];
+        } while(w != v);
+    }
+    free(openOutCounts);
+    free(openInCounts);
+    free(borderCounts);
+
+    s.collapseRemap = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    s.collapseLocked = (uint8_t*)malloc(numVertices);
+    s.bestCollapses = (EdgeCollapse*)malloc(numVertices * sizeof(EdgeCollapse));
+    s.adjacencyCounts = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    s.adjacencyOffsets = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    s.adjacencyTriangles = (uint32_t*)malloc(numIndices * sizeof(uint32_t));
+    assert(s.collapseRemap && s.collapseLocked && s.bestCollapses && s.adjacencyCounts && s.adjacencyOffsets && s.adjacencyTriangles);
+    for(uint32_t v=0; v<numVertices; ++v)
+        s.collapseRemap[v] = v;
+
+    // Keep collapsing, taking a snapshot of the indices whenever a target is reached.
+    // Later levels carry on from the earlier ones so they only ever get coarser.
+    uint32_t* lodIndices = (uint32_t*)malloc((size_t)numIndices * numTargets * sizeof(uint32_t));
+    assert(lodIndices);
+    uint32_t numLodIndices = 0;
+    uint32_t numLods = 1;
+    MeshLod lods[MAX_MESH_LODS];
+    float maxCollapseError = 0;
+    for(uint32_t t=0; t<numTargets && numLods<MAX_MESH_LODS; ++t)
+    {
+        uint32_t targetNumIndices = (uint32_t)(targetRatios[t] * (numIndices / 3)) * 3;
+        while(s.numIndices > targetNumIndices)
+            if(performCollapsePass(&s, targetNumIndices, maxErrors[t], &maxCollapseError) == 0)
+                break;
+
+        uint32_t previousNumIndices = (numLods > 1) ? lods[numLods-1].numIndices : numIndices;
+        if(s.numIndices == 0 || s.numIndices >= previousNumIndices)
+            continue;
+        lods[numLods].firstIndex = numIndices + numLodIndices;
+        lods[numLods].numIndices = s.numIndices;
+        lods[numLods].error = maxCollapseError * extent;
+        memcpy(lodIndices + numLodIndices, s.indices, s.numIndices * sizeof(uint32_t));
+        numLodIndices += s.numIndices;
+        ++numLods;
+    }
+
+    // Append the new levels to the index buffer
+    if(numLods > 1)
+    {
+        void* newIndexBuffer = allocatorAlloc(obj->allocator, (size_t)(numIndices + numLodIndices) * obj->bytesPerIndex);
+        assert(newIndexBuffer);
+        memcpy(newIndexBuffer, obj->indexBuffer, (size_t)numIndices * obj->bytesPerIndex);
+        allocatorFree(obj->allocator, obj->indexBuffer);
+        obj->indexBuffer = newIndexBuffer;
+        for(uint32_t l=1; l<numLods; ++l)
+            obj->lods[l] = lods[l];
+        obj->numLods = numLods;
+        for(uint32_t i=0; i<numLodIndices; ++i)
+            setIndex(obj, numIndices + i, lodIndices[i]);
+    }
+
+    free(lodIndices);
+    free(s.adjacencyTriangles);
+    free(s.adjacencyOffsets);
+    free(s.adjacencyCounts);
+    free(s.bestCollapses);
+    free(s.collapseLocked);
+    free(s.collapseRemap);
+    free(s.quadrics);
+    free(s.kinds);
+    free(s.openIn);
+    free(s.openOut);
+    free(s.wedgeNext);
+    free(s.positionClass);
+    free(s.indices);
+    free(attributes);
+
+    return obj->numLods;
+}
+
+uint32_t selectMeshLod(const MeshLod* lods, uint32_t numLods, float pixelsPerUnit, float maxPixelError)
+{
+    // Errors only get bigger, so take the last level that's good enough
+    uint32_t result = 0;
+    for(uint32_t i=1; i<numLods; ++i)
+        if(lods[i].error * pixelsPerUnit <= maxPixelError)
+            result = i;
+    return result;
+}
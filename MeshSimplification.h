@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+// Level of detail generation by edge collapse, using the quadric error
+// metric from "Simplifying Surfaces with Color and Texture using Quadric
+// Error Metrics" by Garland and Heckbert (1998). Vertices are collapsed
+// onto existing neighbours, so every level shares the mesh's vertex buffer
+// and only needs its own range of the index buffer.
+//
+// Usage:
+// LoadedObj myObj = loadObj("test.obj");
+// float targetRatios[] = { 0.5f, 0.25f, 0.125f };
+// float maxErrors[] = { 0.005f, 0.01f, 0.02f };
+// generateLods(&myObj, targetRatios, maxErrors, 3);
+// ... // Send buffers to GPU
+// ... // Each frame, draw myObj.lods[selectMeshLod(myObj.lods, myObj.numLods, pixelsPerUnit)]
+//
+// Run it before optimiseVertexFetch(), which keeps all levels in sync.
+// The other stages in MeshOptimisation.h can be run on each level with getLodView().
+
+struct LoadedObj;
+struct MeshLod;
+
+// Appends up to `numTargets` simplified levels to obj->lods (and the index buffer).
+// targetRatios[i] is the fraction of the full mesh's triangles to aim for and
+// maxErrors[i] is the most error allowed for that level, relative to the largest
+// dimension of the mesh's bounding box. Both should be decreasing/increasing.
+// A level stops simplifying when it hits either limit, and is skipped if it
+// couldn't get any smaller than the level before it.
+// uvWeight and normalWeight scale how much changing texture coordinates and
+// normals costs compared to moving the surface. A normalWeight of 0 ignores
+// normals completely, so hard edges don't stop vertices being collapsed but
+// the levels can end up with any of the normals at a corner. That's the
+// default since shaders.hlsl doesn't use normals and our meshes are faceted.
+// obj must own its buffers, i.e. not come from loadBakedMesh(). The bigger
+// index buffer comes from obj->allocator.
+// Returns the new obj->numLods.
+uint32_t generateLods(LoadedObj* obj, const float* targetRatios, const float* maxErrors, uint32_t numTargets, float uvWeight = 1.f, float normalWeight = 0.f);
+
+// Returns the coarsest level whose error is at most `maxPixelError` pixels on screen.
+// pixelsPerUnit is how many pixels one model space unit covers at the object's
+// distance, e.g. for a perspective projection:
+//   0.5f * screenHeight * projectionMat.m[1][1] * objectScale / distanceToCamera
+uint32_t selectMeshLod(const MeshLod* lods, uint32_t numLods, float pixelsPerUnit, float maxPixelError = 1.f);
@@ -0,0 +1,318 @@
+#include "Meshlets.h"
+
+#include <assert.h>
+#include <math.h> // sqrtf()
+#include <stdlib.h>
+#include <string.h>
+
+#include "ObjLoading.h"
+
+// Normals closer together than this (the cosine of the widest angle
+// from the cone's axis) make a cone worth testing
+#define MESHLET_MIN_CONE_DOT 0.1f
+
+struct SortablePosition
+{
+    vec3 pos;
+    uint32_t vertex;
+};
+
+static int compareSortablePositions(const void* a, const void* b)
+{
+    const SortablePosition* positionA = (const SortablePosition*)a;
+    const SortablePosition* positionB = (const SortablePosition*)b;
+    if(positionA->pos.x != positionB->pos.x)
+        return (positionA->pos.x < positionB->pos.x) ? -1 : 1;
+    if(positionA->pos.y != positionB->pos.y)
+        return (positionA->pos.y < positionB->pos.y) ? -1 : 1;
+    if(positionA->pos.z != positionB->pos.z)
+        return (positionA->pos.z < positionB->pos.z) ? -1 : 1;
+    return (positionA->vertex < positionB->vertex) ? -1 : 1;
+}
+
+// Gives vertices with the same position the same id, so meshlets can
+// grow across hard edges and uv seams
+static void findPositionIds(const LoadedObj &obj, uint32_t* positionIds)
+{
+    SortablePosition* positions = (SortablePosition*)malloc(obj.numVertices * sizeof(SortablePosition));
+    assert(positions || obj.numVertices == 0);
+    for(uint32_t v=0; v<obj.numVertices; ++v)
+        positions[v] = { obj.vertexBuffer[v].pos, v };
+    qsort(positions, obj.numVertices, sizeof(SortablePosition), compareSortablePositions);
+
+    uint32_t id = 0;
+    for(uint32_t i=0; i<obj.numVertices; ++i) {
+        vec3 p = positions[i].pos;
+        if(i == 0 || p.x != positions[i-1].pos.x || p.y != positions[i-1].pos.y || p.z != positions[i-1].pos.z)
+            id = positions[i].vertex;
+        positionIds[positions[i].vertex] = id;
+    }
+    free(positions);
+}
+
+static void computeMeshletBounds(const LoadedObj &obj, const uint32_t* indices, const vec3* triangleNormals, Meshlet* meshlet)
+{
+    vec3 boundsMin = obj.vertexBuffer[indices[0]].pos;
+    vec3 boundsMax = boundsMin;
+    vec3 normalSum = {};
+    for(uint32_t i=0; i<meshlet->numIndices; ++i) {
+        vec3 p = obj.vertexBuffer[indices[i]].pos;
+        boundsMin = { CLAMP_BELOW(boundsMin.x, p.x), CLAMP_BELOW(boundsMin.y, p.y), CLAMP_BELOW(boundsMin.z, p.z) };
+        boundsMax = { CLAMP_ABOVE(boundsMax.x, p.x), CLAMP_ABOVE(boundsMax.y, p.y), CLAMP_ABOVE(boundsMax.z, p.z) };
+        if(i % 3 == 0)
+            normalSum += triangleNormals[i / 3];
+    }
+
+    meshlet->center = (boundsMin + boundsMax) * 0.5f;
+    float radiusSquared = 0;
+    for(uint32_t i=0; i<meshlet->numIndices; ++i)
+        radiusSquared = CLAMP_ABOVE(radiusSquared, lengthSquared(obj.vertexBuffer[indices[i]].pos - meshlet->center));
+    meshlet->radius = sqrtf(radiusSquared);
+
+    // The cone's half-angle is set by the normal furthest from the average
+    meshlet->coneAxis = normaliseOrZero(normalSum);
+    meshlet->coneCutoff = 1.f;
+    if(lengthSquared(meshlet->coneAxis) == 0)
+        return;
+    float minDot = 1.f;
+    for(uint32_t t=0; t<meshlet->numIndices/3; ++t)
+        minDot = CLAMP_BELOW(minDot, dot(triangleNormals[t], meshlet->coneAxis));
+    if(minDot > MESHLET_MIN_CONE_DOT)
+        meshlet->coneCutoff = sqrtf(1.f - minDot*minDot);
+}
+
+MeshletData buildMeshlets(LoadedObj* obj, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    assert(maxVertices >= 3 && maxTriangles >= 1);
+    MeshletData result = {};
+    uint32_t numVertices = obj->numVertices;
+    uint32_t numTriangles = obj->numIndices / 3;
+    if(numTriangles == 0)
+        return result;
+
+    uint32_t* indices = (uint32_t*)malloc(numTriangles * 3 * sizeof(uint32_t));
+    uint32_t* newIndices = (uint32_t*)malloc(numTriangles * 3 * sizeof(uint32_t));
+    vec3* triangleNormals = (vec3*)malloc(numTriangles * sizeof(vec3));
+    vec3* newTriangleNormals = (vec3*)malloc(numTriangles * sizeof(vec3));
+    bool* emitted = (bool*)calloc(numTriangles, sizeof(bool));
+    uint32_t* vertexMeshlet = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    uint32_t* meshletVertices = (uint32_t*)malloc(maxVertices * sizeof(uint32_t));
+    result.meshlets = (Meshlet*)malloc(numTriangles * sizeof(Meshlet));
+    assert(indices && newIndices && triangleNormals && newTriangleNormals && emitted && vertexMeshlet && meshletVertices && result.meshlets);
+    memset(vertexMeshlet, 0xff, numVertices * sizeof(uint32_t));
+
+    for(uint32_t i=0; i<numTriangles*3; ++i)
+        indices[i] = getIndex(*obj, i);
+    for(uint32_t t=0; t<numTriangles; ++t) {
+        vec3 a = obj->vertexBuffer[indices[t*3]].pos;
+        vec3 b = obj->vertexBuffer[indices[t*3+1]].pos;
+        vec3 c = obj->vertexBuffer[indices[t*3+2]].pos;
+        triangleNormals[t] = normaliseOrZero(cross(b - a, c - a));
+    }
+
+    // Triangles using each position
+    uint32_t* positionIds = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    uint32_t* adjacencyCounts = (uint32_t*)calloc(numVertices, sizeof(uint32_t));
+    uint32_t* adjacencyOffsets = (uint32_t*)malloc(numVertices * sizeof(uint32_t));
+    uint32_t* adjacencyTriangles = (uint32_t*)malloc(numTriangles * 3 * sizeof(uint32_t));
+    assert(positionIds && adjacencyCounts && adjacencyOffsets && adjacencyTriangles);
+    findPositionIds(*obj, positionIds);
+    for(uint32_t i=0; i<numTriangles*3; ++i)
+        ++adjacencyCounts[positionIds[indices[i]]];
+    uint32_t offset = 0;
+    for(uint32_t v=0; v<numVertices; ++v) {
+        adjacencyOffsets[v] = offset;
+        offset += adjacencyCounts[v];
+    }
+    memset(adjacencyCounts, 0, numVertices * sizeof(uint32_t));
+    for(uint32_t i=0; i<numTriangles*3; ++i) {
+        uint32_t p = positionIds[indices[i]];
+        adjacencyTriangles[adjacencyOffsets[p] + adjacencyCounts[p]++] = i / 3;
+    }
+
+    // Meshlets don't cross submeshes, so the submesh ranges stay valid
+    uint32_t* triangleSubmeshes = NULL;
+    if(obj->numSubmeshes > 1) {
+        triangleSubmeshes = (uint32_t*)malloc(numTriangles * sizeof(uint32_t));
+        assert(triangleSubmeshes);
+        for(uint32_t s=0; s<obj->numSubmeshes; ++s) {
+            const Submesh &submesh = obj->submeshes[s];
+            for(uint32_t t=0; t<submesh.numIndices/3; ++t)
+                triangleSubmeshes[submesh.firstIndex/3 + t] = s;
+        }
+    }
+
+    uint32_t numNewTriangles = 0;
+    uint32_t nextSeedTriangle = 0;
+    while(numNewTriangles < numTriangles)
+    {
+        // Start each meshlet from the first triangle that's left,
+        // following the existing (hopefully vertex cache optimised) order
+        while(emitted[nextSeedTriangle])
+            ++nextSeedTriangle;
+
+        uint32_t meshletIndex = result.numMeshlets;
+        uint32_t meshletSubmesh = triangleSubmeshes ? triangleSubmeshes[nextSeedTriangle] : 0;
+        Meshlet* meshlet = result.meshlets + meshletIndex;
+        *meshlet = {};
+        meshlet->firstIndex = numNewTriangles * 3;
+        vec3 normalSum = {};
+
+        uint32_t triangle = nextSeedTriangle;
+        while(true)
+        {
+            emitted[triangle] = true;
+            for(int k=0; k<3; ++k) {
+                uint32_t v = indices[triangle*3 + k];
+                if(vertexMeshlet[v] != meshletIndex) {
+                    vertexMeshlet[v] = meshletIndex;
+                    meshletVertices[meshlet->numVertices++] = v;
+                }
+                newIndices[numNewTriangles*3 + k] = v;
+            }
+            newTriangleNormals[numNewTriangles++] = triangleNormals[triangle];
+            meshlet->numIndices += 3;
+            normalSum += triangleNormals[triangle];
+            if(meshlet->numIndices / 3 == maxTriangles)
+                break;
+
+            // Pick the neighbour adding fewest vertices, then the one facing most
+            // like the meshlet. Look around the last triangle first, then the
+            // whole meshlet.
+            vec3 averageNormal = normaliseOrZero(normalSum);
+            uint32_t bestTriangle = 0xffffffff;
+            float bestScore = 0;
+            const uint32_t* searchVertices = indices + triangle*3;
+            uint32_t numSearchVertices = 3;
+            for(int pass=0; pass<2 && bestTriangle == 0xffffffff; ++pass)
+            {
+                if(pass == 1) {
+                    searchVertices = meshletVertices;
+                    numSearchVertices = meshlet->numVertices;
+                }
+                for(uint32_t i=0; i<numSearchVertices; ++i)
+                {
+                    uint32_t p = positionIds[searchVertices[i]];
+                    for(uint32_t j=0; j<adjacencyCounts[p]; ++j)
+                    {
+                        uint32_t t = adjacencyTriangles[adjacencyOffsets[p] + j];
+                        if(emitted[t] || (triangleSubmeshes && triangleSubmeshes[t] != meshletSubmesh))
+                            continue;
+                        uint32_t numNewVertices = 0;
+                        for(int k=0; k<3; ++k)
+                            numNewVertices += (vertexMeshlet[indices[t*3 + k]] != meshletIndex);
+                        if(meshlet->numVertices + numNewVertices > maxVertices)
+                            continue;
+                        float score = 4.f * numNewVertices - dot(triangleNormals[t], averageNormal);
+                        if(bestTriangle == 0xffffffff || score < bestScore) {
+                            bestTriangle = t;
+                            bestScore = score;
+                        }
+                    }
+                }
+            }
+            if(bestTriangle == 0xffffffff)
+                break;
+            triangle = bestTriangle;
+        }
+
+        computeMeshletBounds(*obj, newIndices + meshlet->firstIndex, newTriangleNormals + meshlet->firstIndex/3, meshlet);
+        ++result.numMeshlets;
+    }
+
+    for(uint32_t i=0; i<numTriangles*3; ++i)
+        setIndex(obj, i, newIndices[i]);
+    result.meshlets = (Meshlet*)realloc(result.meshlets, result.numMeshlets * sizeof(Meshlet));
+
+    free(triangleSubmeshes);
+    free(adjacencyTriangles);
+    free(adjacencyOffsets);
+    free(adjacencyCounts);
+    free(positionIds);
+    free(meshletVertices);
+    free(vertexMeshlet);
+    free(emitted);
+    free(newTriangleNormals);
+    free(triangleNormals);
+    free(newIndices);
+    free(indices);
+
+    return result;
+}
+
+void freeMeshletData(MeshletData meshlets)
+{
+    free(meshlets.meshlets);
+}
+
+// From "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+// by Gribb and Hartmann. Clip space is v*mat, visible when -w <= x,y <= w and 0 <= z <= w
+Frustum frustumFromViewProjectionMat(const mat4 &mat)
+{
+    const vec4* c = mat.cols;
+    Frustum result = {{
+        { c[3].x + c[0].x, c[3].y + c[0].y, c[3].z + c[0].z, c[3].w + c[0].w }, // left
+        { c[3].x - c[0].x, c[3].y - c[0].y, c[3].z - c[0].z, c[3].w - c[0].w }, // right
+        { c[3].x + c[1].x, c[3].y + c[1].y, c[3].z + c[1].z, c[3].w + c[1].w }, // bottom
+        { c[3].x - c[1].x, c[3].y - c[1].y, c[3].z - c[1].z, c[3].w - c[1].w }, // top
+        { c[2].x, c[2].y, c[2].z, c[2].w },                                     // near
+        { c[3].x - c[2].x, c[3].y - c[2].y, c[3].z - c[2].z, c[3].w - c[2].w }  // far
+    }};
+    for(int i=0; i<6; ++i) {
+        float inverseLength = 1.f / length(result.planes[i].xyz);
+        result.planes[i] = { result.planes[i].x * inverseLength, result.planes[i].y * inverseLength,
+            result.planes[i].z * inverseLength, result.planes[i].w * inverseLength };
+    }
+    return result;
+}
+
+bool sphereIntersectsFrustum(const Frustum &frustum, vec3 center, float radius)
+{
+    for(int p=0; p<6; ++p) {
+        if(dot(v4(center, 1), frustum.planes[p]) < -radius)
+            return false;
+    }
+    return true;
+}
+
+float getMaxScale(const mat4 &modelMat)
+{
+    float maxScaleSquared = 0;
+    for(int i=0; i<3; ++i) {
+        vec3 axis = { modelMat.m[0][i], modelMat.m[1][i], modelMat.m[2][i] };
+        maxScaleSquared = CLAMP_ABOVE(maxScaleSquared, lengthSquared(axis));
+    }
+    return sqrtf(maxScaleSquared);
+}
+
+uint32_t cullMeshlets(const MeshletData &meshlets, const mat4 &modelMat, const Frustum &frustum, vec3 cameraPos, MeshletDrawRange* ranges)
+{
+    float maxScale = getMaxScale(modelMat);
+
+    uint32_t numRanges = 0;
+    for(uint32_t i=0; i<meshlets.numMeshlets; ++i)
+    {
+        const Meshlet &meshlet = meshlets.meshlets[i];
+        vec3 center = (v4(meshlet.center, 1) * modelMat).xyz;
+        float radius = meshlet.radius * maxScale;
+
+        bool isVisible = sphereIntersectsFrustum(frustum, center, radius);
+
+        // Every triangle faces away if the direction from the camera to any point in
+        // the sphere is within (90 degrees - the cone's half-angle) of the cone's axis
+        if(isVisible && meshlet.coneCutoff < 1.f)
+        {
+            vec3 axis = normaliseOrZero((v4(meshlet.coneAxis, 0) * modelMat).xyz);
+            vec3 toCenter = center - cameraPos;
+            isVisible = dot(toCenter, axis) < meshlet.coneCutoff * (length(toCenter) + radius) + radius;
+        }
+
+        if(!isVisible)
+            continue;
+        if(numRanges > 0 && ranges[numRanges-1].firstIndex + ranges[numRanges-1].numIndices == meshlet.firstIndex)
+            ranges[numRanges-1].numIndices += meshlet.numIndices;
+        else
+            ranges[numRanges++] = { meshlet.firstIndex, meshlet.numIndices };
+    }
+    return numRanges;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include "3DMaths.h"
+
+// Splits a mesh into small clusters of triangles (meshlets) with bounds
+// that can be culled on the CPU, so whole chunks of a big mesh that are
+// off-screen or facing away from the camera never get submitted.
+//
+// Usage:
+// LoadedObj myObj = loadObj("test.obj");
+// optimiseVertexCache(&myObj);
+// MeshletData meshlets = buildMeshlets(&myObj);
+// ... // Send buffers to GPU
+// ... // Each frame:
+// uint32_t numRanges = cullMeshlets(meshlets, modelMat, frustum, cameraPos, ranges);
+// for(uint32_t i=0; i<numRanges; ++i)
+//     deviceContext->DrawIndexed(ranges[i].numIndices, ranges[i].firstIndex, 0);
+// ...
+// freeMeshletData(meshlets);
+//
+// buildMeshlets() reorders the triangles of the full mesh (lods[0]) so each
+// meshlet is a contiguous range of the index buffer, it replaces
+// optimiseOverdraw() and should run before optimiseVertexFetch().
+// Meshlets never span more than one submesh (see LoadedObj::submeshes).
+
+struct LoadedObj;
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct Meshlet
+{
+    uint32_t firstIndex;
+    uint32_t numIndices;
+    uint32_t numVertices;
+
+    // Bounding sphere in model space
+    vec3 center;
+    float radius;
+
+    // All the triangles' normals are within the cone around coneAxis,
+    // coneCutoff is the sine of the cone's half-angle. 1 if the normals are
+    // spread too much for the meshlet to ever be back-face culled.
+    vec3 coneAxis;
+    float coneCutoff;
+};
+
+struct MeshletData
+{
+    uint32_t numMeshlets;
+    Meshlet* meshlets;
+};
+
+// Greedily grows each meshlet from neighbouring triangles, preferring ones
+// that add fewest new vertices and face the same way as the rest.
+MeshletData buildMeshlets(LoadedObj* obj, uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+void freeMeshletData(MeshletData meshlets);
+
+// Planes point inwards, a point p is inside when dot(v4(p, 1), plane) >= 0
+struct Frustum
+{
+    vec4 planes[6];
+};
+
+// Extracts the planes of the view frustum in world space (or model space
+// if `mat` includes the model matrix)
+Frustum frustumFromViewProjectionMat(const mat4 &mat);
+
+// Conservative, may return true for spheres just outside a corner of the frustum
+bool sphereIntersectsFrustum(const Frustum &frustum, vec3 center, float radius);
+
+// Length of the longest of modelMat's axes, i.e. how much it scales
+// bounding spheres by
+float getMaxScale(const mat4 &modelMat);
+
+struct MeshletDrawRange
+{
+    uint32_t firstIndex;
+    uint32_t numIndices;
+};
+
+// Writes the index ranges of the meshlets that might be visible to `ranges`
+// (which needs room for numMeshlets), merging neighbouring meshlets into
+// one range. Returns the number of ranges.
+// NOTE: The cone test assumes modelMat has no non-uniform scale
+uint32_t cullMeshlets(const MeshletData &meshlets, const mat4 &modelMat, const Frustum &frustum, vec3 cameraPos, MeshletDrawRange* ranges);
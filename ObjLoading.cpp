@@ -1,314 +1,1619 @@
 #include "ObjLoading.h"
 
-#pragma warning(push)
-#pragma warning(disable:4996) // disable warning that fopen() is unsafe
-
 #include <assert.h>
-#include <math.h> //pow(), fabs(), sqrtf()
-#include <stdio.h>
-#include <stdlib.h>
+#include <math.h> //fabs(), floor(), sqrtf()
+#include <stdio.h> //snprintf()
+#include <stdlib.h> //strtof()
+#include <string.h> //memset(), memchr(), memcpy()
+
+#include "FileMapping.h"
+#include "Threads.h"
+#include "Timer.h"
 
 // Based on the .obj loading code by Arseny Kapoulkine
 // in the meshoptimizer project
 
-static int parseInt(const char* s, const char** end)
+// NOTE: The parsing functions take an `end` pointer rather than relying on
+// a NUL terminator so we can parse straight out of a memory-mapped file
+
+static const char* skipWhitespace(const char* s, const char* end)
 {
-    // skip whitespace
-    while (*s == ' ' || *s == '\t')
+    while (s < end && (*s == ' ' || *s == '\t'))
         ++s;
+    return s;
+}
+
+static const char* skipLine(const char* s, const char* end)
+{
+    const char* newline = (const char*)memchr(s, '\n', end - s);
+    return newline ? newline + 1 : end;
+}
+
+static bool isDigit(const char* s, const char* end)
+{
+    return s < end && unsigned(*s - '0') < 10;
+}
+
+static int parseInt(const char* s, const char* end, const char** outEnd)
+{
+    s = skipWhitespace(s, end);
 
     // read sign bit
-    int sign = (*s == '-');
-    if(*s == '-' || *s == '+') 
+    int sign = (s < end && *s == '-');
+    if(s < end && (*s == '-' || *s == '+'))
         ++s;
 
     unsigned int result = 0;
-    while((unsigned(*s - '0') < 10))
+    while(isDigit(s, end))
     {
         result = result * 10 + (*s - '0');
         ++s;
     }
 
     // return end-of-string
-    *end = s;
+    *outEnd = s;
 
     return sign ? -int(result) : int(result);
 }
 
-static float parseFloat(const char* s, const char** end)
+// Float parsing
+// Numbers are read as a decimal mantissa w of up to 19 significant digits
+// and a power of ten q, then converted with the Eisel-Lemire algorithm,
+// which gets the correctly rounded float from the top bits of w * 5^q.
+// See "Number Parsing at a Gigabyte per Second" by Daniel Lemire (2021)
+// and the fast_float library it describes, which this follows closely.
+// Numbers with more than 19 significant digits are rounded with w and w+1,
+// if those give different floats we fall back to strtof(). Short numbers
+// without an exponent, which is most of them, take a simpler fast path.
+
+#define FLOAT_MAX_MANTISSA_DIGITS 19
+// Anything outside this range of powers of ten is zero or infinity,
+// however many digits the mantissa has
+#define FLOAT_MIN_POW10 -65
+#define FLOAT_MAX_POW10 38
+
+// 5^q for q in [FLOAT_MIN_POW10, FLOAT_MAX_POW10] as 128-bit {high, low}
+// words, shifted so the top bit is set. Negative powers are rounded up.
+static const uint64_t powersOfFive128[][2] = {
+    {0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull}, // 5^-65
+    {0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull}, // 5^-64
+    {0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull}, // 5^-63
+    {0x83a3eeeef9153e89ull, 0x1953cf68300424acull}, // 5^-62
+    {0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull}, // 5^-61
+    {0xcdb02555653131b6ull, 0x3792f412cb06794dull}, // 5^-60
+    {0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull}, // 5^-59
+    {0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull}, // 5^-58
+    {0xc8de047564d20a8bull, 0xf245825a5a445275ull}, // 5^-57
+    {0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull}, // 5^-56
+    {0x9ced737bb6c4183dull, 0x55464dd69685606bull}, // 5^-55
+    {0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull}, // 5^-54
+    {0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull}, // 5^-53
+    {0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull}, // 5^-52
+    {0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull}, // 5^-51
+    {0xef73d256a5c0f77cull, 0x963e66858f6d4440ull}, // 5^-50
+    {0x95a8637627989aadull, 0xdde7001379a44aa8ull}, // 5^-49
+    {0xbb127c53b17ec159ull, 0x5560c018580d5d52ull}, // 5^-48
+    {0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull}, // 5^-47
+    {0x9226712162ab070dull, 0xcab3961304ca70e8ull}, // 5^-46
+    {0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull}, // 5^-45
+    {0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull}, // 5^-44
+    {0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull}, // 5^-43
+    {0xb267ed1940f1c61cull, 0x55f038b237591ed3ull}, // 5^-42
+    {0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull}, // 5^-41
+    {0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull}, // 5^-40
+    {0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull}, // 5^-39
+    {0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull}, // 5^-38
+    {0x881cea14545c7575ull, 0x7e50d64177da2e54ull}, // 5^-37
+    {0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull}, // 5^-36
+    {0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull}, // 5^-35
+    {0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull}, // 5^-34
+    {0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull}, // 5^-33
+    {0xcfb11ead453994baull, 0x67de18eda5814af2ull}, // 5^-32
+    {0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull}, // 5^-31
+    {0xa2425ff75e14fc31ull, 0xa1258379a94d028dull}, // 5^-30
+    {0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull}, // 5^-29
+    {0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull}, // 5^-28
+    {0x9e74d1b791e07e48ull, 0x775ea264cf55347eull}, // 5^-27
+    {0xc612062576589ddaull, 0x95364afe032a819eull}, // 5^-26
+    {0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull}, // 5^-25
+    {0x9abe14cd44753b52ull, 0xc4926a9672793543ull}, // 5^-24
+    {0xc16d9a0095928a27ull, 0x75b7053c0f178294ull}, // 5^-23
+    {0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull}, // 5^-22
+    {0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull}, // 5^-21
+    {0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull}, // 5^-20
+    {0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull}, // 5^-19
+    {0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull}, // 5^-18
+    {0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull}, // 5^-17
+    {0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull}, // 5^-16
+    {0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull}, // 5^-15
+    {0xb424dc35095cd80full, 0x538484c19ef38c95ull}, // 5^-14
+    {0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull}, // 5^-13
+    {0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull}, // 5^-12
+    {0xafebff0bcb24aafeull, 0xf78f69a51539d749ull}, // 5^-11
+    {0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull}, // 5^-10
+    {0x89705f4136b4a597ull, 0x31680a88f8953031ull}, // 5^-9
+    {0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull}, // 5^-8
+    {0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull}, // 5^-7
+    {0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull}, // 5^-6
+    {0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull}, // 5^-5
+    {0xd1b71758e219652bull, 0xd3c36113404ea4a9ull}, // 5^-4
+    {0x83126e978d4fdf3bull, 0x645a1cac083126eaull}, // 5^-3
+    {0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull}, // 5^-2
+    {0xccccccccccccccccull, 0xcccccccccccccccdull}, // 5^-1
+    {0x8000000000000000ull, 0x0000000000000000ull}, // 5^0
+    {0xa000000000000000ull, 0x0000000000000000ull}, // 5^1
+    {0xc800000000000000ull, 0x0000000000000000ull}, // 5^2
+    {0xfa00000000000000ull, 0x0000000000000000ull}, // 5^3
+    {0x9c40000000000000ull, 0x0000000000000000ull}, // 5^4
+    {0xc350000000000000ull, 0x0000000000000000ull}, // 5^5
+    {0xf424000000000000ull, 0x0000000000000000ull}, // 5^6
+    {0x9896800000000000ull, 0x0000000000000000ull}, // 5^7
+    {0xbebc200000000000ull, 0x0000000000000000ull}, // 5^8
+    {0xee6b280000000000ull, 0x0000000000000000ull}, // 5^9
+    {0x9502f90000000000ull, 0x0000000000000000ull}, // 5^10
+    {0xba43b74000000000ull, 0x0000000000000000ull}, // 5^11
+    {0xe8d4a51000000000ull, 0x0000000000000000ull}, // 5^12
+    {0x9184e72a00000000ull, 0x0000000000000000ull}, // 5^13
+    {0xb5e620f480000000ull, 0x0000000000000000ull}, // 5^14
+    {0xe35fa931a0000000ull, 0x0000000000000000ull}, // 5^15
+    {0x8e1bc9bf04000000ull, 0x0000000000000000ull}, // 5^16
+    {0xb1a2bc2ec5000000ull, 0x0000000000000000ull}, // 5^17
+    {0xde0b6b3a76400000ull, 0x0000000000000000ull}, // 5^18
+    {0x8ac7230489e80000ull, 0x0000000000000000ull}, // 5^19
+    {0xad78ebc5ac620000ull, 0x0000000000000000ull}, // 5^20
+    {0xd8d726b7177a8000ull, 0x0000000000000000ull}, // 5^21
+    {0x878678326eac9000ull, 0x0000000000000000ull}, // 5^22
+    {0xa968163f0a57b400ull, 0x0000000000000000ull}, // 5^23
+    {0xd3c21bcecceda100ull, 0x0000000000000000ull}, // 5^24
+    {0x84595161401484a0ull, 0x0000000000000000ull}, // 5^25
+    {0xa56fa5b99019a5c8ull, 0x0000000000000000ull}, // 5^26
+    {0xcecb8f27f4200f3aull, 0x0000000000000000ull}, // 5^27
+    {0x813f3978f8940984ull, 0x4000000000000000ull}, // 5^28
+    {0xa18f07d736b90be5ull, 0x5000000000000000ull}, // 5^29
+    {0xc9f2c9cd04674edeull, 0xa400000000000000ull}, // 5^30
+    {0xfc6f7c4045812296ull, 0x4d00000000000000ull}, // 5^31
+    {0x9dc5ada82b70b59dull, 0xf020000000000000ull}, // 5^32
+    {0xc5371912364ce305ull, 0x6c28000000000000ull}, // 5^33
+    {0xf684df56c3e01bc6ull, 0xc732000000000000ull}, // 5^34
+    {0x9a130b963a6c115cull, 0x3c7f400000000000ull}, // 5^35
+    {0xc097ce7bc90715b3ull, 0x4b9f100000000000ull}, // 5^36
+    {0xf0bdc21abb48db20ull, 0x1e86d40000000000ull}, // 5^37
+    {0x96769950b50d88f4ull, 0x1314448000000000ull}, // 5^38
+};
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h> // _umul128(), _BitScanReverse64(), _BitScanForward64()
+#endif
+
+// Returns the low 64 bits of a * b and writes the high 64 bits to `high`
+static uint64_t multiply64To128(uint64_t a, uint64_t b, uint64_t* high)
 {
-    static const double powers[] = {1e0, 1e+1, 1e+2, 1e+3, 1e+4, 1e+5, 1e+6, 1e+7, 1e+8, 1e+9, 1e+10, 1e+11, 1e+12, 1e+13, 1e+14, 1e+15, 1e+16, 1e+17, 1e+18, 1e+19, 1e+20, 1e+21, 1e+22};
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    *high = (uint64_t)(product >> 64);
+    return (uint64_t)product;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, high);
+#else
+    uint64_t aLo = a & 0xffffffff, aHi = a >> 32;
+    uint64_t bLo = b & 0xffffffff, bHi = b >> 32;
+    uint64_t loLo = aLo * bLo, hiLo = aHi * bLo;
+    uint64_t loHi = aLo * bHi, hiHi = aHi * bHi;
+    uint64_t cross = (loLo >> 32) + (hiLo & 0xffffffff) + loHi;
+    *high = hiHi + (hiLo >> 32) + (cross >> 32);
+    return (cross << 32) | (loLo & 0xffffffff);
+#endif
+}
 
-    // skip whitespace
-    while (*s == ' ' || *s == '\t')
-        ++s;
+static int countLeadingZeros64(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - (int)index;
+#elif defined(_MSC_VER)
+    int result = 0;
+    while(!(x & 0x8000000000000000ull)) {
+        x <<= 1;
+        ++result;
+    }
+    return result;
+#else
+    return __builtin_clzll(x);
+#endif
+}
+
+static int countTrailingZeros64(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int)index;
+#elif defined(_MSC_VER)
+    int result = 0;
+    while(!(x & 1)) {
+        x >>= 1;
+        ++result;
+    }
+    return result;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Returns the bits of the float nearest w * 10^q (ignoring the sign)
+static uint32_t decimalToFloatBits(uint64_t w, int q)
+{
+    const int MANTISSA_BITS = 23;
+    const int MIN_EXPONENT = -127;
+    const int INFINITE_POWER = 0xff;
+
+    if(w == 0 || q < FLOAT_MIN_POW10)
+        return 0;
+    if(q > FLOAT_MAX_POW10)
+        return (uint32_t)INFINITE_POWER << MANTISSA_BITS;
+
+    // Normalise w so its top bit is set, then multiply by 5^q. We only
+    // need enough bits of the product to round, the second multiplication
+    // is only needed when the first one's low bits could carry into them.
+    int leadingZeros = countLeadingZeros64(w);
+    w <<= leadingZeros;
+    const uint64_t* powerOfFive = powersOfFive128[q - FLOAT_MIN_POW10];
+    uint64_t productHigh;
+    uint64_t productLow = multiply64To128(w, powerOfFive[0], &productHigh);
+    const uint64_t precisionMask = 0xffffffffffffffffull >> (MANTISSA_BITS + 3);
+    if((productHigh & precisionMask) == precisionMask)
+    {
+        uint64_t secondHigh;
+        multiply64To128(w, powerOfFive[1], &secondHigh);
+        productLow += secondHigh;
+        if(secondHigh > productLow)
+            ++productHigh;
+    }
+
+    // 2^q is folded into the exponent, log2(10) ~= 217706 / 2^16
+    int upperBit = (int)(productHigh >> 63);
+    int shift = upperBit + 64 - MANTISSA_BITS - 3;
+    uint64_t mantissa = productHigh >> shift;
+    int power2 = (((217706 * q) >> 16) + 63) + upperBit - leadingZeros - MIN_EXPONENT;
+
+    if(power2 <= 0) // Denormal
+    {
+        if(-power2 + 1 >= 64)
+            return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        // Rounding up can make it the smallest normal float, which this
+        // still encodes correctly since the mantissa's carry sets the exponent
+        return (uint32_t)mantissa;
+    }
+
+    // Exactly halfway between two floats (only possible for small powers
+    // of ten, where 5^q is exact), round to even rather than up
+    if(productLow <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1)
+    {
+        if((mantissa << shift) == productHigh)
+            mantissa &= ~(uint64_t)1;
+    }
+
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if(mantissa >= ((uint64_t)2 << MANTISSA_BITS)) {
+        mantissa = (uint64_t)1 << MANTISSA_BITS;
+        ++power2;
+    }
+    mantissa &= ~((uint64_t)1 << MANTISSA_BITS);
+    if(power2 >= INFINITE_POWER)
+        return (uint32_t)INFINITE_POWER << MANTISSA_BITS;
+
+    return (uint32_t)mantissa | ((uint32_t)power2 << MANTISSA_BITS);
+}
+
+// Rounds the number with the digits in [begin, end) (which can include a
+// decimal point) times 10^exponent exactly, by handing it to strtof().
+// Only used for long mantissas that the fast path can't round.
+static float parseLongFloat(const char* begin, const char* end, int exponent, bool negative)
+{
+    // Halfway points between floats have at most 112 significant digits so
+    // any digits after that can only break ties, one sticky digit will do
+    const int MAX_DIGITS = 120;
+    char buffer[MAX_DIGITS + 32];
+    int length = 0;
+    if(negative)
+        buffer[length++] = '-';
+
+    int numDigits = 0;
+    bool seenPoint = false;
+    bool sticky = false;
+    for(const char* s=begin; s<end; ++s)
+    {
+        if(*s == '.') {
+            seenPoint = true;
+            continue;
+        }
+        if(numDigits == 0 && *s == '0') {
+            if(seenPoint) --exponent;
+            continue;
+        }
+        if(numDigits < MAX_DIGITS) {
+            buffer[length++] = *s;
+            ++numDigits;
+            if(seenPoint) --exponent;
+        }
+        else {
+            if(!seenPoint) ++exponent;
+            sticky |= (*s != '0');
+        }
+    }
+    if(sticky) {
+        buffer[length++] = '1';
+        --exponent;
+    }
+    if(numDigits == 0)
+        buffer[length++] = '0';
+    snprintf(buffer + length, sizeof(buffer) - length, "e%d", exponent);
+
+    return strtof(buffer, NULL);
+}
+
+// Reads the first FLOAT_MAX_MANTISSA_DIGITS significant digits in
+// [begin, end) (which can include a decimal point) into `mantissa`, so
+// the digits are about mantissa * 10^power. `truncated` is set if any
+// of the digits that didn't fit are non-zero.
+static void parseLongMantissa(const char* begin, const char* end, uint64_t* mantissa, int* power, bool* truncated)
+{
+    *mantissa = 0;
+    *power = 0;
+    *truncated = false;
+    int numDigits = 0;
+    bool seenPoint = false;
+    for(const char* s=begin; s<end; ++s)
+    {
+        if(*s == '.') {
+            seenPoint = true;
+            continue;
+        }
+        uint32_t digit = *s - '0';
+        if(numDigits < FLOAT_MAX_MANTISSA_DIGITS) {
+            *mantissa = *mantissa * 10 + digit;
+            numDigits += (*mantissa != 0); // Don't count leading zeros
+            if(seenPoint) --*power;
+        }
+        else {
+            if(!seenPoint) ++*power;
+            *truncated |= (digit != 0);
+        }
+    }
+}
+
+// Handles any number parseFloat() can, see parseFloat() for the common case
+static float parseFloatEiselLemire(const char* s, const char* end, const char** outEnd)
+{
+    s = skipWhitespace(s, end);
 
     // read sign
-    double sign = (*s == '-') ? -1 : 1;
-    if(*s == '-' || *s == '+') 
+    bool negative = (s < end && *s == '-');
+    if(s < end && (*s == '-' || *s == '+'))
         ++s;
 
-    // read integer part
-    double result = 0;
+    // read integer and fractional parts, the value is mantissa * 10^power
+    const char* digitsBegin = s;
+    uint64_t mantissa = 0;
     int power = 0;
 
-    while (unsigned(*s - '0') < 10)
+    while (isDigit(s, end))
     {
-        result = result * 10 + (double)(*s - '0');
+        mantissa = mantissa * 10 + (uint64_t)(*s - '0');
         ++s;
     }
+    int numDigits = (int)(s - digitsBegin);
 
     // read fractional part
-    if (*s == '.')
+    if (s < end && *s == '.')
     {
         ++s;
+        const char* fractionBegin = s;
 
-        while (unsigned(*s - '0') < 10)
+        while (isDigit(s, end))
         {
-            result = result * 10 + (double)(*s - '0');
+            mantissa = mantissa * 10 + (uint64_t)(*s - '0');
             ++s;
-            --power;
         }
+        power = -(int)(s - fractionBegin);
+        numDigits -= power;
     }
+    const char* digitsEnd = s;
+
+    // The mantissa overflowed if there were too many digits, read
+    // them again more carefully
+    bool truncated = false;
+    if(numDigits > FLOAT_MAX_MANTISSA_DIGITS)
+        parseLongMantissa(digitsBegin, digitsEnd, &mantissa, &power, &truncated);
 
     // read exponent part
     // NOTE: bitwise OR with ' ' will transform an uppercase char 
     // to lowercase while leaving lowercase chars unchanged
-    if ((*s | ' ') == 'e')
+    int exponent = 0;
+    if (s < end && (*s | ' ') == 'e')
     {
         ++s;
 
         // read exponent sign
-        int expSign = (*s == '-') ? -1 : 1;
-        if(*s == '-' || *s == '+') 
+        int expSign = (s < end && *s == '-') ? -1 : 1;
+        if(s < end && (*s == '-' || *s == '+'))
             ++s;
 
-        // read exponent
+        // read exponent, clamping it so it can't overflow. Anything
+        // this big is out of range for floats anyway.
         int expPower = 0;
-        while (unsigned(*s - '0') < 10)
+        while (isDigit(s, end))
         {
-            expPower = expPower * 10 + (*s - '0');
+            if(expPower < 100000)
+                expPower = expPower * 10 + (*s - '0');
             ++s;
         }
 
-        power += expSign * expPower;
+        exponent = expSign * expPower;
     }
 
     // return end-of-string
-    *end = s;
+    *outEnd = s;
 
-    // note: this is precise if result < 9e15
-    // for longer inputs we lose a bit of precision here
-    if (unsigned(-power) < sizeof(powers) / sizeof(powers[0]))
-        return float(sign * result / powers[-power]);
-    else if (unsigned(power) < sizeof(powers) / sizeof(powers[0]))
-        return float(sign * result * powers[power]);
-    else
-        return float(sign * result * pow(10.0, power));
+    power += exponent;
+    uint32_t bits = decimalToFloatBits(mantissa, power);
+    // The digits we dropped put the real value somewhere between
+    // mantissa and mantissa + 1, fine as long as both round the same way
+    if(truncated && bits != decimalToFloatBits(mantissa + 1, power))
+        return parseLongFloat(digitsBegin, digitsEnd, exponent, negative);
+
+    bits |= (uint32_t)negative << 31;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Reading 8 digits at a time, 6 digit fractions are typical in .obj files
+// See "Faster Integer Parsing" by Kholdstare and fast_float's parse_eight_digits_unrolled()
+// NOTE: These assume a little-endian CPU, like x86 and ARM
+
+// Returns how many of the 8 bytes at `s` are digits before the first non-digit
+static uint32_t countLeadingDigits8(const char* s)
+{
+    uint64_t chunk;
+    memcpy(&chunk, s, sizeof(chunk));
+    // Digits are 0x30 to 0x39, so have a high nibble of 3 both as they are
+    // and after adding 6. Non-zero bytes in `nonDigits` aren't digits.
+    uint64_t nonDigits = ((chunk & 0xf0f0f0f0f0f0f0f0ull) ^ 0x3030303030303030ull)
+        | (((chunk + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) ^ 0x3030303030303030ull);
+    if(nonDigits == 0)
+        return 8;
+    return (uint32_t)countTrailingZeros64(nonDigits) / 8;
 }
 
-static const char* parseFaceElement(const char* s, int& vi, int& vti, int& vni)
+// Parses the first numDigits (1 to 8) bytes at `s`, which must all be digits
+static uint32_t parseDigits8(const char* s, uint32_t numDigits)
 {
-    while (*s == ' ' || *s == '\t')
+    uint64_t chunk;
+    memcpy(&chunk, s, sizeof(chunk));
+    // Shift out the bytes after the digits, leaving leading zeros
+    chunk = (chunk - 0x3030303030303030ull) << (8 * (8 - numDigits));
+    // Combine pairs of digits, then pairs of those, then pairs of those
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000ff000000ffull) * 0x000f424000000064ull)
+        + (((chunk >> 16) & 0x000000ff000000ffull) * 0x0000271000000001ull)) >> 32;
+    return (uint32_t)chunk;
+}
+
+static float parseFloat(const char* s, const char* end, const char** outEnd)
+{
+    const char* begin = s;
+    s = skipWhitespace(s, end);
+
+    // read sign
+    bool negative = (s < end && *s == '-');
+    if(s < end && (*s == '-' || *s == '+'))
         ++s;
 
-    vi = parseInt(s, &s);
+    // read integer and fractional parts
+    const char* digitsBegin = s;
+    uint32_t mantissa = 0;
+    while (isDigit(s, end))
+    {
+        mantissa = mantissa * 10 + (*s - '0');
+        ++s;
+    }
+    int numDigits = (int)(s - digitsBegin);
+    int power = 0;
+    if (s < end && *s == '.')
+    {
+        ++s;
+        const char* fractionBegin = s;
+        if(end - s >= 8)
+        {
+            uint32_t numFractionDigits = countLeadingDigits8(s);
+            if(numFractionDigits > 0) {
+                static const uint32_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+                mantissa = mantissa * powers[numFractionDigits] + parseDigits8(s, numFractionDigits);
+                s += numFractionDigits;
+            }
+        }
+        while (isDigit(s, end))
+        {
+            mantissa = mantissa * 10 + (*s - '0');
+            ++s;
+        }
+        power = (int)(s - fractionBegin);
+        numDigits += power;
+    }
+
+    // Fast path for typical .obj numbers, without an exponent and with few
+    // enough digits that the mantissa (which can't have overflowed) and
+    // 10^power are exact floats. Dividing them in double precision then
+    // rounds correctly, since a double has over twice as many bits.
+    bool hasExponent = (s < end && (*s | ' ') == 'e');
+    if(numDigits <= 9 && mantissa <= (1 << 24) && !hasExponent)
+    {
+        static const double powers[] = {1e0, 1e+1, 1e+2, 1e+3, 1e+4, 1e+5, 1e+6, 1e+7, 1e+8, 1e+9};
+        *outEnd = s;
+        double result = (double)mantissa / powers[power];
+        return (float)(negative ? -result : result);
+    }
+
+    return parseFloatEiselLemire(begin, end, outEnd);
+}
+
+static const char* parseFaceElement(const char* s, const char* end, int& vi, int& vti, int& vni)
+{
+    s = skipWhitespace(s, end);
 
-    if (*s != '/')
+    vi = parseInt(s, end, &s);
+
+    if (s == end || *s != '/')
         return s;
     ++s;
 
     // handle vi//vni indices
-    if (*s != '/')
-        vti = parseInt(s, &s);
+    if (s < end && *s != '/')
+        vti = parseInt(s, end, &s);
 
-    if (*s != '/')
+    if (s == end || *s != '/')
         return s;
     ++s;
 
-    vni = parseInt(s, &s);
+    vni = parseInt(s, end, &s);
 
     return s;
 }
 
+// Returns true if the string [s, end) starts with `prefix`
+static bool startsWith(const char* s, const char* end, const char* prefix)
+{
+    size_t prefixLength = strlen(prefix);
+    return (size_t)(end - s) >= prefixLength && memcmp(s, prefix, prefixLength) == 0;
+}
+
 static int fixupIndex(int index, size_t size)
 {
     return (index >= 0) ? index - 1 : int(size) + index;
 }
 
-static void growArray(void** array, size_t* capacity, size_t itemSize)
+// Vertex welding
+// Rather than searching the whole output vertex buffer for a match
+// (which is O(n^2) in the number of vertices) we bucket vertices into
+// a uniform grid of cells keyed on their position. Any vertex within
+// areAlmostEqual() tolerance of a new vertex must live in the same cell
+// or in an adjacent cell, and we only need to probe an adjacent one
+// when the new vertex is within tolerance of the face between them.
+// Each hash table slot stores a cell and the first vertex in it, the rest
+// of the cell's vertices are chained through `chainNext`.
+
+#define VERTEX_GRID_CELLS_PER_UNIT 1024.0
+// Slightly bigger than the tolerance in areAlmostEqual() to avoid missing
+// matches due to rounding when deciding whether to probe a neighbour cell
+#define VERTEX_GRID_PROBE_EPSILON 0.00002
+#define INVALID_VERTEX_INDEX 0xffffffff
+
+struct GridCell
+{
+    int32_t x, y, z;
+};
+
+struct GridSlot
+{
+    GridCell cell;
+    uint32_t firstVertex; // INVALID_VERTEX_INDEX if the slot is empty
+};
+
+struct VertexGrid
+{
+    GridSlot* slots;
+    uint32_t* chainNext; // parallel to output vertex buffer
+    uint32_t slotMask;
+};
+
+// Which cell a position is in along one axis, and whether it's close
+// enough to either side of the cell that a match could be in the next one
+struct GridAxisCoord
+{
+    int32_t cell;
+    bool probeBelow;
+    bool probeAbove;
+};
+
+static GridAxisCoord gridAxisCoord(float f)
 {
-    *capacity = (*capacity == 0) ? 32 : (*capacity + *capacity / 2);
-    *array = realloc(*array, *capacity * itemSize);
-    assert(*array);
+    // Cells are centred on multiples of 1/VERTEX_GRID_CELLS_PER_UNIT rather
+    // than starting at them, so round numbers like 0 (and the coordinates of
+    // regular grids) are in the middle of a cell instead of on a face
+    double t = (double)f * VERTEX_GRID_CELLS_PER_UNIT + 0.5;
+    // Clamp to avoid overflow for absurd coordinates, everything out
+    // here just ends up sharing a cell
+    t = CLAMP_BETWEEN(t, -1e9, 1e9);
+    double cell = floor(t);
+    double distanceToFace = VERTEX_GRID_PROBE_EPSILON * VERTEX_GRID_CELLS_PER_UNIT;
+
+    GridAxisCoord result;
+    result.cell = (int32_t)cell;
+    result.probeBelow = t - cell < distanceToFace;
+    result.probeAbove = cell + 1 - t < distanceToFace;
+    return result;
 }
 
-LoadedObj loadObj(const char* filename)
+static bool operator==(GridCell a, GridCell b)
 {
-    LoadedObj result = {};
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static uint32_t hashGridCell(GridCell c)
+{
+    uint64_t h = (uint64_t)(uint32_t)c.x * 0x9E3779B185EBCA87ull;
+    h ^= (uint64_t)(uint32_t)c.y * 0xC2B2AE3D27D4EB4Full;
+    h ^= (uint64_t)(uint32_t)c.z * 0x165667B19E3779F9ull;
+    h ^= h >> 29;
+    return (uint32_t)h;
+}
+
+static uint32_t getVertexGridNumSlots(uint32_t maxNumCells)
+{
+    // Keep load factor at or below 0.5
+    uint32_t numSlots = 16;
+    while(numSlots < maxNumCells * 2)
+        numSlots *= 2;
+    return numSlots;
+}
 
-    // Read entire file into string
-    char* fileBytes;
+// `slots` needs room for getVertexGridNumSlots(maxNumCells) entries
+// and `chainNext` for as many as the output vertex buffer
+static VertexGrid createVertexGrid(uint32_t maxNumCells, GridSlot* slots, uint32_t* chainNext)
+{
+    uint32_t numSlots = getVertexGridNumSlots(maxNumCells);
+
+    VertexGrid grid = {};
+    grid.slots = slots;
+    grid.chainNext = chainNext;
+    // Sets every firstVertex to INVALID_VERTEX_INDEX
+    memset(grid.slots, 0xff, numSlots * sizeof(GridSlot));
+    grid.slotMask = numSlots - 1;
+    return grid;
+}
+
+// Returns the slot for `cell`, which is either empty or holds that cell's chain
+static GridSlot* findGridSlot(const VertexGrid &grid, GridCell cell)
+{
+    uint32_t slotIdx = hashGridCell(cell) & grid.slotMask;
+    while(true)
     {
-        FILE* file = fopen(filename, "rb");
-        assert(file);
-        fseek(file, 0, SEEK_END);
-        size_t fileNumBytes = ftell(file);
-        fseek(file, 0, SEEK_SET);
+        GridSlot* slot = grid.slots + slotIdx;
+        if(slot->firstVertex == INVALID_VERTEX_INDEX || slot->cell == cell)
+            return slot;
+        slotIdx = (slotIdx + 1) & grid.slotMask;
+    }
+}
+
+static void insertVertex(VertexGrid* grid, GridCell cell, uint32_t index)
+{
+    GridSlot* slot = findGridSlot(*grid, cell);
+    slot->cell = cell;
+    grid->chainNext[index] = slot->firstVertex;
+    slot->firstVertex = index;
+}
+
+// Returns the lowest index of a vertex matching `v`, or INVALID_VERTEX_INDEX,
+// and the cell `v` goes in for insertVertex().
+// Matches the linear search this replaced: position and uv must be almost equal,
+// and normals must be too unless we're in a smoothing group.
+static uint32_t findMatchingVertex(const VertexGrid &grid, const VertexData* vertices, VertexData v, bool smoothNormals, GridCell* baseCell)
+{
+    GridAxisCoord coords[3] = { gridAxisCoord(v.pos.x), gridAxisCoord(v.pos.y), gridAxisCoord(v.pos.z) };
+    *baseCell = { coords[0].cell, coords[1].cell, coords[2].cell };
 
-        fileBytes = (char*)malloc(fileNumBytes + 1);
-        assert(fileBytes);
-        fread(fileBytes, 1, fileNumBytes, file);
-        fileBytes[fileNumBytes] = '\0';
-        fclose(file);
+    // Work out which neighbouring cells could contain a match on each axis
+    int32_t lo[3], hi[3];
+    for(int axis=0; axis<3; ++axis)
+    {
+        lo[axis] = coords[axis].cell - (coords[axis].probeBelow ? 1 : 0);
+        hi[axis] = coords[axis].cell + (coords[axis].probeAbove ? 1 : 0);
     }
 
-    // Count number of elements in obj file
-    uint32_t numVertexPositions = 0;
-    uint32_t numVertexTexCoords = 0;
-    uint32_t numVertexNormals = 0;
-    uint32_t numFaces = 0;
+    uint32_t result = INVALID_VERTEX_INDEX;
+    for(int32_t x=lo[0]; x<=hi[0]; ++x)
+    for(int32_t y=lo[1]; y<=hi[1]; ++y)
+    for(int32_t z=lo[2]; z<=hi[2]; ++z)
     {
-        const char* s = fileBytes;
-        while(*s)
+        uint32_t index = findGridSlot(grid, {x, y, z})->firstVertex;
+        for(; index != INVALID_VERTEX_INDEX; index = grid.chainNext[index])
         {
-            if(*s == 'v'){
-                ++s;
-                if(*s == ' ') ++numVertexPositions;
-                else if(*s == 't') ++numVertexTexCoords;
-                else if(*s == 'n') ++numVertexNormals;
-            }
-            else if(*s == 'f') ++numFaces;
+            const VertexData* candidate = vertices + index;
+            bool posMatch = areAlmostEqual(candidate->pos, v.pos);
+            bool uvMatch = areAlmostEqual(candidate->uv, v.uv);
+            bool normMatch = areAlmostEqual(candidate->norm, v.norm);
+            if(posMatch && uvMatch && (normMatch || smoothNormals) && index < result)
+                result = index;
+        }
+    }
+    return result;
+}
+
+// Parses a smoothing group record, `s` points just past the "s "
+static bool parseSmoothingGroup(const char* s, const char* end)
+{
+    if(startsWith(s, end, "off") || startsWith(s, end, "0"))
+        return false;
+    assert(startsWith(s, end, "on") || (s < end && *s >= '1' && *s <= '9'));
+    return true;
+}
+
+// Loading is split into stages so the parsing can be spread over threads:
+// 1. Split the file into chunks on line boundaries
+// 2. Count the elements in each chunk (in parallel)
+// 3. Prefix sum the counts so each chunk knows where its elements go
+// 4. Parse each chunk into shared arrays (in parallel)
+// 5. Weld the face corners into the output vertex/index buffers (serial,
+//    since which vertex a corner matches depends on every corner before it)
+
+#define MIN_OBJ_CHUNK_BYTES (256 * 1024)
+#define MAX_OBJ_CHUNKS 64
+
+enum SmoothingState
+{
+    SmoothingState_UNCHANGED,
+    SmoothingState_OFF,
+    SmoothingState_ON
+};
+
+struct ObjFaceCorner
+{
+    // 0-based indices, or -1 if the face didn't specify one
+    int32_t vp, vt, vn;
+    bool smoothNormals;
+};
+
+enum SubmeshRecordType
+{
+    SubmeshRecordType_OBJECT, // o
+    SubmeshRecordType_GROUP, // g
+    SubmeshRecordType_MATERIAL // usemtl
+};
+
+// An 'o', 'g' or 'usemtl' line, which starts a new submesh if there have
+// been any faces since the last one
+struct ObjSubmeshRecord
+{
+    SubmeshRecordType type;
+    uint32_t corner; // Number of corners in the chunk before this record
+    const char* name; // Points into the file
+    uint32_t nameLength;
+};
+
+struct ObjParseData
+{
+    float* vpBuffer;
+    float* vtBuffer;
+    float* vnBuffer;
+    ObjFaceCorner* corners;
+    ObjSubmeshRecord* submeshRecords;
+};
+
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+    ObjParseData* parseData;
+
+    // Filled in by countObjChunk()
+    uint32_t numVertexPositions;
+    uint32_t numVertexTexCoords;
+    uint32_t numVertexNormals;
+    uint32_t numFaces;
+    uint32_t numSubmeshRecords; // Upper bound, may include other lines starting with "us"
+    SmoothingState finalSmoothingState;
+
+    // Where this chunk's elements go in the ObjParseData arrays
+    uint32_t firstVertexPosition;
+    uint32_t firstVertexTexCoord;
+    uint32_t firstVertexNormal;
+    uint32_t firstCorner;
+    uint32_t firstSubmeshRecord;
+    bool initialSmoothNormals;
+
+    // Filled in by parseObjChunk()
+    uint32_t numCorners;
+    uint32_t numParsedSubmeshRecords;
+};
+
+// Counts the record starting at `s`, which must be the start of a line
+static void countObjLineStart(const char* s, const char* end, ObjChunk* counts)
+{
+    if(*s == 'v' && s + 1 < end){
+        ++s;
+        if(*s == ' ') ++counts->numVertexPositions;
+        else if(*s == 't') ++counts->numVertexTexCoords;
+        else if(*s == 'n') ++counts->numVertexNormals;
+    }
+    else if(*s == 'f') ++counts->numFaces;
+    else if((*s == 'o' || *s == 'g') && s + 1 < end && s[1] == ' ') ++counts->numSubmeshRecords;
+    else if(*s == 'u' && s + 1 < end && s[1] == 's') ++counts->numSubmeshRecords;
+    // Track smoothing state so the next chunk knows what it starts with
+    else if(*s == 's' && startsWith(s, end, "s ")) {
+        counts->finalSmoothingState = parseSmoothingGroup(s + 2, end) ? SmoothingState_ON : SmoothingState_OFF;
+    }
+}
+
+// Counts the element records in whole lines starting at `s`
+static void countObjLinesScalar(const char* s, const char* end, ObjChunk* counts)
+{
+    while(s < end)
+    {
+        countObjLineStart(s, end, counts);
+        s = skipLine(s, end);
+    }
+}
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OBJ_COUNT_SIMD_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJ_COUNT_SIMD_WIDTH 16
+#endif
+
+#ifdef OBJ_COUNT_SIMD_WIDTH
 
-            while(*s != 0 && *s++ != '\n');
+#define OBJ_COUNT_BLOCK_BYTES 64
+
+// Returns a mask with bit i set if block[i] is a newline
+static uint64_t findNewlines(const char* block)
+{
+    uint64_t result = 0;
+    for(int i=0; i<OBJ_COUNT_BLOCK_BYTES; i+=OBJ_COUNT_SIMD_WIDTH)
+    {
+#if OBJ_COUNT_SIMD_WIDTH == 32
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(block + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+#else
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(block + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+#endif
+        result |= (uint64_t)mask << i;
+    }
+    return result;
+}
+
+// Counts the element records in whole lines starting at `s`.
+// Finds the newlines in OBJ_COUNT_BLOCK_BYTES bytes at a time, then
+// classifies each line that starts in the block with countObjLineStart().
+// Lines are usually a few dozen bytes, so this only looks at a couple of
+// bytes per line rather than comparing every byte against each record type.
+static void countObjLines(const char* s, const char* end, ObjChunk* counts)
+{
+    if(s == end)
+        return;
+
+    // The first byte always starts a line, after that a byte starts
+    // a line if the byte before it is a newline
+    uint64_t carry = 1;
+
+    // Leave a byte after each block so countObjLineStart() can
+    // look at the second byte of a line starting at the end of it
+    while(end - s >= OBJ_COUNT_BLOCK_BYTES + 1)
+    {
+        uint64_t newlines = findNewlines(s);
+        uint64_t lineStarts = (newlines << 1) | carry;
+        carry = newlines >> 63;
+        while(lineStarts)
+        {
+            countObjLineStart(s + countTrailingZeros64(lineStarts), end, counts);
+            lineStarts &= lineStarts - 1;
         }
+        s += OBJ_COUNT_BLOCK_BYTES;
     }
 
-    float* vpBuffer = (float*)malloc(numVertexPositions * 3 * sizeof(float));
-    float* vtBuffer = (float*)malloc(numVertexTexCoords * 2 * sizeof(float));
-    float* vnBuffer = (float*)malloc(numVertexNormals * 3 * sizeof(float));
-    float* vpIt = vpBuffer;
-    float* vtIt = vtBuffer;
-    float* vnIt = vnBuffer;
+    // Finish off any lines starting in the remaining bytes
+    if(!carry)
+        s = skipLine(s, end);
+    countObjLinesScalar(s, end, counts);
+}
 
-    size_t vertexBufferCapacity = 0;
-    size_t indexBufferCapacity = 0;
-    size_t vertexBufferSize = 0;
-    size_t indexBufferSize = 0;
-    VertexData* outVertexBuffer = NULL;
-    uint16_t* outIndexBuffer = NULL;
+#else
 
-    bool smoothNormals = false;
+static void countObjLines(const char* s, const char* end, ObjChunk* counts)
+{
+    countObjLinesScalar(s, end, counts);
+}
+
+#endif
 
-    const char* s = fileBytes;
-    while(*s)
+static void countObjChunk(void* userData)
+{
+    ObjChunk* chunk = (ObjChunk*)userData;
+
+    chunk->numVertexPositions = 0;
+    chunk->numVertexTexCoords = 0;
+    chunk->numVertexNormals = 0;
+    chunk->numFaces = 0;
+    chunk->numSubmeshRecords = 0;
+    chunk->finalSmoothingState = SmoothingState_UNCHANGED;
+
+    countObjLines(chunk->begin, chunk->end, chunk);
+}
+
+// The name is the rest of the line, without surrounding whitespace
+static void parseSubmeshRecordName(const char* s, const char* end, ObjSubmeshRecord* record)
+{
+    while(s < end && (*s == ' ' || *s == '\t'))
+        ++s;
+    const char* nameEnd = s;
+    while(nameEnd < end && *nameEnd != '\r' && *nameEnd != '\n')
+        ++nameEnd;
+    while(nameEnd > s && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t'))
+        --nameEnd;
+    record->name = s;
+    record->nameLength = (uint32_t)(nameEnd - s);
+}
+
+static void parseObjChunk(void* userData)
+{
+    ObjChunk* chunk = (ObjChunk*)userData;
+    const char* end = chunk->end;
+
+    float* vpIt = chunk->parseData->vpBuffer + 3 * chunk->firstVertexPosition;
+    float* vtIt = chunk->parseData->vtBuffer + 2 * chunk->firstVertexTexCoord;
+    float* vnIt = chunk->parseData->vnBuffer + 3 * chunk->firstVertexNormal;
+    ObjFaceCorner* cornerIt = chunk->parseData->corners + chunk->firstCorner;
+    const ObjFaceCorner* chunkCorners = cornerIt;
+    ObjSubmeshRecord* submeshRecordIt = chunk->parseData->submeshRecords + chunk->firstSubmeshRecord;
+    const ObjSubmeshRecord* chunkSubmeshRecords = submeshRecordIt;
+
+    // Relative (negative) indices refer back from the number of elements
+    // read so far, which includes all the elements in previous chunks
+    uint32_t numVertexPositions = chunk->firstVertexPosition;
+    uint32_t numVertexTexCoords = chunk->firstVertexTexCoord;
+    uint32_t numVertexNormals = chunk->firstVertexNormal;
+
+    bool smoothNormals = chunk->initialSmoothNormals;
+
+    const char* s = chunk->begin;
+    while(s < end)
     {
         char currChar = *s;
-        if(currChar == 'v'){
+        if(currChar == 'v' && s + 1 < end){
             ++s;
             currChar = *s++;
             if(currChar == ' '){
-                *vpIt++ = parseFloat(s, &s);
-                *vpIt++ = parseFloat(s, &s);
-                *vpIt++ = parseFloat(s, &s);
+                *vpIt++ = parseFloat(s, end, &s);
+                *vpIt++ = parseFloat(s, end, &s);
+                *vpIt++ = parseFloat(s, end, &s);
+                ++numVertexPositions;
             }
             else if(currChar == 't'){
-                *vtIt++ = parseFloat(s, &s);
-                *vtIt++ = parseFloat(s, &s);
+                *vtIt++ = parseFloat(s, end, &s);
+                *vtIt++ = parseFloat(s, end, &s);
+                ++numVertexTexCoords;
             }
             else if(currChar == 'n'){
-                *vnIt++ = parseFloat(s, &s);
-                *vnIt++ = parseFloat(s, &s);
-                *vnIt++ = parseFloat(s, &s);
+                *vnIt++ = parseFloat(s, end, &s);
+                *vnIt++ = parseFloat(s, end, &s);
+                *vnIt++ = parseFloat(s, end, &s);
+                ++numVertexNormals;
             }
         }
         else if(currChar == 'f')
         {
             ++s;
+            // The count pass only made room for 3 corners per face, so parse
+            // into a local array and skip anything that isn't a triangle
+            // (we don't support quads or n-gons)
+            ObjFaceCorner faceCorners[3];
             int numVertsPerFace = 0;
-            while(*s != '\r' && *s != '\n' && *s != '\0')
+            while(s < end && *s != '\r' && *s != '\n')
             {
-                ++numVertsPerFace;
-                assert(numVertsPerFace < 4); // we don't support quads
                 int vpIdx = 0, vtIdx = 0, vnIdx = 0;
-                s = parseFaceElement(s, vpIdx, vtIdx, vnIdx);
-                assert(vpIdx != 0);
-
-                vpIdx = fixupIndex(vpIdx, numVertexPositions);
-                vtIdx = fixupIndex(vtIdx, numVertexTexCoords);
-                vnIdx = fixupIndex(vnIdx, numVertexNormals);
-                
-                VertexData newVert = {
-                    { vpBuffer[3*vpIdx], vpBuffer[3*vpIdx+1], vpBuffer[3*vpIdx+2] },
-                    { vtBuffer[2*vtIdx], vtBuffer[2*vtIdx+1] },
-                    { vnBuffer[3*vnIdx], vnBuffer[3*vnIdx+1], vnBuffer[3*vnIdx+2] },
-                };
-
-                // Search vertexBuffer for matching vertex
-                uint32_t index;
-                for(index=0; index<vertexBufferSize; ++index) 
-                {
-                    VertexData* v = outVertexBuffer + index;
-                    bool posMatch = areAlmostEqual(v->pos, newVert.pos);
-                    bool uvMatch = areAlmostEqual(v->uv, newVert.uv);
-                    bool normMatch = areAlmostEqual(v->norm, newVert.norm);
-                    if(posMatch && uvMatch)
-                    {
-                        if(normMatch || smoothNormals){
-                            v->norm += newVert.norm;
-                            break;
-                        }
-                    }
-                }
-                if(index == vertexBufferSize){
-                    if(vertexBufferSize + 1 > vertexBufferCapacity){
-                        growArray((void**)(&outVertexBuffer), &vertexBufferCapacity, sizeof(VertexData));
-                    }
-                    outVertexBuffer[vertexBufferSize++] = newVert;
-                }
-                if(indexBufferSize + 1 > indexBufferCapacity){
-                    growArray((void**)(&outIndexBuffer), &indexBufferCapacity, sizeof(uint16_t));
+                s = parseFaceElement(s, end, vpIdx, vtIdx, vnIdx);
+                if(vpIdx == 0)
+                    break; // Trailing whitespace or a malformed element
+                if(numVertsPerFace < 3) {
+                    ObjFaceCorner* corner = faceCorners + numVertsPerFace;
+                    corner->vp = fixupIndex(vpIdx, numVertexPositions);
+                    corner->vt = (vtIdx != 0) ? fixupIndex(vtIdx, numVertexTexCoords) : -1;
+                    corner->vn = (vnIdx != 0) ? fixupIndex(vnIdx, numVertexNormals) : -1;
+                    corner->smoothNormals = smoothNormals;
                 }
-                outIndexBuffer[indexBufferSize++] = (uint16_t)index;
+                ++numVertsPerFace;
+            }
+            if(numVertsPerFace == 3) {
+                memcpy(cornerIt, faceCorners, sizeof(faceCorners));
+                cornerIt += 3;
             }
         }
-        else if(currChar == 's' && *(++s) == ' ')
+        else if(currChar == 's' && startsWith(s, end, "s "))
         {
-            ++s;
-            if((*s == 'o' && *(s+1) == 'f' && *(s+2) == 'f') || *s == '0')
-                smoothNormals = false;
+            s += 2;
+            smoothNormals = parseSmoothingGroup(s, end);
+        }
+        else if((currChar == 'o' || currChar == 'g') && startsWith(s + 1, end, " "))
+        {
+            ObjSubmeshRecord* record = submeshRecordIt++;
+            record->type = (currChar == 'o') ? SubmeshRecordType_OBJECT : SubmeshRecordType_GROUP;
+            record->corner = (uint32_t)(cornerIt - chunkCorners);
+            parseSubmeshRecordName(s + 2, end, record);
+        }
+        else if(currChar == 'u' && startsWith(s, end, "usemtl "))
+        {
+            ObjSubmeshRecord* record = submeshRecordIt++;
+            record->type = SubmeshRecordType_MATERIAL;
+            record->corner = (uint32_t)(cornerIt - chunkCorners);
+            parseSubmeshRecordName(s + 7, end, record);
+        }
+        
+        s = skipLine(s, end);
+    }
+
+    chunk->numCorners = (uint32_t)(cornerIt - chunkCorners);
+    chunk->numParsedSubmeshRecords = (uint32_t)(submeshRecordIt - chunkSubmeshRecords);
+    assert(chunk->numParsedSubmeshRecords <= chunk->numSubmeshRecords);
+}
+
+// Gathers LoadedObj::bounds while the vertices are being welded and
+// normalised, so loading doesn't need any extra passes over them
+struct BoundsBuilder
+{
+    float aabbMin[3];
+    float aabbMax[3];
+    // Vertices with the lowest and highest position on each axis
+    uint32_t minVertex[3];
+    uint32_t maxVertex[3];
+};
+
+static void addBoundsVertex(BoundsBuilder* builder, vec3 p, uint32_t index)
+{
+    float coords[3] = { p.x, p.y, p.z };
+    for(int axis=0; axis<3; ++axis)
+    {
+        if(index == 0 || coords[axis] < builder->aabbMin[axis]) {
+            builder->aabbMin[axis] = coords[axis];
+            builder->minVertex[axis] = index;
+        }
+        if(index == 0 || coords[axis] > builder->aabbMax[axis]) {
+            builder->aabbMax[axis] = coords[axis];
+            builder->maxVertex[axis] = index;
+        }
+    }
+}
+
+// Ritter's bounding sphere ("An Efficient Bounding Sphere", 1990): start with
+// the widest apart pair of extreme vertices as the diameter, then grow
+// the sphere to cover any vertex outside it with growBoundingSphere().
+static void initBoundingSphere(const BoundsBuilder &builder, const VertexData* vertices, MeshBounds* bounds)
+{
+    bounds->aabbMin = { builder.aabbMin[0], builder.aabbMin[1], builder.aabbMin[2] };
+    bounds->aabbMax = { builder.aabbMax[0], builder.aabbMax[1], builder.aabbMax[2] };
+
+    vec3 a = {}, b = {};
+    float maxDistanceSquared = -1;
+    for(int axis=0; axis<3; ++axis)
+    {
+        vec3 axisMin = vertices[builder.minVertex[axis]].pos;
+        vec3 axisMax = vertices[builder.maxVertex[axis]].pos;
+        float distanceSquared = lengthSquared(axisMax - axisMin);
+        if(distanceSquared > maxDistanceSquared) {
+            maxDistanceSquared = distanceSquared;
+            a = axisMin;
+            b = axisMax;
+        }
+    }
+    bounds->sphereCenter = (a + b) * 0.5f;
+    bounds->sphereRadius = length(b - a) * 0.5f;
+}
+
+static void growBoundingSphere(MeshBounds* bounds, vec3 p)
+{
+    vec3 toP = p - bounds->sphereCenter;
+    float distanceSquared = lengthSquared(toP);
+    if(distanceSquared <= bounds->sphereRadius * bounds->sphereRadius)
+        return;
+    // Move the sphere towards p just enough to touch it, keeping the far side fixed
+    float distance = sqrtf(distanceSquared);
+    float newRadius = 0.5f * (bounds->sphereRadius + distance);
+    bounds->sphereCenter += toP * ((newRadius - bounds->sphereRadius) / distance);
+    bounds->sphereRadius = newRadius;
+}
+
+// Builds the submeshes in the weld loop, starting a new one whenever the
+// object, group or material changes after some faces
+struct SubmeshBuilder
+{
+    Submesh* submeshes; // Room for one more than the number of records
+    uint32_t numSubmeshes;
+};
+
+static void copySubmeshName(char* dest, const ObjSubmeshRecord &record)
+{
+    uint32_t maxLength = SUBMESH_MAX_NAME_LENGTH - 1;
+    uint32_t length = CLAMP_BELOW(record.nameLength, maxLength);
+    memcpy(dest, record.name, length);
+    dest[length] = '\0';
+}
+
+static void applySubmeshRecord(SubmeshBuilder* builder, const ObjSubmeshRecord &record, uint32_t firstIndex)
+{
+    Submesh* current = builder->submeshes + builder->numSubmeshes - 1;
+    if(current->numIndices > 0) {
+        Submesh* next = current + 1;
+        memcpy(next, current, sizeof(Submesh));
+        next->firstIndex = firstIndex;
+        next->numIndices = 0;
+        current = next;
+        ++builder->numSubmeshes;
+    }
+    switch(record.type)
+    {
+        case SubmeshRecordType_OBJECT:
+            copySubmeshName(current->objectName, record);
+            // A new object resets the group
+            current->groupName[0] = '\0';
+            break;
+        case SubmeshRecordType_GROUP: copySubmeshName(current->groupName, record); break;
+        case SubmeshRecordType_MATERIAL: copySubmeshName(current->materialName, record); break;
+        default: assert(false);
+    }
+}
+
+// Grows the bounds of the current submesh to cover each corner as it's
+// welded. There's no pass to find extreme points first, so the sphere is
+// looser than the whole mesh's, see finishSubmeshBounds().
+static void addSubmeshCorner(SubmeshBuilder* builder, vec3 p)
+{
+    Submesh* current = builder->submeshes + builder->numSubmeshes - 1;
+    MeshBounds* bounds = &current->bounds;
+    if(current->numIndices++ == 0) {
+        bounds->aabbMin = bounds->aabbMax = p;
+        bounds->sphereCenter = p;
+        bounds->sphereRadius = 0;
+        return;
+    }
+    bounds->aabbMin = { CLAMP_BELOW(bounds->aabbMin.x, p.x), CLAMP_BELOW(bounds->aabbMin.y, p.y), CLAMP_BELOW(bounds->aabbMin.z, p.z) };
+    bounds->aabbMax = { CLAMP_ABOVE(bounds->aabbMax.x, p.x), CLAMP_ABOVE(bounds->aabbMax.y, p.y), CLAMP_ABOVE(bounds->aabbMax.z, p.z) };
+    growBoundingSphere(bounds, p);
+}
+
+// Falls back to the sphere around the AABB if it's tighter
+static void finishSubmeshBounds(MeshBounds* bounds)
+{
+    float aabbSphereRadius = 0.5f * length(bounds->aabbMax - bounds->aabbMin);
+    if(aabbSphereRadius < bounds->sphereRadius) {
+        bounds->sphereCenter = (bounds->aabbMin + bounds->aabbMax) * 0.5f;
+        bounds->sphereRadius = aabbSphereRadius;
+    }
+    bounds->sphereRadius *= 1.0001f;
+}
+
+// Returns the time since *stageStartTime and restarts it, for LoadObjStats
+static double lapStageTime(double* stageStartTime)
+{
+    double time = getTimeInSeconds();
+    double result = time - *stageStartTime;
+    *stageStartTime = time;
+    return result;
+}
+
+LoadedObj loadObjFromMemory(const char* begin, const char* end, const LoadObjOptions &options)
+{
+    LoadedObj result = {};
+    LoadObjStats stats = {};
+    double stageStartTime = getTimeInSeconds();
+
+    // Split file into chunks on line boundaries
+    uint32_t numChunks = CLAMP_ABOVE(options.numThreads, 1);
+    {
+        size_t maxNumChunks = (size_t)(end - begin) / MIN_OBJ_CHUNK_BYTES + 1;
+        maxNumChunks = CLAMP_BELOW(maxNumChunks, MAX_OBJ_CHUNKS);
+        if(numChunks > maxNumChunks)
+            numChunks = (uint32_t)maxNumChunks;
+    }
+    ObjChunk chunks[MAX_OBJ_CHUNKS] = {};
+    {
+        size_t numBytesPerChunk = (size_t)(end - begin) / numChunks;
+        const char* chunkBegin = begin;
+        for(uint32_t i=0; i<numChunks; ++i)
+        {
+            const char* chunkEnd = end;
+            if(i + 1 < numChunks) {
+                chunkEnd = begin + (i + 1) * numBytesPerChunk;
+                chunkEnd = (chunkEnd > chunkBegin) ? skipLine(chunkEnd - 1, end) : chunkBegin;
+            }
+            chunks[i].begin = chunkBegin;
+            chunks[i].end = chunkEnd;
+            chunkBegin = chunkEnd;
+        }
+    }
+
+    // Count number of elements in obj file
+    runJobsInParallel(countObjChunk, chunks, numChunks, sizeof(ObjChunk), numChunks);
+
+    uint32_t numVertexPositions = 0;
+    uint32_t numVertexTexCoords = 0;
+    uint32_t numVertexNormals = 0;
+    uint32_t numFaces = 0;
+    uint32_t numSubmeshRecords = 0;
+    bool smoothNormals = false;
+    for(uint32_t i=0; i<numChunks; ++i)
+    {
+        ObjChunk* chunk = chunks + i;
+        chunk->firstVertexPosition = numVertexPositions;
+        chunk->firstVertexTexCoord = numVertexTexCoords;
+        chunk->firstVertexNormal = numVertexNormals;
+        chunk->firstCorner = 3 * numFaces;
+        chunk->firstSubmeshRecord = numSubmeshRecords;
+        chunk->initialSmoothNormals = smoothNormals;
+
+        numVertexPositions += chunk->numVertexPositions;
+        numVertexTexCoords += chunk->numVertexTexCoords;
+        numVertexNormals += chunk->numVertexNormals;
+        numFaces += chunk->numFaces;
+        numSubmeshRecords += chunk->numSubmeshRecords;
+        if(chunk->finalSmoothingState != SmoothingState_UNCHANGED)
+            smoothNormals = (chunk->finalSmoothingState == SmoothingState_ON);
+    }
+    stats.countSeconds = lapStageTime(&stageStartTime);
+
+    // Size all the scratch memory up front so it fits in one block.
+    // Every face corner could turn out to be a new vertex.
+    uint32_t numCorners = 3 * numFaces;
+    uint32_t numGridSlots = getVertexGridNumSlots(numVertexPositions);
+    size_t scratchArraySizes[] = {
+        numVertexPositions * 3 * sizeof(float), // vpBuffer
+        numVertexTexCoords * 2 * sizeof(float), // vtBuffer
+        numVertexNormals * 3 * sizeof(float), // vnBuffer
+        numCorners * sizeof(ObjFaceCorner), // corners
+        numSubmeshRecords * sizeof(ObjSubmeshRecord), // submeshRecords
+        numGridSlots * sizeof(GridSlot), // vertexGrid.slots
+        numCorners * sizeof(uint32_t), // vertexGrid.chainNext
+        (numSubmeshRecords + 1) * sizeof(Submesh), // submeshBuilder.submeshes
+        numCorners * sizeof(VertexData), // weldedVertices
+        numCorners * sizeof(uint32_t), // weldedIndices
+    };
+    size_t scratchSize = 0;
+    for(size_t i=0; i<sizeof(scratchArraySizes)/sizeof(scratchArraySizes[0]); ++i)
+        scratchSize += scratchArraySizes[i] + DEFAULT_ALLOCATION_ALIGNMENT;
+
+    // Fall back to a temporary arena if the caller's one is too small and
+    // doesn't own its memory, so can't grow
+    Arena localScratchArena = {};
+    Arena* scratch = options.scratchArena;
+    if(scratch) {
+        arenaReset(scratch);
+        if(!arenaReserve(scratch, scratchSize))
+            scratch = NULL;
+    }
+    if(!scratch) {
+        localScratchArena = createArena(scratchSize);
+        scratch = &localScratchArena;
+    }
+
+    ObjParseData parseData;
+    parseData.vpBuffer = (float*)arenaPush(scratch, scratchArraySizes[0]);
+    parseData.vtBuffer = (float*)arenaPush(scratch, scratchArraySizes[1]);
+    parseData.vnBuffer = (float*)arenaPush(scratch, scratchArraySizes[2]);
+    parseData.corners = (ObjFaceCorner*)arenaPush(scratch, scratchArraySizes[3]);
+    parseData.submeshRecords = (ObjSubmeshRecord*)arenaPush(scratch, scratchArraySizes[4]);
+    for(uint32_t i=0; i<numChunks; ++i)
+        chunks[i].parseData = &parseData;
+
+    runJobsInParallel(parseObjChunk, chunks, numChunks, sizeof(ObjChunk), numChunks);
+    stats.parseSeconds = lapStageTime(&stageStartTime);
+
+    const float* vpBuffer = parseData.vpBuffer;
+    const float* vtBuffer = parseData.vtBuffer;
+    const float* vnBuffer = parseData.vnBuffer;
+
+    // Every cell contains at least one distinct vertex position
+    GridSlot* gridSlots = (GridSlot*)arenaPush(scratch, scratchArraySizes[5]);
+    uint32_t* gridChainNext = (uint32_t*)arenaPush(scratch, scratchArraySizes[6]);
+    VertexGrid vertexGrid = createVertexGrid(numVertexPositions, gridSlots, gridChainNext);
+
+    // Files without any 'o', 'g' or 'usemtl' lines are one big submesh,
+    // which gets the whole mesh's bounds once they're known
+    SubmeshBuilder submeshBuilder = {};
+    submeshBuilder.submeshes = (Submesh*)arenaPush(scratch, scratchArraySizes[7]);
+    submeshBuilder.numSubmeshes = 1;
+    memset(submeshBuilder.submeshes, 0, sizeof(Submesh));
+    bool trackSubmeshes = numSubmeshRecords > 0;
+
+    // Weld into scratch memory, then copy out once we know the final sizes
+    VertexData* weldedVertices = (VertexData*)arenaPush(scratch, scratchArraySizes[8]);
+    uint32_t* weldedIndices = (uint32_t*)arenaPush(scratch, scratchArraySizes[9]);
+    assert(weldedIndices); // Pushed last, so if this fit everything did
+    uint32_t numWeldedVertices = 0;
+    uint32_t numWeldedIndices = 0;
+    BoundsBuilder boundsBuilder = {};
+
+    for(uint32_t chunkIdx=0; chunkIdx<numChunks; ++chunkIdx)
+    {
+        const ObjChunk* chunk = chunks + chunkIdx;
+        const ObjFaceCorner* chunkCorners = parseData.corners + chunk->firstCorner;
+        const ObjSubmeshRecord* submeshRecords = parseData.submeshRecords + chunk->firstSubmeshRecord;
+        uint32_t submeshRecordIdx = 0;
+        for(uint32_t cornerIdx=0; cornerIdx<chunk->numCorners; ++cornerIdx)
+        {
+            // Records only come between faces
+            while(submeshRecordIdx < chunk->numParsedSubmeshRecords && submeshRecords[submeshRecordIdx].corner == cornerIdx)
+                applySubmeshRecord(&submeshBuilder, submeshRecords[submeshRecordIdx++], numWeldedIndices);
+
+            const ObjFaceCorner* corner = chunkCorners + cornerIdx;
+            int vpIdx = corner->vp;
+            int vtIdx = corner->vt;
+            int vnIdx = corner->vn;
+
+            VertexData newVert = {};
+            newVert.pos = { vpBuffer[3*vpIdx], vpBuffer[3*vpIdx+1], vpBuffer[3*vpIdx+2] };
+            // Missing UVs and normals are left as zero
+            if(vtIdx >= 0)
+                newVert.uv = { vtBuffer[2*vtIdx], vtBuffer[2*vtIdx+1] };
+            if(vnIdx >= 0)
+                newVert.norm = { vnBuffer[3*vnIdx], vnBuffer[3*vnIdx+1], vnBuffer[3*vnIdx+2] };
+
+            // Search the hash grid for a matching vertex
+            GridCell cell;
+            uint32_t index = findMatchingVertex(vertexGrid, weldedVertices, newVert, corner->smoothNormals, &cell);
+            if(index == INVALID_VERTEX_INDEX)
+            {
+                index = numWeldedVertices++;
+                weldedVertices[index] = newVert;
+                insertVertex(&vertexGrid, cell, index);
+                addBoundsVertex(&boundsBuilder, newVert.pos, index);
+            }
             else {
-                assert((*s == 'o' && *(s+1) == 'n') || (*s >= '1'&& *s <= '9'));
-                smoothNormals = true;
+                weldedVertices[index].norm += newVert.norm;
             }
+            weldedIndices[numWeldedIndices++] = index;
+            if(trackSubmeshes)
+                addSubmeshCorner(&submeshBuilder, newVert.pos);
         }
-        
-        while(*s != 0 && *s++ != '\n');
+        // Records after the chunk's last face
+        while(submeshRecordIdx < chunk->numParsedSubmeshRecords)
+            applySubmeshRecord(&submeshBuilder, submeshRecords[submeshRecordIdx++], numWeldedIndices);
     }
 
-    // Normalise the normals
-    for(uint32_t i=0; i<vertexBufferSize; ++i){
-        VertexData* v = outVertexBuffer + i;
-        v->norm = normalise(v->norm);
+    stats.weldSeconds = lapStageTime(&stageStartTime);
+
+    // Normalise the normals, and finish off the bounding sphere while we're
+    // going over the vertices anyway. The sphere centred on the AABB is
+    // sometimes tighter than Ritter's, so measure that one too and keep
+    // whichever is smaller.
+    MeshBounds bounds = {};
+    if(numWeldedVertices > 0)
+        initBoundingSphere(boundsBuilder, weldedVertices, &bounds);
+    vec3 aabbCenter = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+    float aabbSphereRadiusSquared = 0;
+    for(uint32_t i=0; i<numWeldedVertices; ++i){
+        VertexData* v = weldedVertices + i;
+        v->norm = normaliseOrZero(v->norm);
+        growBoundingSphere(&bounds, v->pos);
+        aabbSphereRadiusSquared = CLAMP_ABOVE(aabbSphereRadiusSquared, lengthSquared(v->pos - aabbCenter));
+    }
+    float aabbSphereRadius = sqrtf(aabbSphereRadiusSquared);
+    if(aabbSphereRadius < bounds.sphereRadius) {
+        bounds.sphereCenter = aabbCenter;
+        bounds.sphereRadius = aabbSphereRadius;
+    }
+    // Rounding in the updates can leave the furthest vertices a hair outside
+    bounds.sphereRadius *= 1.0001f;
+
+    stats.normaliseSeconds = lapStageTime(&stageStartTime);
+
+    // Small meshes only need 16-bit indices
+    result.bytesPerIndex = sizeof(uint32_t);
+    if(numWeldedVertices <= MAX_16BIT_INDEXED_VERTICES)
+        result.bytesPerIndex = sizeof(uint16_t);
+
+    // Only the last submesh can be empty, a new one is only started after faces
+    uint32_t numSubmeshes = submeshBuilder.numSubmeshes;
+    if(!trackSubmeshes) {
+        submeshBuilder.submeshes[0].numIndices = numWeldedIndices;
+        submeshBuilder.submeshes[0].bounds = bounds;
     }
+    else {
+        if(submeshBuilder.submeshes[numSubmeshes-1].numIndices == 0)
+            --numSubmeshes;
+        if(numSubmeshes == 1)
+            submeshBuilder.submeshes[0].bounds = bounds;
+        else for(uint32_t i=0; i<numSubmeshes; ++i)
+            finishSubmeshBounds(&submeshBuilder.submeshes[i].bounds);
+    }
+    if(numWeldedIndices == 0)
+        numSubmeshes = 0;
+
+    result.allocator = options.outputAllocator;
+    result.bounds = bounds;
+    result.numVertices = numWeldedVertices;
+    result.numIndices = numWeldedIndices;
+    result.vertexBuffer = (VertexData*)allocatorAlloc(result.allocator, numWeldedVertices * sizeof(VertexData));
+    result.indexBuffer = allocatorAlloc(result.allocator, numWeldedIndices * result.bytesPerIndex);
+    result.numSubmeshes = numSubmeshes;
+    result.submeshes = (Submesh*)allocatorAlloc(result.allocator, numSubmeshes * sizeof(Submesh));
+    assert((result.vertexBuffer && result.indexBuffer && result.submeshes) || numWeldedIndices == 0);
+    if(numSubmeshes > 0)
+        memcpy(result.submeshes, submeshBuilder.submeshes, numSubmeshes * sizeof(Submesh));
+
+    if(numWeldedVertices > 0)
+        memcpy(result.vertexBuffer, weldedVertices, numWeldedVertices * sizeof(VertexData));
+    for(uint32_t i=0; i<numWeldedIndices; ++i)
+        setIndex(&result, i, weldedIndices[i]);
 
-    free(vpBuffer);
-    free(vtBuffer);
-    free(vnBuffer);
-    free(fileBytes);
+    if(scratch == &localScratchArena)
+        destroyArena(&localScratchArena);
 
-    result.numVertices = vertexBufferSize;
-    result.numIndices = indexBufferSize;
-    result.vertexBuffer = outVertexBuffer;
-    result.indexBuffer = outIndexBuffer;
+    result.numLods = 1;
+    result.lods[0] = { 0, result.numIndices, 0.f };
+
+    if(options.quantiseVertices)
+        quantiseVertices(&result);
+
+    stats.outputSeconds = lapStageTime(&stageStartTime);
+    if(options.stats)
+        *options.stats = stats;
 
     return result;
 }
 
+LoadedObj loadObjFromMemory(const char* begin, const char* end)
+{
+    return loadObjFromMemory(begin, end, LoadObjOptions{});
+}
+
+LoadedObj loadObj(const char* filename, const LoadObjOptions &options)
+{
+    double startTime = getTimeInSeconds();
+    MappedFile file;
+    if(!mapFile(filename, &file)) {
+        assert(false); // Couldn't open the file
+        return LoadedObj{};
+    }
+    double readSeconds = getTimeInSeconds() - startTime;
+
+    const char* begin = (const char*)file.data;
+    LoadedObj result = loadObjFromMemory(begin, begin + file.numBytes, options);
+
+    startTime = getTimeInSeconds();
+    unmapFile(&file);
+    if(options.stats)
+        options.stats->readSeconds = readSeconds + (getTimeInSeconds() - startTime);
+    return result;
+}
+
+LoadedObj loadObj(const char* filename)
+{
+    return loadObj(filename, LoadObjOptions{});
+}
+
 void freeLoadedObj(LoadedObj loadedObj)
 {
-    free(loadedObj.vertexBuffer);
-    free(loadedObj.indexBuffer);
+    allocatorFree(loadedObj.allocator, loadedObj.vertexBuffer);
+    allocatorFree(loadedObj.allocator, loadedObj.indexBuffer);
+    allocatorFree(loadedObj.allocator, loadedObj.quantisedVertexBuffer);
+    allocatorFree(loadedObj.allocator, loadedObj.submeshes);
+}
+
+// Vertex quantisation
+
+static uint16_t quantiseUnorm16(float f)
+{
+    f = CLAMP_BETWEEN(f, 0.f, 1.f);
+    return (uint16_t)(f * 65535.f + 0.5f);
 }
 
-#pragma warning(pop)
+static int16_t quantiseSnorm16(float f)
+{
+    f = CLAMP_BETWEEN(f, -1.f, 1.f);
+    return (int16_t)(f * 32767.f + (f >= 0 ? 0.5f : -0.5f));
+}
+
+// Converts to IEEE 754 half float, rounding to nearest even
+static uint16_t floatToHalf(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7fffffff;
+
+    if(absBits >= 0x7f800000) // inf or nan
+        return (uint16_t)(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0));
+    if(absBits >= 0x477ff000) // too big, round to inf
+        return (uint16_t)(sign | 0x7c00);
+    if(absBits < 0x38800000) // denormal or zero
+    {
+        if(absBits < 0x33000000)
+            return (uint16_t)sign;
+        uint32_t mantissa = (absBits & 0x007fffff) | 0x00800000;
+        uint32_t shift = 126 - (absBits >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if(remainder > halfway || (remainder == halfway && (half & 1)))
+            ++half;
+        return (uint16_t)(sign | half);
+    }
+
+    // Normal: rebias exponent and round the mantissa
+    uint32_t half = (absBits - 0x38000000) >> 13;
+    uint32_t remainder = absBits & 0x1fff;
+    if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        ++half;
+    return (uint16_t)(sign | half);
+}
+
+// Maps a unit vector onto an octahedron and unfolds it into the [-1,1] square.
+// See "A Survey of Efficient Representations for Independent Unit Vectors"
+// by Cigolle et al. (2014)
+static vec2 octahedralEncode(vec3 n)
+{
+    float l1Norm = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if(l1Norm == 0)
+        return {};
+    vec2 p = { n.x / l1Norm, n.y / l1Norm };
+    if(n.z < 0) {
+        vec2 folded = {
+            (1.f - fabsf(p.y)) * (p.x >= 0 ? 1.f : -1.f),
+            (1.f - fabsf(p.x)) * (p.y >= 0 ? 1.f : -1.f)
+        };
+        p = folded;
+    }
+    return p;
+}
+
+void quantiseVertices(LoadedObj* obj)
+{
+    allocatorFree(obj->allocator, obj->quantisedVertexBuffer);
+    obj->quantisedVertexBuffer = (QuantisedVertexData*)allocatorAlloc(obj->allocator, obj->numVertices * sizeof(QuantisedVertexData));
+    assert(obj->quantisedVertexBuffer || obj->numVertices == 0);
+
+    vec3 boundsMin = obj->bounds.aabbMin;
+    obj->positionOffset = boundsMin;
+    obj->positionScale = obj->bounds.aabbMax - boundsMin;
+
+    // Avoid dividing by zero for flat meshes
+    vec3 extents = obj->positionScale;
+    vec3 invExtents = {
+        extents.x > 0 ? 1.f / extents.x : 0,
+        extents.y > 0 ? 1.f / extents.y : 0,
+        extents.z > 0 ? 1.f / extents.z : 0
+    };
+
+    for(uint32_t i=0; i<obj->numVertices; ++i)
+    {
+        const VertexData* v = obj->vertexBuffer + i;
+        QuantisedVertexData* q = obj->quantisedVertexBuffer + i;
+        vec3 p = v->pos - boundsMin;
+        q->pos[0] = quantiseUnorm16(p.x * invExtents.x);
+        q->pos[1] = quantiseUnorm16(p.y * invExtents.y);
+        q->pos[2] = quantiseUnorm16(p.z * invExtents.z);
+        q->pos[3] = 0;
+        q->uv[0] = floatToHalf(v->uv.x);
+        q->uv[1] = floatToHalf(v->uv.y);
+        vec2 octNorm = octahedralEncode(v->norm);
+        q->norm[0] = quantiseSnorm16(octNorm.x);
+        q->norm[1] = quantiseSnorm16(octNorm.y);
+    }
+}
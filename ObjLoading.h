@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include "3DMaths.h"
+#include "Allocator.h"
 
 // NOTE: This is in no way a complete .obj parser.
 // I just did the minimum required to load simple .obj files,
@@ -22,26 +23,221 @@ struct VertexData
     vec2 uv;
     vec3 norm;
 };
+
+// Compact alternative to VertexData, half the size
+struct QuantisedVertexData
+{
+    uint16_t pos[4]; // unorm16 within the mesh's AABB, w is unused padding
+    uint16_t uv[2]; // half floats
+    int16_t norm[2]; // snorm16 octahedral encoding
+};
 #pragma pack(pop)
 
+// A range of the index buffer holding one level of detail of the mesh,
+// see generateLods() in MeshSimplification.h
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t numIndices;
+    float error; // Approximate distance from the full mesh's surface, in model space units
+};
+
+#define MAX_MESH_LODS 8
+
+// Model space bounds, for culling and picking levels of detail
+struct MeshBounds
+{
+    vec3 aabbMin;
+    vec3 aabbMax;
+    vec3 sphereCenter;
+    float sphereRadius;
+};
+
+// Longer names are truncated
+#define SUBMESH_MAX_NAME_LENGTH 64
+
+// A range of the full mesh's indices (lods[0]) with the same object ('o'),
+// group ('g') and material ('usemtl') in the .obj file. All the submeshes
+// share the same vertex and index buffers, so a multi-part model can be
+// drawn with one set of buffers and a DrawIndexed() per submesh.
+struct Submesh
+{
+    uint32_t firstIndex;
+    uint32_t numIndices;
+    MeshBounds bounds;
+    // Empty if the file didn't set them
+    char objectName[SUBMESH_MAX_NAME_LENGTH];
+    char groupName[SUBMESH_MAX_NAME_LENGTH];
+    char materialName[SUBMESH_MAX_NAME_LENGTH];
+};
+
 struct LoadedObj
 {
     uint32_t numVertices;
     uint32_t numIndices;
+    // Meshes with few enough vertices use 16-bit indices to save
+    // memory and bandwidth, larger meshes fall back to 32-bit indices
+    uint32_t bytesPerIndex;
 
     VertexData* vertexBuffer;
-    uint16_t* indexBuffer;
+    void* indexBuffer; // uint16_t or uint32_t, see bytesPerIndex
+
+    // Only filled in if quantiseVertices() was called (or LoadObjOptions::quantiseVertices
+    // was set), in which case it holds the same vertices as vertexBuffer.
+    // Dequantise positions with: pos = quantisedPos/65535 * positionScale + positionOffset
+    QuantisedVertexData* quantisedVertexBuffer;
+    vec3 positionScale;
+    vec3 positionOffset;
+
+    // lods[0] is the full mesh, i.e. the first numIndices indices. Simplified
+    // levels added by generateLods() are stored after it in indexBuffer, in
+    // order of decreasing detail. Everything that works on numIndices (collision,
+    // the optimisation stages) only sees the full mesh, use getLodView() for the rest.
+    uint32_t numLods;
+    MeshLod lods[MAX_MESH_LODS];
+
+    // Bounds of every vertex, filled in by loadObj() as it welds them.
+    // quantiseVertices() and the processing stages use the AABB rather
+    // than going over the vertices again.
+    MeshBounds bounds;
+
+    // In order and covering every index of the full mesh, there's always
+    // at least one unless the mesh is empty. The stages that reorder
+    // triangles (e.g. optimiseVertexCache(), buildMeshlets()) keep them
+    // within their submesh. Simplified levels of detail from generateLods()
+    // are of the whole mesh and aren't split into submeshes.
+    uint32_t numSubmeshes;
+    Submesh* submeshes;
+
+    // Where the buffers above came from. Anything that replaces one of
+    // them (e.g. generateLods()) allocates the new one from here too.
+    Allocator allocator;
+};
+
+inline uint32_t getIndex(const LoadedObj &obj, uint32_t i)
+{
+    if(obj.bytesPerIndex == sizeof(uint16_t))
+        return ((uint16_t*)obj.indexBuffer)[i];
+    return ((uint32_t*)obj.indexBuffer)[i];
+}
+
+inline void setIndex(LoadedObj* obj, uint32_t i, uint32_t value)
+{
+    if(obj->bytesPerIndex == sizeof(uint16_t))
+        ((uint16_t*)obj->indexBuffer)[i] = (uint16_t)value;
+    else
+        ((uint32_t*)obj->indexBuffer)[i] = value;
+}
+
+// Number of indices in indexBuffer, including all levels of detail
+inline uint32_t getTotalNumIndices(const LoadedObj &obj)
+{
+    if(obj.numLods == 0)
+        return obj.numIndices;
+    const MeshLod &lastLod = obj.lods[obj.numLods-1];
+    return lastLod.firstIndex + lastLod.numIndices;
+}
+
+// Returns a LoadedObj which shares obj's buffers but only has the indices of
+// obj.lods[level], so the functions in MeshOptimisation.h can be run on it.
+// Don't call freeLoadedObj() on the result.
+inline LoadedObj getLodView(const LoadedObj &obj, uint32_t level)
+{
+    LoadedObj result = obj;
+    result.numIndices = obj.lods[level].numIndices;
+    result.indexBuffer = (char*)obj.indexBuffer + obj.lods[level].firstIndex * obj.bytesPerIndex;
+    result.numLods = 1;
+    result.lods[0] = { 0, obj.lods[level].numIndices, obj.lods[level].error };
+    result.numSubmeshes = 0; // Ranges don't apply to the simplified levels
+    result.submeshes = NULL;
+    return result;
+}
+
+// Like getLodView(), for a range of the full mesh with the same material etc.
+inline LoadedObj getSubmeshView(const LoadedObj &obj, uint32_t submesh)
+{
+    const Submesh &range = obj.submeshes[submesh];
+    LoadedObj result = obj;
+    result.numIndices = range.numIndices;
+    result.indexBuffer = (char*)obj.indexBuffer + range.firstIndex * obj.bytesPerIndex;
+    result.numLods = 1;
+    result.lods[0] = { 0, range.numIndices, 0.f };
+    result.bounds = range.bounds;
+    result.numSubmeshes = 0;
+    result.submeshes = NULL;
+    return result;
+}
+
+// How long each stage of loading took, see LoadObjOptions::stats
+struct LoadObjStats
+{
+    double readSeconds; // Mapping (and unmapping) the file, only set by loadObj().
+                        // NOTE: The file is paged in during the count stage.
+    double countSeconds; // Splitting the file into chunks and counting elements
+    double parseSeconds; // Including allocating scratch memory
+    double weldSeconds; // Deduplicating vertices
+    double normaliseSeconds;
+    double outputSeconds; // Copying to the output buffers, and quantising if requested
+};
+
+struct LoadObjOptions
+{
+    // Number of threads to parse the file with, including the calling thread.
+    // 0 or 1 parses on the calling thread. Small files may use fewer threads
+    // than requested, see getNumLogicalCores() in Threads.h
+    uint32_t numThreads;
+
+    // Also fill in LoadedObj::quantisedVertexBuffer, see quantiseVertices()
+    bool quantiseVertices;
+
+    // Temporary memory for parsing and welding, reset at the start of each
+    // load. Reusing one arena for loads that run one after another means it
+    // only gets allocated once. Arenas aren't thread-safe, so loads running
+    // at the same time (e.g. in an asset batch) each need their own. If NULL each load mallocs (and frees) its own, which
+    // also happens if the arena is too small and can't grow.
+    Arena* scratchArena;
+
+    // Where the LoadedObj's buffers are allocated, zero-initialised means malloc().
+    // Like scratchArena, an arena allocator can't be used by two loads at once.
+    Allocator outputAllocator;
+
+    // If not NULL, filled in with how long each stage of loading took
+    LoadObjStats* stats;
 };
 
 // Returns a vertex and index buffer loaded from .obj file 'filename'.
 // Vertex buffer format: (tightly packed)
 //   vp.x, vp.y, vp.z, vt.u, vt.v, vn.x, vn.y, vn.z ...
-// Allocates buffers using malloc().
+// Index buffer is uint16_t if the mesh has at most MAX_16BIT_INDEXED_VERTICES
+// vertices, otherwise uint32_t.
+// Only triangles are loaded, faces with more or fewer than 3 vertices are skipped.
+// Allocates buffers using malloc() unless LoadObjOptions::outputAllocator
+// says otherwise. Each load makes one allocation per output buffer, plus
+// one for scratch memory when there's no LoadObjOptions::scratchArena.
 //
 // Usage:
 // LoadedObj myObj = loadObj("test.obj");
 // ... // Send myObj.vertexBuffer to GPU
 // ... // Send myObj.indexBuffer to GPU
 // freeLoadedObj(myObj);
+//
+// The file is memory-mapped rather than copied into a heap buffer.
 LoadedObj loadObj(const char* filename);
+
+// Same as loadObj() but parses .obj file contents in [begin, end).
+// The string does not need to be NUL-terminated.
+LoadedObj loadObjFromMemory(const char* begin, const char* end);
+
+LoadedObj loadObj(const char* filename, const LoadObjOptions &options);
+LoadedObj loadObjFromMemory(const char* begin, const char* end, const LoadObjOptions &options);
+
+// 0xffff is reserved as the strip-cut index so we don't use it
+#define MAX_16BIT_INDEXED_VERTICES 0xffff
+
+// Frees the buffers through loadedObj.allocator
 void freeLoadedObj(LoadedObj loadedObj);
+
+// Fills in obj->quantisedVertexBuffer from obj->vertexBuffer. If you
+// reorder the vertex buffer afterwards you need to call this again, though
+// optimiseVertexFetch() in MeshOptimisation.h keeps both buffers in sync.
+void quantiseVertices(LoadedObj* obj);
@@ -0,0 +1,252 @@
+#include "Threads.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+struct ThreadStartData
+{
+    ThreadProc* proc;
+    void* userData;
+};
+
+static DWORD WINAPI threadStart(LPVOID param)
+{
+    ThreadStartData startData = *(ThreadStartData*)param;
+    free(param);
+    startData.proc(startData.userData);
+    return 0;
+}
+
+Thread threadCreate(ThreadProc* proc, void* userData)
+{
+    ThreadStartData* startData = (ThreadStartData*)malloc(sizeof(ThreadStartData));
+    assert(startData);
+    startData->proc = proc;
+    startData->userData = userData;
+
+    Thread result;
+    result.handle = CreateThread(NULL, 0, threadStart, startData, 0, NULL);
+    assert(result.handle);
+    return result;
+}
+
+void threadJoin(Thread thread)
+{
+    WaitForSingleObject((HANDLE)thread.handle, INFINITE);
+    CloseHandle((HANDLE)thread.handle);
+}
+
+uint32_t getNumLogicalCores()
+{
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwNumberOfProcessors;
+}
+
+void threadYield()
+{
+    SwitchToThread();
+}
+
+Semaphore semaphoreCreate(uint32_t initialCount)
+{
+    Semaphore result;
+    result.handle = CreateSemaphoreW(NULL, (LONG)initialCount, 0x7fffffff, NULL);
+    assert(result.handle);
+    return result;
+}
+
+void semaphoreDestroy(Semaphore semaphore)
+{
+    CloseHandle((HANDLE)semaphore.handle);
+}
+
+void semaphoreSignal(Semaphore semaphore)
+{
+    ReleaseSemaphore((HANDLE)semaphore.handle, 1, NULL);
+}
+
+void semaphoreWait(Semaphore semaphore)
+{
+    WaitForSingleObject((HANDLE)semaphore.handle, INFINITE);
+}
+
+uint32_t atomicIncrement(volatile uint32_t* value)
+{
+    return (uint32_t)InterlockedIncrement((volatile LONG*)value);
+}
+
+uint32_t atomicLoad(volatile uint32_t* value)
+{
+    return (uint32_t)InterlockedOr((volatile LONG*)value, 0);
+}
+
+void atomicStore(volatile uint32_t* value, uint32_t newValue)
+{
+    InterlockedExchange((volatile LONG*)value, (LONG)newValue);
+}
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+struct ThreadStartData
+{
+    ThreadProc* proc;
+    void* userData;
+};
+
+static void* threadStart(void* param)
+{
+    ThreadStartData startData = *(ThreadStartData*)param;
+    free(param);
+    startData.proc(startData.userData);
+    return NULL;
+}
+
+Thread threadCreate(ThreadProc* proc, void* userData)
+{
+    ThreadStartData* startData = (ThreadStartData*)malloc(sizeof(ThreadStartData));
+    assert(startData);
+    startData->proc = proc;
+    startData->userData = userData;
+
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    assert(thread);
+    int error = pthread_create(thread, NULL, threadStart, startData);
+    assert(error == 0);
+    (void)error;
+
+    Thread result;
+    result.handle = thread;
+    return result;
+}
+
+void threadJoin(Thread thread)
+{
+    pthread_t* pthread = (pthread_t*)thread.handle;
+    pthread_join(*pthread, NULL);
+    free(pthread);
+}
+
+uint32_t getNumLogicalCores()
+{
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return (numCores > 0) ? (uint32_t)numCores : 1;
+}
+
+void threadYield()
+{
+    sched_yield();
+}
+
+Semaphore semaphoreCreate(uint32_t initialCount)
+{
+    sem_t* sem = (sem_t*)malloc(sizeof(sem_t));
+    assert(sem);
+    int error = sem_init(sem, 0, initialCount);
+    assert(error == 0);
+    (void)error;
+
+    Semaphore result;
+    result.handle = sem;
+    return result;
+}
+
+void semaphoreDestroy(Semaphore semaphore)
+{
+    sem_t* sem = (sem_t*)semaphore.handle;
+    sem_destroy(sem);
+    free(sem);
+}
+
+void semaphoreSignal(Semaphore semaphore)
+{
+    sem_post((sem_t*)semaphore.handle);
+}
+
+void semaphoreWait(Semaphore semaphore)
+{
+    // Retry if a signal handler interrupted the wait
+    while(sem_wait((sem_t*)semaphore.handle) != 0)
+        ;
+}
+
+uint32_t atomicIncrement(volatile uint32_t* value)
+{
+    return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+uint32_t atomicLoad(volatile uint32_t* value)
+{
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+void atomicStore(volatile uint32_t* value, uint32_t newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+#endif
+
+struct JobRange
+{
+    ThreadProc* proc;
+    char* jobs;
+    size_t jobSize;
+    uint32_t firstJob;
+    uint32_t numJobs;
+};
+
+static void runJobRange(void* userData)
+{
+    JobRange* range = (JobRange*)userData;
+    for(uint32_t i=0; i<range->numJobs; ++i)
+        range->proc(range->jobs + (range->firstJob + i) * range->jobSize);
+}
+
+void runJobsInParallel(ThreadProc* proc, void* jobs, uint32_t numJobs, size_t jobSize, uint32_t numThreads)
+{
+    if(numThreads > numJobs)
+        numThreads = numJobs;
+    if(numThreads <= 1) {
+        JobRange range = { proc, (char*)jobs, jobSize, 0, numJobs };
+        runJobRange(&range);
+        return;
+    }
+
+    JobRange* ranges = (JobRange*)malloc(numThreads * sizeof(JobRange));
+    Thread* threads = (Thread*)malloc(numThreads * sizeof(Thread));
+    assert(ranges && threads);
+
+    // Split jobs into contiguous ranges, one per thread
+    uint32_t firstJob = 0;
+    for(uint32_t i=0; i<numThreads; ++i) {
+        uint32_t numJobsInRange = numJobs / numThreads + (i < numJobs % numThreads ? 1 : 0);
+        ranges[i] = { proc, (char*)jobs, jobSize, firstJob, numJobsInRange };
+        firstJob += numJobsInRange;
+    }
+
+    // The calling thread takes the first range itself
+    for(uint32_t i=1; i<numThreads; ++i)
+        threads[i] = threadCreate(runJobRange, ranges + i);
+    runJobRange(ranges);
+    for(uint32_t i=1; i<numThreads; ++i)
+        threadJoin(threads[i]);
+
+    free(threads);
+    free(ranges);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal wrapper around native threads.
+// Uses CreateThread() on Windows and pthreads elsewhere.
+
+typedef void ThreadProc(void* userData);
+
+struct Thread
+{
+    void* handle;
+};
+
+Thread threadCreate(ThreadProc* proc, void* userData);
+void threadJoin(Thread thread);
+
+uint32_t getNumLogicalCores();
+
+// Gives up the rest of the calling thread's time slice
+void threadYield();
+
+// Counting semaphore, for putting a thread to sleep until there's work for it
+struct Semaphore
+{
+    void* handle;
+};
+
+Semaphore semaphoreCreate(uint32_t initialCount);
+void semaphoreDestroy(Semaphore semaphore);
+void semaphoreSignal(Semaphore semaphore);
+// Blocks until the count is above zero, then decrements it
+void semaphoreWait(Semaphore semaphore);
+
+// Atomic operations on values shared between threads, all of them act as
+// full memory barriers.
+// Returns the incremented value
+uint32_t atomicIncrement(volatile uint32_t* value);
+uint32_t atomicLoad(volatile uint32_t* value);
+void atomicStore(volatile uint32_t* value, uint32_t newValue);
+
+// Runs proc(jobs[i]) for each job, spreading them over up to `numThreads` threads
+// (including the calling thread), and returns when all have finished.
+// `jobs` is an array of `numJobs` elements each `jobSize` bytes in size.
+void runJobsInParallel(ThreadProc* proc, void* jobs, uint32_t numJobs, size_t jobSize, uint32_t numThreads);
@@ -0,0 +1,32 @@
+#include "Timer.h"
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+double getTimeInSeconds()
+{
+    LARGE_INTEGER perfCount, perfFreq;
+    QueryPerformanceCounter(&perfCount);
+    QueryPerformanceFrequency(&perfFreq);
+    return (double)perfCount.QuadPart / (double)perfFreq.QuadPart;
+}
+
+#else
+
+#include <time.h>
+
+double getTimeInSeconds()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+
+// High resolution timer for measuring how long things take.
+// Uses QueryPerformanceCounter() on Windows and clock_gettime() elsewhere.
+//
+// Usage:
+// double startTime = getTimeInSeconds();
+// doWork();
+// double elapsedSeconds = getTimeInSeconds() - startTime;
+
+// Seconds since some arbitrary point, only meaningful relative to other calls
+double getTimeInSeconds();
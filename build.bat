@@ -17,7 +17,7 @@ set LINKER_FLAGS=/INCREMENTAL:NO /opt:ref
 set SYSTEM_LIBS=user32.lib gdi32.lib winmm.lib d3d11.lib d3dcompiler.lib
 
 @REM Uncomment one of these to choose between normal or Single Translation Unit build 
-@REM set SRC_FILES=../main.cpp ../Collision.cpp ../Player.cpp ../Camera.cpp ../ObjLoading.cpp ../D3D11Helpers.cpp
+@REM set SRC_FILES=../main.cpp ../Collision.cpp ../GJK.cpp ../Player.cpp ../Camera.cpp ../ObjLoading.cpp ../Allocator.cpp ../FileMapping.cpp ../Threads.cpp ../Timer.cpp ../AssetLoading.cpp ../AssetCache.cpp ../BakedMesh.cpp ../BakedCollider.cpp ../MeshCompression.cpp ../MeshOptimisation.cpp ../MeshSimplification.cpp ../Meshlets.cpp ../D3D11Helpers.cpp
 set SRC_FILES=../jumbo.cpp
 
 if not exist %BUILD_DIR% mkdir %BUILD_DIR%
@@ -6,7 +6,20 @@
 
 #include "main.cpp"
 #include "Collision.cpp"
+#include "GJK.cpp"
 #include "Player.cpp"
 #include "Camera.cpp"
 #include "ObjLoading.cpp"
+#include "Allocator.cpp"
+#include "FileMapping.cpp"
+#include "Threads.cpp"
+#include "Timer.cpp"
+#include "AssetLoading.cpp"
+#include "AssetCache.cpp"
+#include "BakedMesh.cpp"
+#include "BakedCollider.cpp"
+#include "MeshCompression.cpp"
+#include "MeshOptimisation.cpp"
+#include "MeshSimplification.cpp"
+#include "Meshlets.cpp"
 #include "D3D11Helpers.cpp"
@@ -6,6 +6,7 @@
 #include <d3d11_1.h>
 
 #include <assert.h>
+#include <stdlib.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -16,11 +17,22 @@
 #include "D3D11Helpers.h"
 #include "Input.h"
 #include "ObjLoading.h"
+#include "AssetLoading.h"
+#include "Threads.h"
+#include "MeshSimplification.h"
+#include "Meshlets.h"
 #include "Camera.h"
 #include "Player.h"
 #include "Collision.h"
+#include "BakedCollider.h"
+#include "Hash.h"
 
 #define WINDOW_TITLE L"D3D11"
+// How much streamed asset data to send to the GPU per frame
+#define STREAMING_UPLOAD_BUDGET_BYTES (4 * 1024 * 1024)
+// Processed assets are kept here so later runs can skip loading them from
+// scratch, see AssetCache.h
+#define ASSET_CACHE_DIRECTORY "cache"
 
 // Struct to pass data from WndProc to main loop
 struct WndProcData {
@@ -189,6 +201,29 @@ HWND openWindow(LPCWSTR title, int windowWidth, int windowHeight)
     return hr;
 }
 
+// Spheres and cylinders get drawn at all sorts of distances,
+// each level of detail has about half the triangles of the one before
+static const float LOD_TARGET_RATIOS[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+static const float LOD_MAX_ERRORS[] = { 0.01f, 0.02f, 0.04f, 0.08f };
+
+static void generateMeshLods(LoadedObj* obj, void* /*userData*/)
+{
+    generateLods(obj, LOD_TARGET_RATIOS, LOD_MAX_ERRORS, ARRAYSIZE(LOD_TARGET_RATIOS));
+}
+
+// See AssetRequest::processObjKey
+static uint64_t getMeshLodsKey()
+{
+    return hashBytes64(LOD_MAX_ERRORS, sizeof(LOD_MAX_ERRORS), hashBytes64(LOD_TARGET_RATIOS, sizeof(LOD_TARGET_RATIOS)));
+}
+
+// Whole-object frustum culling with the mesh's bounding sphere
+static bool isMeshVisible(const Mesh &mesh, const mat4 &modelMat, const Frustum &frustum)
+{
+    vec3 center = (v4(mesh.bounds.sphereCenter, 1) * modelMat).xyz;
+    return sphereIntersectsFrustum(frustum, center, mesh.bounds.sphereRadius * getMaxScale(modelMat));
+}
+
 int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /*lpCmdLine*/, int /*nShowCmd*/)
 {
     int windowWidth = 1024;
@@ -211,43 +246,86 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
         perfCounterFrequency = perfFreq.QuadPart;
     }
     double currentTimeInSeconds = 0.0;
-    
+
+    // Start loading assets on worker threads so it overlaps with
+    // setting up D3D11 and compiling shaders
+    enum { ASSET_SPHERE, ASSET_CUBE, NUM_ASSETS };
+    AssetBatch* assetBatch;
+    {
+        LoadObjOptions loadObjOptions = {};
+        loadObjOptions.quantiseVertices = true;
+
+        // Slowest first, so they start straight away
+        AssetRequest assetRequests[NUM_ASSETS] = {};
+        assetRequests[ASSET_SPHERE].type = AssetType_OBJ;
+        assetRequests[ASSET_SPHERE].filename = "data/sphere.obj";
+        assetRequests[ASSET_SPHERE].cacheDirectory = ASSET_CACHE_DIRECTORY;
+        assetRequests[ASSET_SPHERE].objOptions = loadObjOptions;
+        assetRequests[ASSET_SPHERE].processObj = generateMeshLods;
+        assetRequests[ASSET_SPHERE].processObjKey = getMeshLodsKey();
+        assetRequests[ASSET_CUBE].type = AssetType_OBJ;
+        assetRequests[ASSET_CUBE].filename = "data/cube.obj";
+        assetRequests[ASSET_CUBE].cacheDirectory = ASSET_CACHE_DIRECTORY;
+        assetRequests[ASSET_CUBE].objOptions = loadObjOptions;
+
+        assetBatch = beginAssetBatch(assetRequests, NUM_ASSETS, getNumLogicalCores());
+    }
+
     D3D11Data d3d11Data;
     d3d11Init(hWindow, &d3d11Data);
     // TODO: WASAPI init
     // TODO? RawInput init?
 
-    // Create Vertex Shader and Input Layout
+    // Create Vertex Shader and Input Layouts
     ID3D11VertexShader* vertexShader;
-    ID3D11InputLayout* inputLayout;
+    ID3D11InputLayout* inputLayouts[VertexFormat_COUNT];
     {
         // TODO: Parse this from vertex shader code!
-        D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
+        D3D11_INPUT_ELEMENT_DESC floatInputElementDesc[] =
         {
             { "POS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
             { "TEX", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
         };
-        d3d11CreateVertexShaderAndInputLayout(d3d11Data.device, L"shaders.hlsl", "vs_main", &vertexShader, inputElementDesc, ARRAYSIZE(inputElementDesc), &inputLayout);
+        // See QuantisedVertexData. Positions come out in [0,1] and are mapped 
+        // back to model space by Mesh::dequantisationMat
+        D3D11_INPUT_ELEMENT_DESC quantisedInputElementDesc[] =
+        {
+            { "POS", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEX", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+        };
+        D3D11_INPUT_ELEMENT_DESC* inputElementDescs[VertexFormat_COUNT] = { floatInputElementDesc, quantisedInputElementDesc };
+        int numInputElements[VertexFormat_COUNT] = { ARRAYSIZE(floatInputElementDesc), ARRAYSIZE(quantisedInputElementDesc) };
+        d3d11CreateVertexShaderAndInputLayouts(d3d11Data.device, L"shaders.hlsl", "vs_main", &vertexShader, inputElementDescs, numInputElements, VertexFormat_COUNT, inputLayouts);
     }
 
     // Create Pixel Shader
     ID3D11PixelShader* pixelShader = d3d11CreatePixelShader(d3d11Data.device, L"shaders.hlsl", "ps_main");
 
-    LoadedObj cubeObj = loadObj("data/cube.obj");
-    LoadedObj sphereObj = loadObj("data/sphere.obj");
-    LoadedObj cylinderObj = loadObj("data/cylinder.obj");
+    LoadedObj cubeObj = waitForAsset(assetBatch, ASSET_CUBE)->obj;
+    LoadedObj sphereObj = waitForAsset(assetBatch, ASSET_SPHERE)->obj;
+    endAssetBatch(assetBatch);
+
+    // Full detail spheres are drawn in meshlets so the back half can be culled.
+    // NOTE: Built here rather than in the sphere's processObj since meshlets
+    // aren't part of the cached mesh
+    MeshletData sphereMeshlets = buildMeshlets(&sphereObj);
+    MeshletDrawRange* sphereDrawRanges = (MeshletDrawRange*)malloc(sphereMeshlets.numMeshlets * sizeof(MeshletDrawRange));
 
     Mesh cubeMesh = d3d11CreateMesh(d3d11Data.device, cubeObj);
     Mesh sphereMesh = d3d11CreateMesh(d3d11Data.device, sphereObj);
-    Mesh cylinderMesh = d3d11CreateMesh(d3d11Data.device, cylinderObj);
     
-    ColliderPolyhedron cubeColliderData = createColliderPolyhedron(cubeObj);
+    // Colliders are baked offline by tools/colliderbake. Only build one from
+    // the render mesh if the baked file is missing, e.g. the tools haven't been run
+    BakedCollider bakedCubeCollider;
+    ColliderPolyhedron cubeColliderData;
+    bool cubeColliderIsBaked = loadBakedCollider("data/cube.collider", &bakedCubeCollider);
+    if(cubeColliderIsBaked)
+        cubeColliderData = bakedCubeCollider.collider;
+    else
+        cubeColliderData = createColliderPolyhedron(cubeObj);
     
     freeLoadedObj(cubeObj);
     freeLoadedObj(sphereObj);
-    freeLoadedObj(cylinderObj);
-
-    Texture cubeTexture = d3d11CreateTexture(d3d11Data.device, d3d11Data.deviceContext, "data/test.png");
 
     Texture whiteTexture;
     {
@@ -255,6 +333,31 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
         whiteTexture = d3d11CreateTexture(d3d11Data.device, d3d11Data.deviceContext, 1, 1, 4, pixel);
     }
 
+    // The rest is streamed in while the game runs, placeholders
+    // are drawn until the real assets arrive
+    enum { STREAMED_CYLINDER_MESH, STREAMED_CUBE_TEXTURE };
+    AssetStreamer* assetStreamer = createAssetStreamer();
+    {
+        AssetRequest cylinderRequest = {};
+        cylinderRequest.type = AssetType_OBJ;
+        cylinderRequest.filename = "data/cylinder.obj";
+        cylinderRequest.cacheDirectory = ASSET_CACHE_DIRECTORY;
+        cylinderRequest.objOptions.quantiseVertices = true;
+        cylinderRequest.processObj = generateMeshLods;
+        cylinderRequest.processObjKey = getMeshLodsKey();
+        requestAssetStream(assetStreamer, cylinderRequest, STREAMED_CYLINDER_MESH);
+
+        AssetRequest cubeTextureRequest = {};
+        cubeTextureRequest.type = AssetType_IMAGE;
+        cubeTextureRequest.filename = "data/test.png";
+        cubeTextureRequest.cacheDirectory = ASSET_CACHE_DIRECTORY;
+        requestAssetStream(assetStreamer, cubeTextureRequest, STREAMED_CUBE_TEXTURE);
+    }
+    Mesh cylinderMesh = cubeMesh;
+    bool cylinderMeshLoaded = false;
+    Texture cubeTexture = whiteTexture;
+    bool cubeTextureLoaded = false;
+
     // Create Sampler State
     ID3D11SamplerState* samplerState;
     {
@@ -333,8 +436,9 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
         cubeModelMats[i] = scaleMat(cubeScales[i]) * translationMat(cubePositions[i]);
         mat3 invModelMat = scaleMat3(1/cubeScales[i]);
         cubeColliderDatas[i] = cubeColliderData;
-        cubeColliderDatas[i].modelMatrix = cubeModelMats[i];
-        cubeColliderDatas[i].normalMatrix = transpose(invModelMat);
+        // The cubes never move, so this is the only time their world space data gets built
+        setColliderTransform(&cubeColliderDatas[i], cubeModelMats[i], transpose(invModelMat));
+        updateColliderWorldSpace(&cubeColliderDatas[i]);
     }
 
     const int NUM_SPHERES = 4;
@@ -376,6 +480,29 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
 
         keysUpdateWasDownState(wndProcData.keys, KEY_COUNT);
 
+        { // Create GPU resources for streamed assets, limiting how much
+          // gets uploaded each frame so a burst of arrivals doesn't cause a hitch
+            size_t uploadBudget = STREAMING_UPLOAD_BUDGET_BYTES;
+            uint32_t assetId;
+            LoadedAsset asset;
+            while(uploadBudget > 0 && popStreamedAsset(assetStreamer, &assetId, &asset))
+            {
+                size_t uploadSize = getAssetUploadSize(asset);
+                uploadBudget -= CLAMP_BELOW(uploadSize, uploadBudget);
+
+                if(assetId == STREAMED_CYLINDER_MESH) {
+                    cylinderMesh = d3d11CreateMesh(d3d11Data.device, asset.obj);
+                    cylinderMeshLoaded = true;
+                }
+                else if(assetId == STREAMED_CUBE_TEXTURE) {
+                    assert(asset.image.pixels);
+                    cubeTexture = d3d11CreateTexture(d3d11Data.device, d3d11Data.deviceContext, asset.image.width, asset.image.height, asset.image.numChannels, asset.image.pixels);
+                    cubeTextureLoaded = true;
+                }
+                freeLoadedAsset(asset);
+            }
+        }
+
         { // Process Windows message queue
             MSG msg = {};
             while(PeekMessageW(&msg, 0, 0, 0, PM_REMOVE))
@@ -478,6 +605,7 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
         }
 
         mat4 viewPerspectiveMat = viewMat * perspectiveMat;
+        Frustum viewFrustum = frustumFromViewProjectionMat(viewPerspectiveMat);
 
         FLOAT backgroundColor[4] = { 0.1f, 0.2f, 0.6f, 1.0f };
         d3d11Data.deviceContext->ClearRenderTargetView(d3d11Data.msaaRenderTargetView, backgroundColor);
@@ -493,7 +621,6 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
         d3d11Data.deviceContext->OMSetRenderTargets(1, &d3d11Data.msaaRenderTargetView, d3d11Data.depthStencilView);
 
         d3d11Data.deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        d3d11Data.deviceContext->IASetInputLayout(inputLayout);
 
         d3d11Data.deviceContext->VSSetShader(vertexShader, nullptr, 0);
         d3d11Data.deviceContext->PSSetShader(pixelShader, nullptr, 0);
@@ -504,6 +631,9 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
         d3d11Data.deviceContext->PSSetShaderResources(0, 1, &cubeTexture.d3dShaderResourceView);
         d3d11Data.deviceContext->PSSetSamplers(0, 1, &samplerState);
 
+        // Pixels covered by one world space unit at distance 1, for picking levels of detail
+        float lodPixelsPerUnit = 0.5f * windowHeight * perspectiveMat.m[1][1];
+
         { // Draw player capsule collider (just draw 2 spheres and a cylinder between them)
 
             PerObjectPSConstants psConstants = { {0.8f, 0.1f, 0.3f, 1.0f} };
@@ -511,44 +641,60 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
             
             { // Draw cylinder
                 d3d11Data.deviceContext->IASetVertexBuffers(0, 1, &cylinderMesh.vertexBuffer, &cylinderMesh.stride, &cylinderMesh.offset);
-                d3d11Data.deviceContext->IASetIndexBuffer(cylinderMesh.indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+                d3d11Data.deviceContext->IASetInputLayout(inputLayouts[cylinderMesh.vertexFormat]);
+                d3d11Data.deviceContext->IASetIndexBuffer(cylinderMesh.indexBuffer, cylinderMesh.indexFormat, 0);
                 
-                mat4 modelMat = scaleMat({playerCapsuleRadius,playerCapsuleLineSegmentLength,playerCapsuleRadius})
+                mat4 modelMat = cylinderMesh.dequantisationMat
+                * scaleMat({playerCapsuleRadius,playerCapsuleLineSegmentLength,playerCapsuleRadius})
                 * translationMat(player.pos + vec3{0,playerCapsuleRadius,0});
                 PerObjectVSConstants vsConstants = { modelMat * viewPerspectiveMat };
                 d3d11OverwriteConstantBuffer(d3d11Data.deviceContext, perObjectVSConstantBuffer, &vsConstants, sizeof(PerObjectVSConstants));
 
-                d3d11Data.deviceContext->DrawIndexed(cylinderMesh.numIndices, 0, 0);
+                float distance = length(player.pos - camera.pos);
+                float scale = CLAMP_ABOVE(playerCapsuleRadius, playerCapsuleLineSegmentLength);
+                MeshLod lod = cylinderMesh.lods[selectMeshLod(cylinderMesh.lods, cylinderMesh.numLods, lodPixelsPerUnit * scale / distance)];
+                d3d11Data.deviceContext->DrawIndexed(lod.numIndices, lod.firstIndex, 0);
             }
             
             d3d11Data.deviceContext->IASetVertexBuffers(0, 1, &sphereMesh.vertexBuffer, &sphereMesh.stride, &sphereMesh.offset);
-            d3d11Data.deviceContext->IASetIndexBuffer(sphereMesh.indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+            d3d11Data.deviceContext->IASetInputLayout(inputLayouts[sphereMesh.vertexFormat]);
+            d3d11Data.deviceContext->IASetIndexBuffer(sphereMesh.indexBuffer, sphereMesh.indexFormat, 0);
+
+            // Both ends of the capsule are close enough to use the same level of detail
+            float distance = length(player.pos - camera.pos);
+            MeshLod sphereLod = sphereMesh.lods[selectMeshLod(sphereMesh.lods, sphereMesh.numLods, lodPixelsPerUnit * playerCapsuleRadius / distance)];
             
             { // Draw sphere 1
-                mat4 modelMat = scaleMat(playerCapsuleRadius)
+                mat4 modelMat = sphereMesh.dequantisationMat
+                * scaleMat(playerCapsuleRadius)
                 * translationMat(player.pos + vec3{0,playerCapsuleRadius,0});
                 PerObjectVSConstants vsConstants = { modelMat * viewPerspectiveMat };
                 d3d11OverwriteConstantBuffer(d3d11Data.deviceContext, perObjectVSConstantBuffer, &vsConstants, sizeof(PerObjectVSConstants));
 
-                d3d11Data.deviceContext->DrawIndexed(sphereMesh.numIndices, 0, 0);
+                d3d11Data.deviceContext->DrawIndexed(sphereLod.numIndices, sphereLod.firstIndex, 0);
             }
             
             { // Draw sphere 2
-                mat4 modelMat = scaleMat(playerCapsuleRadius)
+                mat4 modelMat = sphereMesh.dequantisationMat
+                * scaleMat(playerCapsuleRadius)
                 * translationMat(player.pos + vec3{0,playerCapsuleRadius+playerCapsuleLineSegmentLength,0});
                 PerObjectVSConstants vsConstants = { modelMat * viewPerspectiveMat };
                 d3d11OverwriteConstantBuffer(d3d11Data.deviceContext, perObjectVSConstantBuffer, &vsConstants, sizeof(PerObjectVSConstants));
 
-                d3d11Data.deviceContext->DrawIndexed(sphereMesh.numIndices, 0, 0);
+                d3d11Data.deviceContext->DrawIndexed(sphereLod.numIndices, sphereLod.firstIndex, 0);
             }
         }
 
         { // Draw cubes
             d3d11Data.deviceContext->IASetVertexBuffers(0, 1, &cubeMesh.vertexBuffer, &cubeMesh.stride, &cubeMesh.offset);
-            d3d11Data.deviceContext->IASetIndexBuffer(cubeMesh.indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+            d3d11Data.deviceContext->IASetInputLayout(inputLayouts[cubeMesh.vertexFormat]);
+            d3d11Data.deviceContext->IASetIndexBuffer(cubeMesh.indexBuffer, cubeMesh.indexFormat, 0);
             
             for(int i=0; i<NUM_CUBES; ++i) {
-                PerObjectVSConstants vsConstants = { cubeModelMats[i] * viewPerspectiveMat};
+                if(!isMeshVisible(cubeMesh, cubeModelMats[i], viewFrustum))
+                    continue;
+
+                PerObjectVSConstants vsConstants = { cubeMesh.dequantisationMat * cubeModelMats[i] * viewPerspectiveMat};
                 d3d11OverwriteConstantBuffer(d3d11Data.deviceContext, perObjectVSConstantBuffer, &vsConstants, sizeof(PerObjectVSConstants));
             
                 PerObjectPSConstants psConstants = { cubeTintColours[i] };
@@ -560,18 +706,32 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
 
         { // Draw spheres
             d3d11Data.deviceContext->IASetVertexBuffers(0, 1, &sphereMesh.vertexBuffer, &sphereMesh.stride, &sphereMesh.offset);
-            d3d11Data.deviceContext->IASetIndexBuffer(sphereMesh.indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+            d3d11Data.deviceContext->IASetInputLayout(inputLayouts[sphereMesh.vertexFormat]);
+            d3d11Data.deviceContext->IASetIndexBuffer(sphereMesh.indexBuffer, sphereMesh.indexFormat, 0);
             
             d3d11Data.deviceContext->PSSetShaderResources(0, 1, &whiteTexture.d3dShaderResourceView);
             
             for(int i=0; i<NUM_SPHERES; ++i) {
-                PerObjectVSConstants vsConstants = { sphereModelMats[i] * viewPerspectiveMat};
+                if(!isMeshVisible(sphereMesh, sphereModelMats[i], viewFrustum))
+                    continue;
+
+                PerObjectVSConstants vsConstants = { sphereMesh.dequantisationMat * sphereModelMats[i] * viewPerspectiveMat};
                 d3d11OverwriteConstantBuffer(d3d11Data.deviceContext, perObjectVSConstantBuffer, &vsConstants, sizeof(PerObjectVSConstants));
             
                 PerObjectPSConstants psConstants = { sphereTintColours[i] };
                 d3d11OverwriteConstantBuffer(d3d11Data.deviceContext, perObjectPSConstantBuffer, &psConstants, sizeof(PerObjectPSConstants));
 
-                d3d11Data.deviceContext->DrawIndexed(sphereMesh.numIndices, 0, 0);
+                float distance = length(spherePositions[i] - camera.pos);
+                uint32_t lodLevel = selectMeshLod(sphereMesh.lods, sphereMesh.numLods, lodPixelsPerUnit * sphereScales[i] / distance);
+                if(lodLevel == 0) {
+                    uint32_t numRanges = cullMeshlets(sphereMeshlets, sphereModelMats[i], viewFrustum, camera.pos, sphereDrawRanges);
+                    for(uint32_t r=0; r<numRanges; ++r)
+                        d3d11Data.deviceContext->DrawIndexed(sphereDrawRanges[r].numIndices, sphereDrawRanges[r].firstIndex, 0);
+                }
+                else {
+                    MeshLod lod = sphereMesh.lods[lodLevel];
+                    d3d11Data.deviceContext->DrawIndexed(lod.numIndices, lod.firstIndex, 0);
+                }
             }
         }
 
@@ -584,17 +744,30 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR /
     rasterizerState->Release();
     perObjectPSConstantBuffer->Release();
     perObjectVSConstantBuffer->Release();
+    destroyAssetStreamer(assetStreamer);
+    for(int i=0; i<NUM_CUBES; ++i)
+        freeColliderWorldSpace(&cubeColliderDatas[i]);
+    if(cubeColliderIsBaked)
+        unloadBakedCollider(&bakedCubeCollider);
+    else
+        freeColliderPolyhedron(cubeColliderData);
     whiteTexture.d3dShaderResourceView->Release();
-    cubeTexture.d3dShaderResourceView->Release();
+    if(cubeTextureLoaded)
+        cubeTexture.d3dShaderResourceView->Release();
     samplerState->Release();
-    cylinderMesh.indexBuffer->Release();
-    cylinderMesh.vertexBuffer->Release();
+    if(cylinderMeshLoaded) {
+        cylinderMesh.indexBuffer->Release();
+        cylinderMesh.vertexBuffer->Release();
+    }
     sphereMesh.indexBuffer->Release();
     sphereMesh.vertexBuffer->Release();
+    freeMeshletData(sphereMeshlets);
+    free(sphereDrawRanges);
     cubeMesh.indexBuffer->Release();
     cubeMesh.vertexBuffer->Release();
     pixelShader->Release();
-    inputLayout->Release();
+    for(int i=0; i<VertexFormat_COUNT; ++i)
+        inputLayouts[i]->Release();
     vertexShader->Release();
     d3d11Data.depthStencilView->Release();
     d3d11Data.msaaRenderTarget->Release();
@@ -0,0 +1,23 @@
+#pragma once
+
+// Helpers shared by the command line tools in this directory
+
+#include <stddef.h>
+#include <string.h>
+
+// Replaces the extension of `filename` (or appends one if it doesn't have one)
+static bool replaceExtension(const char* filename, const char* newExtension, char* result, size_t resultSize)
+{
+    const char* extension = strrchr(filename, '.');
+    const char* lastSlash = strrchr(filename, '/');
+    const char* lastBackslash = strrchr(filename, '\\');
+    if(!extension || (lastSlash && lastSlash > extension) || (lastBackslash && lastBackslash > extension))
+        extension = filename + strlen(filename);
+
+    size_t baseLength = extension - filename;
+    if(baseLength + strlen(newExtension) + 1 > resultSize)
+        return false;
+    memcpy(result, filename, baseLength);
+    strcpy(result + baseLength, newExtension);
+    return true;
+}
@@ -0,0 +1,21 @@
+@echo off
+
+@REM Builds the offline tools and benchmarks in tools\ into build-tools\
+
+set COMPILER_FLAGS=/nologo /EHa- /GR- /fp:fast /Oi /W4 /FC /DNDEBUG /O2
+
+set BUILD_DIR=%~dp0..\build-tools\
+if not exist %BUILD_DIR% mkdir %BUILD_DIR%
+pushd %BUILD_DIR%
+
+cl %COMPILER_FLAGS% ..\tools\objbake.cpp /Feobjbake.exe
+cl %COMPILER_FLAGS% ..\tools\colliderbake.cpp /Fecolliderbake.exe
+cl %COMPILER_FLAGS% ..\tools\objbench.cpp /Feobjbench.exe
+cl %COMPILER_FLAGS% ..\tools\collisionbench.cpp /Fecollisionbench.exe
+cl %COMPILER_FLAGS% ..\tools\objgen.cpp /Feobjgen.exe
+cl %COMPILER_FLAGS% ..\tools\objweldcheck.cpp /Feobjweldcheck.exe
+cl %COMPILER_FLAGS% ..\tools\meshcheck.cpp /Femeshcheck.exe
+
+popd
+
+echo Done
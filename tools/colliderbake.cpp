@@ -0,0 +1,56 @@
+// Converts .obj files to the binary .collider format described in BakedCollider.h.
+// Built as a single translation unit, like jumbo.cpp.
+//
+// Usage: colliderbake file.obj [file2.obj ...]
+// Writes file.collider next to each input file. The mesh should be convex,
+// see createColliderPolyhedron().
+
+#include "../ObjLoading.cpp"
+#include "../Allocator.cpp"
+#include "../FileMapping.cpp"
+#include "../Threads.cpp"
+#include "../Timer.cpp"
+#include "../Collision.cpp"
+#include "../GJK.cpp"
+#include "../BakedCollider.cpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ToolHelpers.h"
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        printf("Usage: colliderbake file.obj [file2.obj ...]\n");
+        return 1;
+    }
+
+    int numFailures = 0;
+    for(int i=1; i<argc; ++i)
+    {
+        const char* objFilename = argv[i];
+        char colliderFilename[1024];
+        if(!replaceExtension(objFilename, ".collider", colliderFilename, sizeof(colliderFilename))) {
+            printf("%s: path too long\n", objFilename);
+            ++numFailures;
+            continue;
+        }
+
+        LoadedObj obj = loadObj(objFilename);
+        ColliderPolyhedron collider = createColliderPolyhedron(obj);
+
+        if(writeBakedCollider(colliderFilename, collider)) {
+            printf("%s -> %s\n", objFilename, colliderFilename);
+            printf("  %u triangles -> %u faces, %u edges (%u directions), %u vertices\n",
+                obj.numIndices / 3, collider.numPlanes, collider.numEdges, collider.numEdgeDirections, collider.numVertices);
+        }
+        else {
+            printf("%s: failed to write %s\n", objFilename, colliderFilename);
+            ++numFailures;
+        }
+        freeColliderPolyhedron(collider);
+        freeLoadedObj(obj);
+    }
+    return numFailures;
+}
@@ -0,0 +1,388 @@
+// Microbenchmarks for the polyhedron collision tests.
+// Built as a single translation unit, like jumbo.cpp, so it can
+// call the collision code's internal functions directly.
+//
+// Usage: collisionbench file.obj [file2.obj ...]
+// Builds a collider from each file and times the kernels the separating
+// axis tests spend their time in, against random shapes and axes: the
+// vertex projections and the plane distances for spheres, capsules and
+// cylinders. Each is timed with the old AoS loops, the scalar SoA versions
+// and the SIMD versions, and checked against the AoS results.
+// Then times the full separating axis tests (checkCollisionSat(), which
+// checkCollision() uses for polyhedron pairs with few edges) against
+// checkCollisionGjk() for the same pairs, and counts where they disagree.
+
+#define COLLISION_BENCHMARK
+#include "../Collision.cpp"
+#include "../GJK.cpp"
+#include "../ObjLoading.cpp"
+#include "../Allocator.cpp"
+#include "../FileMapping.cpp"
+#include "../Threads.cpp"
+#include "../Timer.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_QUERIES 100000
+#define NUM_RUNS 10
+// The separating axis tests take milliseconds per pair on big colliders, so use fewer of them
+#define NUM_NARROWPHASE_QUERIES 10000
+#define NUM_POLYHEDRON_PAIRS 100
+
+// Results further apart than this, relative to the collider's size, count as mismatches
+#define MISMATCH_TOLERANCE 0.0001f
+
+enum QueryShape
+{
+    QueryShape_SPHERE,
+    QueryShape_CAPSULE,
+    QueryShape_CYLINDER,
+    QueryShape_COUNT
+};
+
+static const char* QUERY_SHAPE_NAMES[QueryShape_COUNT] = { "sphere", "capsule", "cylinder" };
+
+struct Query
+{
+    vec3 axis; // For the projections
+    vec3 p0;
+    vec3 p1;
+    float radius;
+};
+
+// The world space features the way they were stored before they were split
+// into SoA arrays, to compare against
+struct AosCollider
+{
+    u32 numVertices;
+    vec3* vertices;
+    u32 numPlanes;
+    vec4* planes; // (normal, d)
+};
+
+static float randomFloat(float min, float max)
+{
+    return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+static vec3 randomVec3(float min, float max)
+{
+    return vec3{randomFloat(min, max), randomFloat(min, max), randomFloat(min, max)};
+}
+
+static float findMinProjectionAos(const AosCollider &poly, vec3 axis)
+{
+    float minDist = 1E+37;
+    for(u32 i=0; i<poly.numVertices; ++i)
+    {
+        float dist = dot(poly.vertices[i], axis);
+        minDist = CLAMP_BELOW(minDist, dist);
+    }
+    return minDist;
+}
+
+// The plane loops from checkCollision() before the SoA kernels
+static float findMinPlanePenetrationAos(const AosCollider &poly, QueryShape shape, const Query &query, u32* minPlane)
+{
+    ColliderCapsule capsule = {query.p0, query.p1, query.radius};
+    ColliderCylinder cylinder = {query.p0, query.p1, query.radius};
+    float minPenetration = 1E+37;
+    *minPlane = 0;
+    for(u32 i=0; i<poly.numPlanes; ++i)
+    {
+        vec4 plane = poly.planes[i];
+        vec3 furthestPoint;
+        if(shape == QueryShape_SPHERE)
+            furthestPoint = query.p0 - plane.xyz*query.radius;
+        else if(shape == QueryShape_CAPSULE)
+            furthestPoint = getFurthestPointInDir(capsule, -plane.xyz);
+        else
+            furthestPoint = getFurthestPointInDir(cylinder, -plane.xyz);
+        float penetration = plane.w - dot(furthestPoint, plane.xyz);
+        if(penetration < 0) {
+            *minPlane = i;
+            return penetration;
+        }
+        if(penetration < minPenetration) {
+            minPenetration = penetration;
+            *minPlane = i;
+        }
+    }
+    return minPenetration;
+}
+
+enum KernelVersion
+{
+    KernelVersion_AOS,
+    KernelVersion_SCALAR,
+    KernelVersion_SIMD,
+    KernelVersion_COUNT
+};
+
+static const char* getKernelVersionName(KernelVersion version)
+{
+    switch(version) {
+        case KernelVersion_AOS: return "AoS";
+        case KernelVersion_SCALAR: return "SoA scalar";
+#if COLLISION_SIMD_WIDTH == 8
+        case KernelVersion_SIMD: return "SoA simd8";
+#elif COLLISION_SIMD_WIDTH == 4
+        case KernelVersion_SIMD: return "SoA simd4";
+#else
+        case KernelVersion_SIMD: return "SoA no simd";
+#endif
+        default: return "";
+    }
+}
+
+// Returns the fastest time of several runs to project the collider onto
+// every query's axis, in seconds. Writes the results to `results`.
+static double timeProjections(KernelVersion version, const ColliderPolyhedron &poly, const AosCollider &aos, const Query* queries, float* results)
+{
+    double bestTime = 1e30;
+    for(int run=0; run<NUM_RUNS; ++run)
+    {
+        double startTime = getTimeInSeconds();
+        for(u32 i=0; i<NUM_QUERIES; ++i)
+        {
+            if(version == KernelVersion_AOS)
+                results[i] = findMinProjectionAos(aos, queries[i].axis);
+            else if(version == KernelVersion_SCALAR)
+                results[i] = findMinProjectionScalar(poly, queries[i].axis);
+            else
+                results[i] = findMinProjection(poly, queries[i].axis);
+        }
+        double time = getTimeInSeconds() - startTime;
+        if(time < bestTime)
+            bestTime = time;
+    }
+    return bestTime;
+}
+
+// Same as timeProjections() for the plane distances to every query's shape
+static double timePlanePenetrations(KernelVersion version, QueryShape shape, const ColliderPolyhedron &poly, const AosCollider &aos, const Query* queries, float* results)
+{
+    double bestTime = 1e30;
+    for(int run=0; run<NUM_RUNS; ++run)
+    {
+        double startTime = getTimeInSeconds();
+        for(u32 i=0; i<NUM_QUERIES; ++i)
+        {
+            const Query &query = queries[i];
+            vec3 p1 = (shape == QueryShape_SPHERE) ? query.p0 : query.p1;
+            vec3 discNormal = (shape == QueryShape_CYLINDER) ? normalise(query.p1 - query.p0) : vec3{};
+            u32 minPlane;
+            if(version == KernelVersion_AOS)
+                results[i] = findMinPlanePenetrationAos(aos, shape, query, &minPlane);
+            else if(version == KernelVersion_SCALAR)
+                results[i] = findMinPlanePenetrationScalar(poly, query.p0, p1, query.radius, discNormal, &minPlane);
+            else
+                results[i] = findMinPlanePenetration(poly, query.p0, p1, query.radius, discNormal, &minPlane);
+        }
+        double time = getTimeInSeconds() - startTime;
+        if(time < bestTime)
+            bestTime = time;
+    }
+    return bestTime;
+}
+
+static u32 countMismatches(const float* a, const float* b, float tolerance)
+{
+    u32 result = 0;
+    for(u32 i=0; i<NUM_QUERIES; ++i)
+        result += (fabsf(a[i] - b[i]) > tolerance);
+    return result;
+}
+
+static void printTimes(const char* name, const double* times, const u32* mismatches)
+{
+    // Nanoseconds per query
+    double scale = 1e9 / NUM_QUERIES;
+    printf("  %s, %u queries:\n", name, NUM_QUERIES);
+    for(int version=0; version<KernelVersion_COUNT; ++version)
+    {
+        printf("    %-12s %8.3f ms %7.1f ns/query %5.2fx", getKernelVersionName((KernelVersion)version),
+            times[version] * 1000.0, times[version] * scale, times[KernelVersion_AOS] / times[version]);
+        if(version != KernelVersion_AOS)
+            printf(", %u mismatches", mismatches[version]);
+        printf("\n");
+    }
+}
+
+static void printNarrowphaseTimes(const char* name, u32 numQueries, double satTime, double gjkTime, u32 numHits, u32 numDisagreements)
+{
+    printf("  %s, %u queries, %u hits, %u disagreements:\n", name, numQueries, numHits, numDisagreements);
+    printf("    SAT %10.3f ms %8.2f us/query\n", satTime * 1000.0, satTime * 1e6 / numQueries);
+    printf("    GJK %10.3f ms %8.2f us/query %6.2fx\n", gjkTime * 1000.0, gjkTime * 1e6 / numQueries, satTime / gjkTime);
+}
+
+// Times checkCollision() and checkCollisionGjk() for the pairs with a
+// separating axis test. `other` is an untransformed copy of `poly` to
+// collide it with.
+static void benchmarkNarrowphase(const ColliderPolyhedron &poly, ColliderPolyhedron other, const Query* queries)
+{
+    for(int shape=0; shape<QueryShape_COUNT; ++shape)
+    {
+        double satTime = 0;
+        double gjkTime = 0;
+        u32 numHits = 0;
+        u32 numDisagreements = 0;
+        for(u32 i=0; i<NUM_NARROWPHASE_QUERIES; ++i)
+        {
+            const Query &query = queries[i];
+            ColliderSphere sphere = {query.p0, query.radius};
+            ColliderCapsule capsule = {query.p0, query.p1, query.radius};
+            ColliderCylinder cylinder = {query.p0, query.p1, query.radius};
+
+            double startTime = getTimeInSeconds();
+            bool satResult;
+            if(shape == QueryShape_SPHERE)
+                satResult = checkCollision(poly, sphere).isColliding;
+            else if(shape == QueryShape_CAPSULE)
+                satResult = checkCollision(capsule, poly).isColliding;
+            else
+                satResult = checkCollision(cylinder, poly).isColliding;
+            double midTime = getTimeInSeconds();
+            bool gjkResult;
+            if(shape == QueryShape_SPHERE)
+                gjkResult = checkCollisionGjk(makeConvexShape(poly), makeConvexShape(sphere)).isColliding;
+            else if(shape == QueryShape_CAPSULE)
+                gjkResult = checkCollisionGjk(makeConvexShape(capsule), makeConvexShape(poly)).isColliding;
+            else
+                gjkResult = checkCollisionGjk(makeConvexShape(cylinder), makeConvexShape(poly)).isColliding;
+            double endTime = getTimeInSeconds();
+
+            satTime += midTime - startTime;
+            gjkTime += endTime - midTime;
+            numHits += gjkResult;
+            numDisagreements += (satResult != gjkResult);
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "polyhedron vs %s", QUERY_SHAPE_NAMES[shape]);
+        printNarrowphaseTimes(name, NUM_NARROWPHASE_QUERIES, satTime, gjkTime, numHits, numDisagreements);
+    }
+
+    double satTime = 0;
+    double gjkTime = 0;
+    u32 numHits = 0;
+    u32 numDisagreements = 0;
+    for(u32 i=0; i<NUM_POLYHEDRON_PAIRS; ++i)
+    {
+        const Query &query = queries[i];
+        mat4 modelMatrix = rotateXMat(query.radius * 10.f) * rotateYMat(query.axis.x * 3.f) * translationMat(query.p0);
+        mat3 normalMatrix;
+        for(int column=0; column<3; ++column)
+            normalMatrix.cols[column] = v4(modelMatrix.cols[column].xyz, 0);
+        setColliderTransform(&other, modelMatrix, normalMatrix);
+        updateColliderWorldSpace(&other);
+
+        double startTime = getTimeInSeconds();
+        bool satResult = checkCollisionSat(poly, other).isColliding;
+        double midTime = getTimeInSeconds();
+        bool gjkResult = checkCollisionGjk(makeConvexShape(poly), makeConvexShape(other)).isColliding;
+        double endTime = getTimeInSeconds();
+
+        satTime += midTime - startTime;
+        gjkTime += endTime - midTime;
+        numHits += gjkResult;
+        numDisagreements += (satResult != gjkResult);
+    }
+    printNarrowphaseTimes("polyhedron vs polyhedron", NUM_POLYHEDRON_PAIRS, satTime, gjkTime, numHits, numDisagreements);
+    freeColliderWorldSpace(&other);
+}
+
+static void benchmarkCollider(const char* filename)
+{
+    LoadedObj obj = loadObj(filename);
+    if(obj.numIndices == 0) {
+        printf("Failed to load %s\n", filename);
+        freeLoadedObj(obj);
+        return;
+    }
+    ColliderPolyhedron poly = createColliderPolyhedron(obj);
+    ColliderPolyhedron untransformedPoly = poly;
+    freeLoadedObj(obj);
+
+    // Non-uniform scale and a rotation so nothing lines up with the axes
+    vec3 scale = {1.5f, 1.f, 2.f};
+    mat4 modelMatrix = scaleMat(scale) * rotateYMat(0.7f) * translationMat(vec3{0.5f, -0.25f, 1.f});
+    mat3 normalMatrix = scaleMat3(vec3{1/scale.x, 1/scale.y, 1/scale.z}) * rotateYMat3(0.7f);
+    setColliderTransform(&poly, modelMatrix, normalMatrix);
+    updateColliderWorldSpace(&poly);
+
+    AosCollider aos = {};
+    aos.numVertices = poly.numVertices;
+    aos.vertices = (vec3*)malloc(poly.numVertices * sizeof(vec3));
+    aos.numPlanes = poly.numPlanes;
+    aos.planes = (vec4*)malloc(poly.numPlanes * sizeof(vec4));
+    assert(aos.vertices && aos.planes);
+    for(u32 i=0; i<poly.numVertices; ++i)
+        aos.vertices[i] = vec3{poly.worldVertexX[i], poly.worldVertexY[i], poly.worldVertexZ[i]};
+    for(u32 i=0; i<poly.numPlanes; ++i)
+        aos.planes[i] = v4(vec3{poly.worldPlaneNormalX[i], poly.worldPlaneNormalY[i], poly.worldPlaneNormalZ[i]}, poly.worldPlaneD[i]);
+
+    // Shapes scattered around the collider so some overlap it and the rest
+    // are separated after a varying number of planes
+    float size = poly.boundingSphereRadius * 2.f;
+    srand(1);
+    Query* queries = (Query*)malloc(NUM_QUERIES * sizeof(Query));
+    assert(queries);
+    for(u32 i=0; i<NUM_QUERIES; ++i)
+    {
+        Query* query = queries + i;
+        query->axis = normalise(randomVec3(-1, 1) + vec3{0.001f, 0, 0});
+        query->p0 = poly.worldCentroid + randomVec3(-size, size);
+        query->p1 = query->p0 + normalise(randomVec3(-1, 1) + vec3{0, 0.001f, 0}) * randomFloat(0.1f, 1.f) * size;
+        query->radius = randomFloat(0.05f, 0.5f) * size;
+    }
+
+    printf("%s: %u planes, %u vertices\n", filename, poly.numPlanes, poly.numVertices);
+
+    float tolerance = MISMATCH_TOLERANCE * size;
+    float* results[KernelVersion_COUNT];
+    for(int version=0; version<KernelVersion_COUNT; ++version) {
+        results[version] = (float*)malloc(NUM_QUERIES * sizeof(float));
+        assert(results[version]);
+    }
+    double times[KernelVersion_COUNT];
+    u32 mismatches[KernelVersion_COUNT] = {};
+
+    for(int version=0; version<KernelVersion_COUNT; ++version) {
+        times[version] = timeProjections((KernelVersion)version, poly, aos, queries, results[version]);
+        mismatches[version] = countMismatches(results[KernelVersion_AOS], results[version], tolerance);
+    }
+    printTimes("vertex projections", times, mismatches);
+
+    for(int shape=0; shape<QueryShape_COUNT; ++shape)
+    {
+        for(int version=0; version<KernelVersion_COUNT; ++version) {
+            times[version] = timePlanePenetrations((KernelVersion)version, (QueryShape)shape, poly, aos, queries, results[version]);
+            mismatches[version] = countMismatches(results[KernelVersion_AOS], results[version], tolerance);
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "%s plane distances", QUERY_SHAPE_NAMES[shape]);
+        printTimes(name, times, mismatches);
+    }
+
+    benchmarkNarrowphase(poly, untransformedPoly, queries);
+
+    for(int version=0; version<KernelVersion_COUNT; ++version)
+        free(results[version]);
+    free(queries);
+    free(aos.planes);
+    free(aos.vertices);
+    freeColliderWorldSpace(&poly);
+    freeColliderPolyhedron(poly);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        printf("Usage: collisionbench file.obj [file2.obj ...]\n");
+        return 1;
+    }
+    for(int i=1; i<argc; ++i)
+        benchmarkCollider(argv[i]);
+    return 0;
+}
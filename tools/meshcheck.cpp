@@ -0,0 +1,126 @@
+// Checks loadBakedMesh() accepts .mesh files written by objbake and rejects
+// truncated copies of them, like a cache file that was only partly written.
+// Built as a single translation unit, like jumbo.cpp.
+//
+// Usage: meshcheck file.mesh [file2.mesh ...]
+// Each file has to load and pass its checksum. Then copies cut off at several
+// sizes, down to an empty file, are written to the temp directory and must all
+// fail to load. Returns the number of files that failed either check.
+
+#pragma warning(disable:4996) // disable warning that getenv() is unsafe
+
+#include "../ObjLoading.cpp"
+#include "../Allocator.cpp"
+#include "../FileMapping.cpp"
+#include "../Threads.cpp"
+#include "../Timer.cpp"
+#include "../BakedMesh.cpp"
+#include "../MeshCompression.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+static bool getTruncatedFilename(char* result, size_t resultSize)
+{
+    char directory[MAX_PATH + 1];
+    DWORD length = GetTempPathA(sizeof(directory), directory);
+    if(length == 0 || length > sizeof(directory))
+        return false;
+    int written = snprintf(result, resultSize, "%smeshcheck-%u.mesh", directory, (uint32_t)GetCurrentProcessId());
+    return written > 0 && written < (int)resultSize;
+}
+
+#else
+
+#include <unistd.h>
+
+static bool getTruncatedFilename(char* result, size_t resultSize)
+{
+    const char* directory = getenv("TMPDIR");
+    if(!directory || !directory[0])
+        directory = "/tmp";
+    int written = snprintf(result, resultSize, "%s/meshcheck-%u.mesh", directory, (uint32_t)getpid());
+    return written > 0 && written < (int)resultSize;
+}
+
+#endif
+
+// Returns false if the file doesn't load or any truncated copy of it does
+static bool checkMesh(const char* meshFilename, const char* truncatedFilename)
+{
+    BakedMesh bakedMesh;
+    if(!loadBakedMesh(meshFilename, &bakedMesh)) {
+        printf("%s: failed to load\n", meshFilename);
+        return false;
+    }
+    bool checksumIsValid = bakedMeshChecksumIsValid(bakedMesh);
+    unloadBakedMesh(&bakedMesh);
+    if(!checksumIsValid) {
+        printf("%s: checksum doesn't match\n", meshFilename);
+        return false;
+    }
+
+    MappedFile file;
+    if(!mapFile(meshFilename, &file)) {
+        printf("%s: failed to open\n", meshFilename);
+        return false;
+    }
+
+    size_t truncatedSizes[] = { 0, 1, sizeof(BakedMeshHeader) - 1, sizeof(BakedMeshHeader), file.numBytes / 2, file.numBytes - 1 };
+    bool result = true;
+    for(size_t i=0; i<sizeof(truncatedSizes)/sizeof(truncatedSizes[0]); ++i)
+    {
+        size_t numBytes = CLAMP_BELOW(truncatedSizes[i], file.numBytes - 1);
+        FILE* truncatedFile = fopen(truncatedFilename, "wb");
+        if(!truncatedFile) {
+            printf("Failed to write %s\n", truncatedFilename);
+            result = false;
+            break;
+        }
+        fwrite(file.data, 1, numBytes, truncatedFile);
+        fclose(truncatedFile);
+
+        if(loadBakedMesh(truncatedFilename, &bakedMesh)) {
+            printf("%s: loadBakedMesh() accepted the first %zu bytes\n", meshFilename, numBytes);
+            unloadBakedMesh(&bakedMesh);
+            result = false;
+        }
+    }
+    remove(truncatedFilename);
+    unmapFile(&file);
+
+    if(result)
+        printf("%s: ok\n", meshFilename);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        printf("Usage: meshcheck file.mesh [file2.mesh ...]\n");
+        return 1;
+    }
+
+    char truncatedFilename[1024];
+    if(!getTruncatedFilename(truncatedFilename, sizeof(truncatedFilename))) {
+        printf("Failed to find the temp directory\n");
+        return 1;
+    }
+
+    int numFailures = 0;
+    for(int i=1; i<argc; ++i)
+        if(!checkMesh(argv[i], truncatedFilename))
+            ++numFailures;
+    return numFailures;
+}
@@ -0,0 +1,96 @@
+// Converts .obj files to the binary .mesh format described in BakedMesh.h.
+// Built as a single translation unit, like jumbo.cpp.
+//
+// Usage: objbake [-compress] file.obj [file2.obj ...]
+// Writes file.mesh next to each input file, with a chain of simplified
+// levels of detail and the buffers reordered for the post-transform vertex
+// cache, overdraw and vertex fetch. -compress encodes the buffers with
+// MeshCompression.h.
+
+#include "../ObjLoading.cpp"
+#include "../Allocator.cpp"
+#include "../FileMapping.cpp"
+#include "../Threads.cpp"
+#include "../Timer.cpp"
+#include "../BakedMesh.cpp"
+#include "../MeshCompression.cpp"
+#include "../MeshOptimisation.cpp"
+#include "../MeshSimplification.cpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ToolHelpers.h"
+
+int main(int argc, char** argv)
+{
+    bool compress = argc > 1 && strcmp(argv[1], "-compress") == 0;
+    int firstFileArg = compress ? 2 : 1;
+    if(argc <= firstFileArg) {
+        printf("Usage: objbake [-compress] file.obj [file2.obj ...]\n");
+        return 1;
+    }
+
+    LoadObjOptions options = {};
+    options.numThreads = getNumLogicalCores();
+
+    // Each level has about half the triangles of the one before it
+    float lodTargetRatios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+    float lodMaxErrors[] = { 0.01f, 0.02f, 0.04f, 0.08f };
+
+    int numFailures = 0;
+    for(int i=firstFileArg; i<argc; ++i)
+    {
+        const char* objFilename = argv[i];
+        char meshFilename[1024];
+        if(!replaceExtension(objFilename, ".mesh", meshFilename, sizeof(meshFilename))) {
+            printf("%s: path too long\n", objFilename);
+            ++numFailures;
+            continue;
+        }
+
+        LoadedObj obj = loadObj(objFilename, options);
+
+        VertexCacheStats cacheStatsBefore = analyseVertexCache(obj);
+        OverdrawStats overdrawStatsBefore = analyseOverdraw(obj);
+        VertexFetchStats fetchStatsBefore = analyseVertexFetch(obj);
+
+        generateLods(&obj, lodTargetRatios, lodMaxErrors, sizeof(lodTargetRatios)/sizeof(lodTargetRatios[0]));
+
+        optimiseVertexCache(&obj);
+        optimiseOverdraw(&obj);
+        for(uint32_t level=1; level<obj.numLods; ++level) {
+            LoadedObj lodView = getLodView(obj, level);
+            optimiseVertexCache(&lodView);
+            optimiseOverdraw(&lodView);
+        }
+        optimiseVertexFetch(&obj);
+
+        VertexCacheStats cacheStatsAfter = analyseVertexCache(obj);
+        OverdrawStats overdrawStatsAfter = analyseOverdraw(obj);
+        VertexFetchStats fetchStatsAfter = analyseVertexFetch(obj);
+
+        if(writeBakedMesh(meshFilename, obj, compress)) {
+            printf("%s -> %s (%u vertices, %u indices, %u submeshes)\n", objFilename, meshFilename, obj.numVertices, obj.numIndices, obj.numSubmeshes);
+            BakedMesh bakedMesh;
+            if(loadBakedMesh(meshFilename, &bakedMesh)) {
+                size_t rawSize = obj.numVertices * sizeof(VertexData) + getTotalNumIndices(obj) * obj.bytesPerIndex;
+                size_t fileSize = bakedMesh.header->vertexDataSize + bakedMesh.header->indexDataSize;
+                printf("  buffers: %zu bytes -> %zu bytes (%.1f%%)\n", rawSize, fileSize, 100.0 * fileSize / CLAMP_ABOVE(rawSize, 1));
+                unloadBakedMesh(&bakedMesh);
+            }
+            printf("  vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+                cacheStatsBefore.acmr, cacheStatsAfter.acmr, cacheStatsBefore.atvr, cacheStatsAfter.atvr);
+            printf("  overdraw: %.3f -> %.3f\n", overdrawStatsBefore.overdraw, overdrawStatsAfter.overdraw);
+            printf("  vertex fetch: overfetch %.3f -> %.3f\n", fetchStatsBefore.overfetch, fetchStatsAfter.overfetch);
+            for(uint32_t level=1; level<obj.numLods; ++level)
+                printf("  lod %u: %u triangles, error %f\n", level, obj.lods[level].numIndices / 3, obj.lods[level].error);
+        }
+        else {
+            printf("%s: failed to write %s\n", objFilename, meshFilename);
+            ++numFailures;
+        }
+        freeLoadedObj(obj);
+    }
+    return numFailures;
+}
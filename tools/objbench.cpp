@@ -0,0 +1,350 @@
+// Microbenchmarks for the .obj loader.
+// Built as a single translation unit, like jumbo.cpp, so it can
+// call the loader's internal functions directly.
+//
+// Usage: objbench file.obj [file2.obj ...]
+// Checks parseFloat() rounds correctly, then times the count pass, float
+// parsing and each stage of loadObj() for each file. Use objgen to make
+// files of a known size and shape to compare runs on.
+
+#include "../ObjLoading.cpp"
+#include "../Allocator.cpp"
+#include "../FileMapping.cpp"
+#include "../Threads.cpp"
+#include "../Timer.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef void CountObjLinesFunc(const char* s, const char* end, ObjChunk* counts);
+
+// Returns the fastest time of several runs, in seconds
+static double timeCountPass(CountObjLinesFunc* countFunc, const char* begin, const char* end, ObjChunk* counts)
+{
+    const int NUM_RUNS = 20;
+    double bestTime = 1e30;
+    for(int run=0; run<NUM_RUNS; ++run)
+    {
+        *counts = {};
+        double startTime = getTimeInSeconds();
+        countFunc(begin, end, counts);
+        double time = getTimeInSeconds() - startTime;
+        if(time < bestTime)
+            bestTime = time;
+    }
+    return bestTime;
+}
+
+static void benchmarkCountPass(const char* filename)
+{
+    MappedFile file;
+    if(!mapFile(filename, &file)) {
+        printf("Failed to open %s\n", filename);
+        return;
+    }
+    const char* begin = (const char*)file.data;
+    const char* end = begin + file.numBytes;
+    double numMegabytes = file.numBytes / (1024.0 * 1024.0);
+
+    ObjChunk scalarCounts, simdCounts;
+    double scalarTime = timeCountPass(countObjLinesScalar, begin, end, &scalarCounts);
+    double simdTime = timeCountPass(countObjLines, begin, end, &simdCounts);
+
+    bool countsMatch = scalarCounts.numVertexPositions == simdCounts.numVertexPositions
+        && scalarCounts.numVertexTexCoords == simdCounts.numVertexTexCoords
+        && scalarCounts.numVertexNormals == simdCounts.numVertexNormals
+        && scalarCounts.numFaces == simdCounts.numFaces
+        && scalarCounts.finalSmoothingState == simdCounts.finalSmoothingState;
+
+    printf("%s (%.2f MB): v %u, vt %u, vn %u, f %u%s\n", filename, numMegabytes,
+        simdCounts.numVertexPositions, simdCounts.numVertexTexCoords,
+        simdCounts.numVertexNormals, simdCounts.numFaces,
+        countsMatch ? "" : " COUNT MISMATCH!");
+    printf("  count pass, scalar: %8.3f ms %8.1f MB/s\n", scalarTime * 1000.0, numMegabytes / scalarTime);
+#ifdef OBJ_COUNT_SIMD_WIDTH
+    printf("  count pass, simd%d: %8.3f ms %8.1f MB/s\n", OBJ_COUNT_SIMD_WIDTH * 8, simdTime * 1000.0, numMegabytes / simdTime);
+#else
+    printf("  count pass, no simd: %8.3f ms %8.1f MB/s\n", simdTime * 1000.0, numMegabytes / simdTime);
+#endif
+
+    unmapFile(&file);
+}
+
+// The parser parseFloat() replaced, kept to compare against. It accumulates
+// digits in a double, which is exact up to about 9e15 but loses precision
+// for longer mantissas, then double rounds when converting to float.
+static float parseFloatDoubleAccumulate(const char* s, const char* end, const char** outEnd)
+{
+    static const double powers[] = {1e0, 1e+1, 1e+2, 1e+3, 1e+4, 1e+5, 1e+6, 1e+7, 1e+8, 1e+9, 1e+10, 1e+11, 1e+12, 1e+13, 1e+14, 1e+15, 1e+16, 1e+17, 1e+18, 1e+19, 1e+20, 1e+21, 1e+22};
+
+    s = skipWhitespace(s, end);
+
+    double sign = (s < end && *s == '-') ? -1 : 1;
+    if(s < end && (*s == '-' || *s == '+'))
+        ++s;
+
+    double result = 0;
+    int power = 0;
+    while (isDigit(s, end))
+    {
+        result = result * 10 + (double)(*s - '0');
+        ++s;
+    }
+    if (s < end && *s == '.')
+    {
+        ++s;
+        while (isDigit(s, end))
+        {
+            result = result * 10 + (double)(*s - '0');
+            ++s;
+            --power;
+        }
+    }
+    if (s < end && (*s | ' ') == 'e')
+    {
+        ++s;
+        int expSign = (s < end && *s == '-') ? -1 : 1;
+        if(s < end && (*s == '-' || *s == '+'))
+            ++s;
+        int expPower = 0;
+        while (isDigit(s, end))
+        {
+            expPower = expPower * 10 + (*s - '0');
+            ++s;
+        }
+        power += expSign * expPower;
+    }
+
+    *outEnd = s;
+
+    if (unsigned(-power) < sizeof(powers) / sizeof(powers[0]))
+        return float(sign * result / powers[-power]);
+    else if (unsigned(power) < sizeof(powers) / sizeof(powers[0]))
+        return float(sign * result * powers[power]);
+    else
+        return float(sign * result * pow(10.0, power));
+}
+
+// strtof() needs a NUL-terminated string but is otherwise the same shape
+static float parseFloatStrtof(const char* s, const char* /*end*/, const char** outEnd)
+{
+    char* numberEnd;
+    float result = strtof(s, &numberEnd);
+    *outEnd = numberEnd;
+    return result;
+}
+
+typedef float ParseFloatFunc(const char* s, const char* end, const char** outEnd);
+
+// Returns the fastest time of several runs to parse every number in
+// `numbers`, in seconds. Writes the parsed values to `results`.
+static double timeParseFloat(ParseFloatFunc* parseFuncToTime, const char* const* numbers, uint32_t numNumbers, const char* end, float* results)
+{
+    // Call through a volatile pointer so the compiler can't inline
+    // some parsers into this loop and not others
+    ParseFloatFunc* volatile parseFunc = parseFuncToTime;
+    const int NUM_RUNS = 10;
+    double bestTime = 1e30;
+    for(int run=0; run<NUM_RUNS; ++run)
+    {
+        double startTime = getTimeInSeconds();
+        for(uint32_t i=0; i<numNumbers; ++i) {
+            const char* numberEnd;
+            results[i] = parseFunc(numbers[i], end, &numberEnd);
+        }
+        double time = getTimeInSeconds() - startTime;
+        if(time < bestTime)
+            bestTime = time;
+    }
+    return bestTime;
+}
+
+static uint32_t countMismatches(const float* a, const float* b, uint32_t count)
+{
+    uint32_t result = 0;
+    for(uint32_t i=0; i<count; ++i)
+        result += (memcmp(a + i, b + i, sizeof(float)) != 0);
+    return result;
+}
+
+static void benchmarkParseFloat(const char* filename)
+{
+    MappedFile file;
+    if(!mapFile(filename, &file)) {
+        printf("Failed to open %s\n", filename);
+        return;
+    }
+
+    // Copy the file so strtof() has a NUL terminator to stop at
+    char* begin = (char*)malloc(file.numBytes + 1);
+    assert(begin);
+    memcpy(begin, file.data, file.numBytes);
+    begin[file.numBytes] = '\0';
+    const char* end = begin + file.numBytes;
+    unmapFile(&file);
+
+    // Gather the start of every number on the v, vt and vn lines
+    uint32_t numNumbers = 0;
+    uint32_t numbersCapacity = 1024;
+    const char** numbers = (const char**)malloc(numbersCapacity * sizeof(const char*));
+    assert(numbers);
+    for(const char* s=begin; s<end; s=skipLine(s, end))
+    {
+        if(*s != 'v')
+            continue;
+        const char* lineEnd = skipLine(s, end);
+        const char* it = s + 1;
+        if(it < lineEnd && (*it == 't' || *it == 'n'))
+            ++it;
+        while(true)
+        {
+            it = skipWhitespace(it, lineEnd);
+            if(it == lineEnd || *it == '\r' || *it == '\n')
+                break;
+            if(numNumbers == numbersCapacity) {
+                numbersCapacity *= 2;
+                numbers = (const char**)realloc(numbers, numbersCapacity * sizeof(const char*));
+                assert(numbers);
+            }
+            numbers[numNumbers++] = it;
+            while(it < lineEnd && *it != ' ' && *it != '\t' && *it != '\r' && *it != '\n')
+                ++it;
+        }
+    }
+
+    float* expected = (float*)malloc(numNumbers * sizeof(float));
+    float* results = (float*)malloc(numNumbers * sizeof(float));
+    assert((expected && results) || numNumbers == 0);
+
+    double strtofTime = timeParseFloat(parseFloatStrtof, numbers, numNumbers, end, expected);
+    double oldTime = timeParseFloat(parseFloatDoubleAccumulate, numbers, numNumbers, end, results);
+    uint32_t oldMismatches = countMismatches(results, expected, numNumbers);
+    double newTime = timeParseFloat(parseFloat, numbers, numNumbers, end, results);
+    uint32_t newMismatches = countMismatches(results, expected, numNumbers);
+
+    // Nanoseconds per number
+    double scale = numNumbers ? 1e9 / numNumbers : 0;
+    printf("  parseFloat, %u numbers:\n", numNumbers);
+    printf("    strtof():            %8.3f ms %6.1f ns/number\n", strtofTime * 1000.0, strtofTime * scale);
+    printf("    double accumulation: %8.3f ms %6.1f ns/number, %u not correctly rounded\n", oldTime * 1000.0, oldTime * scale, oldMismatches);
+    printf("    parseFloat():        %8.3f ms %6.1f ns/number, %u not correctly rounded\n", newTime * 1000.0, newTime * scale, newMismatches);
+
+    free(results);
+    free(expected);
+    free(numbers);
+    free(begin);
+}
+
+// Prints floats with enough digits to identify them (and fewer, which
+// round to some other float) and checks parseFloat() agrees with strtof()
+static void checkParseFloatRoundTrip()
+{
+    const uint32_t NUM_VALUES = 1000000;
+    uint32_t numMismatches = 0;
+    uint32_t numChecked = 0;
+    uint32_t random = 1;
+    for(uint32_t i=0; i<NUM_VALUES; ++i)
+    {
+        // xorshift32 over every bit pattern, skipping infinities and NaNs
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        float value;
+        memcpy(&value, &random, sizeof(value));
+        if((random & 0x7f800000) == 0x7f800000)
+            continue;
+
+        for(int numDigits=1; numDigits<=9; numDigits+=4)
+        {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "%.*g", numDigits, value);
+            const char* numberEnd;
+            float parsed = parseFloat(buffer, buffer + strlen(buffer), &numberEnd);
+            float expected = strtof(buffer, NULL);
+            bool roundTrips = (numDigits < 9) || memcmp(&parsed, &value, sizeof(float)) == 0;
+            if(!roundTrips || memcmp(&parsed, &expected, sizeof(float)) != 0) {
+                if(numMismatches < 10)
+                    printf("  parseFloat(\"%s\") = %.9g, expected %.9g\n", buffer, parsed, expected);
+                ++numMismatches;
+            }
+            ++numChecked;
+        }
+    }
+    printf("parseFloat round trip: %u numbers, %u mismatches\n", numChecked, numMismatches);
+}
+
+// Times every stage of loadObj() over several runs, keeping each stage's
+// fastest time so one-off hiccups don't count against it
+static void benchmarkLoadStages(const char* filename, uint32_t numThreads)
+{
+    MappedFile file;
+    if(!mapFile(filename, &file)) {
+        printf("Failed to open %s\n", filename);
+        return;
+    }
+    double numMegabytes = file.numBytes / (1024.0 * 1024.0);
+    unmapFile(&file);
+
+    LoadObjOptions options = {};
+    options.numThreads = numThreads;
+    LoadObjStats stats;
+    options.stats = &stats;
+
+    const int NUM_RUNS = 10;
+    LoadObjStats best = {};
+    double bestTotalTime = 1e30;
+    uint32_t numTriangles = 0;
+    for(int run=0; run<NUM_RUNS; ++run)
+    {
+        double startTime = getTimeInSeconds();
+        LoadedObj obj = loadObj(filename, options);
+        double totalTime = getTimeInSeconds() - startTime;
+        numTriangles = obj.numIndices / 3;
+        freeLoadedObj(obj);
+
+        if(run == 0 || stats.readSeconds < best.readSeconds) best.readSeconds = stats.readSeconds;
+        if(run == 0 || stats.countSeconds < best.countSeconds) best.countSeconds = stats.countSeconds;
+        if(run == 0 || stats.parseSeconds < best.parseSeconds) best.parseSeconds = stats.parseSeconds;
+        if(run == 0 || stats.weldSeconds < best.weldSeconds) best.weldSeconds = stats.weldSeconds;
+        if(run == 0 || stats.normaliseSeconds < best.normaliseSeconds) best.normaliseSeconds = stats.normaliseSeconds;
+        if(run == 0 || stats.outputSeconds < best.outputSeconds) best.outputSeconds = stats.outputSeconds;
+        if(totalTime < bestTotalTime)
+            bestTotalTime = totalTime;
+    }
+
+    printf("  loadObj(), %u thread%s: %8.3f ms %8.1f MB/s %8.2f M triangles/s\n",
+        numThreads, numThreads == 1 ? "" : "s", bestTotalTime * 1000.0,
+        numMegabytes / bestTotalTime, numTriangles / bestTotalTime * 1e-6);
+    struct { const char* name; double seconds; } stageTimes[] = {
+        { "read", best.readSeconds },
+        { "count", best.countSeconds },
+        { "parse", best.parseSeconds },
+        { "weld", best.weldSeconds },
+        { "normalise", best.normaliseSeconds },
+        { "output", best.outputSeconds },
+    };
+    for(size_t i=0; i<sizeof(stageTimes)/sizeof(stageTimes[0]); ++i)
+    {
+        double seconds = stageTimes[i].seconds;
+        printf("    %-10s %8.3f ms %8.1f MB/s\n", stageTimes[i].name, seconds * 1000.0,
+            seconds > 0 ? numMegabytes / seconds : 0.0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        printf("Usage: objbench file.obj [file2.obj ...]\n");
+        return 1;
+    }
+    checkParseFloatRoundTrip();
+    uint32_t numCores = getNumLogicalCores();
+    for(int i=1; i<argc; ++i) {
+        benchmarkCountPass(argv[i]);
+        benchmarkParseFloat(argv[i]);
+        benchmarkLoadStages(argv[i], 1);
+        if(numCores > 1)
+            benchmarkLoadStages(argv[i], numCores);
+    }
+    return 0;
+}
@@ -0,0 +1,370 @@
+// Generates synthetic .obj files of a known size and shape, to benchmark
+// the loader with objbench and compare runs against each other.
+//
+// Usage: objgen shape size [options] out.obj
+//        objgen -corpus directory
+//
+// Shapes:
+//   grid N     N x N quads, every vertex is shared by up to 6 triangles
+//   sphere N   UV sphere with N segments around and N/2 rings
+//   soup N     N randomly placed triangles which share no vertices
+// Options:
+//   -duplicate Write each face's vertices just before it rather than
+//              sharing them, so the loader has to weld every corner
+//   -negative  Use relative (negative) indices
+//   -smooth    Switch between "s 1" and "s off" every few hundred faces
+//   -nouvs     Don't write texture coordinates
+//   -nonormals Don't write normals
+//
+// -corpus writes a standard set of files covering all of the above,
+// creating the directory if it doesn't exist.
+
+#include "../3DMaths.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+// Returns true if the directory exists afterwards. Doesn't create parents.
+static bool createDirectory(const char* path)
+{
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+#else
+
+#include <errno.h>
+#include <sys/stat.h>
+
+// Returns true if the directory exists afterwards. Doesn't create parents.
+static bool createDirectory(const char* path)
+{
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+#endif
+
+struct ObjGenOptions
+{
+    bool duplicateVertices;
+    bool negativeIndices;
+    bool smoothingGroups;
+    bool uvs;
+    bool normals;
+};
+
+// Indexed triangle mesh to write out
+struct GenMesh
+{
+    uint32_t numVertices;
+    vec3* positions;
+    vec2* uvs;
+    vec3* normals;
+    uint32_t numTriangles;
+    uint32_t* indices;
+};
+
+#define SMOOTHING_GROUP_NUM_FACES 256
+
+static GenMesh allocGenMesh(uint32_t numVertices, uint32_t numTriangles)
+{
+    GenMesh mesh = {};
+    mesh.numVertices = numVertices;
+    mesh.positions = (vec3*)malloc(numVertices * sizeof(vec3));
+    mesh.uvs = (vec2*)malloc(numVertices * sizeof(vec2));
+    mesh.normals = (vec3*)malloc(numVertices * sizeof(vec3));
+    mesh.numTriangles = numTriangles;
+    mesh.indices = (uint32_t*)malloc(numTriangles * 3 * sizeof(uint32_t));
+    assert(mesh.positions && mesh.uvs && mesh.normals && mesh.indices);
+    return mesh;
+}
+
+static void freeGenMesh(GenMesh mesh)
+{
+    free(mesh.positions);
+    free(mesh.uvs);
+    free(mesh.normals);
+    free(mesh.indices);
+}
+
+// Unit square in the xz plane, split into n x n quads
+static GenMesh generateGrid(uint32_t n)
+{
+    uint32_t rowLength = n + 1;
+    GenMesh mesh = allocGenMesh(rowLength * rowLength, 2 * n * n);
+    for(uint32_t z=0; z<rowLength; ++z)
+    for(uint32_t x=0; x<rowLength; ++x)
+    {
+        uint32_t i = z * rowLength + x;
+        vec2 uv = { (float)x / n, (float)z / n };
+        mesh.positions[i] = { uv.x - 0.5f, 0.f, uv.y - 0.5f };
+        mesh.uvs[i] = uv;
+        mesh.normals[i] = { 0.f, 1.f, 0.f };
+    }
+
+    uint32_t* index = mesh.indices;
+    for(uint32_t z=0; z<n; ++z)
+    for(uint32_t x=0; x<n; ++x)
+    {
+        uint32_t topLeft = z * rowLength + x;
+        uint32_t bottomLeft = topLeft + rowLength;
+        *index++ = topLeft; *index++ = bottomLeft; *index++ = topLeft + 1;
+        *index++ = topLeft + 1; *index++ = bottomLeft; *index++ = bottomLeft + 1;
+    }
+    return mesh;
+}
+
+// Unit sphere. Like most exporters the seam and poles have a vertex for
+// each uv, so they share positions.
+static GenMesh generateSphere(uint32_t numSegments)
+{
+    numSegments = CLAMP_ABOVE(numSegments, 4);
+    uint32_t numRings = numSegments / 2;
+    uint32_t rowLength = numSegments + 1;
+    GenMesh mesh = allocGenMesh(rowLength * (numRings + 1), 2 * numSegments * numRings);
+    for(uint32_t ring=0; ring<=numRings; ++ring)
+    for(uint32_t segment=0; segment<=numSegments; ++segment)
+    {
+        uint32_t i = ring * rowLength + segment;
+        float theta = PI32 * ring / numRings;
+        float phi = 2.f * PI32 * segment / numSegments;
+        vec3 p = { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) };
+        mesh.positions[i] = p;
+        mesh.uvs[i] = { (float)segment / numSegments, (float)ring / numRings };
+        mesh.normals[i] = p;
+    }
+
+    uint32_t* index = mesh.indices;
+    for(uint32_t ring=0; ring<numRings; ++ring)
+    for(uint32_t segment=0; segment<numSegments; ++segment)
+    {
+        uint32_t topLeft = ring * rowLength + segment;
+        uint32_t bottomLeft = topLeft + rowLength;
+        *index++ = topLeft; *index++ = topLeft + 1; *index++ = bottomLeft;
+        *index++ = topLeft + 1; *index++ = bottomLeft + 1; *index++ = bottomLeft;
+    }
+    return mesh;
+}
+
+static float randomFloat(uint32_t* state)
+{
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (x >> 8) * (1.f / 16777216.f);
+}
+
+// Small triangles scattered through the unit cube, none of them share a vertex
+static GenMesh generateSoup(uint32_t numTriangles)
+{
+    GenMesh mesh = allocGenMesh(3 * numTriangles, numTriangles);
+    uint32_t random = 1;
+    for(uint32_t t=0; t<numTriangles; ++t)
+    {
+        vec3 center = { randomFloat(&random) - 0.5f, randomFloat(&random) - 0.5f, randomFloat(&random) - 0.5f };
+        vec3 normal = normaliseOrZero(vec3{ randomFloat(&random) - 0.5f, randomFloat(&random) - 0.5f, randomFloat(&random) + 0.01f });
+        for(uint32_t corner=0; corner<3; ++corner)
+        {
+            uint32_t i = 3 * t + corner;
+            vec3 offset = { randomFloat(&random) - 0.5f, randomFloat(&random) - 0.5f, randomFloat(&random) - 0.5f };
+            mesh.positions[i] = center + offset * 0.01f;
+            mesh.uvs[i] = { randomFloat(&random), randomFloat(&random) };
+            mesh.normals[i] = normal;
+            mesh.indices[i] = i;
+        }
+    }
+    return mesh;
+}
+
+static void writeVertex(FILE* file, const GenMesh &mesh, uint32_t i, const ObjGenOptions &options)
+{
+    vec3 p = mesh.positions[i];
+    fprintf(file, "v %f %f %f\n", p.x, p.y, p.z);
+    if(options.uvs)
+        fprintf(file, "vt %f %f\n", mesh.uvs[i].x, mesh.uvs[i].y);
+    if(options.normals) {
+        vec3 n = mesh.normals[i];
+        fprintf(file, "vn %f %f %f\n", n.x, n.y, n.z);
+    }
+}
+
+// `index` is 1-based, `numWritten` is how many vertices have been written so far
+static void writeFaceCorner(FILE* file, int64_t index, int64_t numWritten, const ObjGenOptions &options)
+{
+    if(options.negativeIndices)
+        index -= numWritten + 1;
+    if(options.uvs && options.normals)
+        fprintf(file, " %lld/%lld/%lld", (long long)index, (long long)index, (long long)index);
+    else if(options.uvs)
+        fprintf(file, " %lld/%lld", (long long)index, (long long)index);
+    else if(options.normals)
+        fprintf(file, " %lld//%lld", (long long)index, (long long)index);
+    else
+        fprintf(file, " %lld", (long long)index);
+}
+
+static bool writeGenMesh(const char* filename, const GenMesh &mesh, const ObjGenOptions &options)
+{
+    FILE* file = fopen(filename, "wb");
+    if(!file)
+        return false;
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    fprintf(file, "# Generated by objgen: %u vertices, %u triangles\n", mesh.numVertices, mesh.numTriangles);
+
+    int64_t numWritten = 0;
+    if(!options.duplicateVertices) {
+        for(uint32_t i=0; i<mesh.numVertices; ++i)
+            writeVertex(file, mesh, i, options);
+        numWritten = mesh.numVertices;
+    }
+
+    for(uint32_t t=0; t<mesh.numTriangles; ++t)
+    {
+        if(options.smoothingGroups && t % SMOOTHING_GROUP_NUM_FACES == 0)
+            fprintf(file, (t / SMOOTHING_GROUP_NUM_FACES) % 2 ? "s off\n" : "s 1\n");
+
+        const uint32_t* triangle = mesh.indices + 3 * t;
+        int64_t faceIndices[3];
+        for(uint32_t corner=0; corner<3; ++corner)
+        {
+            if(options.duplicateVertices) {
+                writeVertex(file, mesh, triangle[corner], options);
+                faceIndices[corner] = ++numWritten;
+            }
+            else {
+                faceIndices[corner] = triangle[corner] + 1;
+            }
+        }
+
+        fprintf(file, "f");
+        for(uint32_t corner=0; corner<3; ++corner)
+            writeFaceCorner(file, faceIndices[corner], numWritten, options);
+        fprintf(file, "\n");
+    }
+
+    bool success = !ferror(file);
+    success &= (fclose(file) == 0);
+    return success;
+}
+
+static bool generate(const char* shape, uint32_t size, const ObjGenOptions &options, const char* filename)
+{
+    GenMesh mesh;
+    if(strcmp(shape, "grid") == 0)
+        mesh = generateGrid(size);
+    else if(strcmp(shape, "sphere") == 0)
+        mesh = generateSphere(size);
+    else if(strcmp(shape, "soup") == 0)
+        mesh = generateSoup(size);
+    else {
+        printf("Unknown shape '%s'\n", shape);
+        return false;
+    }
+
+    bool success = writeGenMesh(filename, mesh, options);
+    if(success)
+        printf("%s: %u triangles\n", filename, mesh.numTriangles);
+    else
+        printf("Failed to write %s\n", filename);
+    freeGenMesh(mesh);
+    return success;
+}
+
+static bool generateCorpus(const char* directory)
+{
+    struct CorpusFile
+    {
+        const char* name;
+        const char* shape;
+        uint32_t size;
+        bool duplicateVertices;
+        bool negativeIndices;
+        bool smoothingGroups;
+    };
+    CorpusFile corpus[] = {
+        { "grid_64.obj", "grid", 64, false, false, false },
+        { "grid_512.obj", "grid", 512, false, false, false },
+        { "grid_256_duplicate.obj", "grid", 256, true, false, false },
+        { "grid_256_negative.obj", "grid", 256, true, true, false },
+        { "grid_256_smooth.obj", "grid", 256, false, false, true },
+        { "sphere_512.obj", "sphere", 512, false, false, false },
+        { "soup_262144.obj", "soup", 262144, false, false, false },
+    };
+
+    if(!createDirectory(directory)) {
+        printf("Failed to create directory %s, its parent directory must already exist\n", directory);
+        return false;
+    }
+
+    bool success = true;
+    for(size_t i=0; i<sizeof(corpus)/sizeof(corpus[0]); ++i)
+    {
+        char filename[1024];
+        int length = snprintf(filename, sizeof(filename), "%s/%s", directory, corpus[i].name);
+        if(length < 0 || length >= (int)sizeof(filename)) {
+            printf("%s: path too long\n", directory);
+            return false;
+        }
+
+        ObjGenOptions options = {};
+        options.uvs = true;
+        options.normals = true;
+        options.duplicateVertices = corpus[i].duplicateVertices;
+        options.negativeIndices = corpus[i].negativeIndices;
+        options.smoothingGroups = corpus[i].smoothingGroups;
+        success &= generate(corpus[i].shape, corpus[i].size, options, filename);
+    }
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc == 3 && strcmp(argv[1], "-corpus") == 0)
+        return generateCorpus(argv[2]) ? 0 : 1;
+
+    if(argc < 4) {
+        printf("Usage: objgen grid|sphere|soup size [-duplicate] [-negative] [-smooth] [-nouvs] [-nonormals] out.obj\n");
+        printf("       objgen -corpus directory\n");
+        return 1;
+    }
+
+    ObjGenOptions options = {};
+    options.uvs = true;
+    options.normals = true;
+    for(int i=3; i<argc-1; ++i)
+    {
+        if(strcmp(argv[i], "-duplicate") == 0) options.duplicateVertices = true;
+        else if(strcmp(argv[i], "-negative") == 0) options.negativeIndices = true;
+        else if(strcmp(argv[i], "-smooth") == 0) options.smoothingGroups = true;
+        else if(strcmp(argv[i], "-nouvs") == 0) options.uvs = false;
+        else if(strcmp(argv[i], "-nonormals") == 0) options.normals = false;
+        else {
+            printf("Unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    int size = atoi(argv[2]);
+    if(size <= 0) {
+        printf("Size must be positive\n");
+        return 1;
+    }
+    return generate(argv[1], (uint32_t)size, options, argv[argc-1]) ? 0 : 1;
+}
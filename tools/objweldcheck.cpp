@@ -0,0 +1,154 @@
+// Checks the hash grid vertex welding in loadObj() gives exactly the same
+// output as the linear search it replaced.
+// Built as a single translation unit, like jumbo.cpp, so it can
+// call the loader's internal functions directly.
+//
+// Usage: objweldcheck file.obj [file2.obj ...]
+// e.g. objweldcheck data\*.obj
+// Parses each file with the same count and parse stages as loadObj(), welds
+// the face corners by searching every vertex so far for a match, then compares
+// the vertex and index buffers with loadObj()'s. Returns the number of files
+// that don't match. The linear search is O(n^2), so keep the files small.
+
+#include "../ObjLoading.cpp"
+#include "../Allocator.cpp"
+#include "../FileMapping.cpp"
+#include "../Threads.cpp"
+#include "../Timer.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The weld loop from before the hash grid. A corner reuses the first
+// vertex with almost equal position and uv, and almost equal normal unless
+// it's in a smoothing group, in which case the normals are summed.
+static LoadedObj loadObjLinearSearch(const char* begin, const char* end)
+{
+    ObjChunk chunk = {};
+    chunk.begin = begin;
+    chunk.end = end;
+    countObjChunk(&chunk);
+
+    uint32_t numCorners = 3 * chunk.numFaces;
+    ObjParseData parseData;
+    parseData.vpBuffer = (float*)malloc(chunk.numVertexPositions * 3 * sizeof(float) + 1);
+    parseData.vtBuffer = (float*)malloc(chunk.numVertexTexCoords * 2 * sizeof(float) + 1);
+    parseData.vnBuffer = (float*)malloc(chunk.numVertexNormals * 3 * sizeof(float) + 1);
+    parseData.corners = (ObjFaceCorner*)malloc(numCorners * sizeof(ObjFaceCorner) + 1);
+    parseData.submeshRecords = (ObjSubmeshRecord*)malloc(chunk.numSubmeshRecords * sizeof(ObjSubmeshRecord) + 1);
+    assert(parseData.vpBuffer && parseData.vtBuffer && parseData.vnBuffer && parseData.corners && parseData.submeshRecords);
+    chunk.parseData = &parseData;
+    parseObjChunk(&chunk);
+
+    LoadedObj result = {};
+    result.vertexBuffer = (VertexData*)malloc(chunk.numCorners * sizeof(VertexData) + 1);
+    uint32_t* indices = (uint32_t*)malloc(chunk.numCorners * sizeof(uint32_t) + 1);
+    assert(result.vertexBuffer && indices);
+
+    for(uint32_t cornerIdx=0; cornerIdx<chunk.numCorners; ++cornerIdx)
+    {
+        const ObjFaceCorner* corner = parseData.corners + cornerIdx;
+        const float* vp = parseData.vpBuffer + 3*corner->vp;
+        VertexData newVert = {};
+        newVert.pos = { vp[0], vp[1], vp[2] };
+        if(corner->vt >= 0) {
+            const float* vt = parseData.vtBuffer + 2*corner->vt;
+            newVert.uv = { vt[0], vt[1] };
+        }
+        if(corner->vn >= 0) {
+            const float* vn = parseData.vnBuffer + 3*corner->vn;
+            newVert.norm = { vn[0], vn[1], vn[2] };
+        }
+
+        uint32_t index;
+        for(index=0; index<result.numVertices; ++index)
+        {
+            VertexData* v = result.vertexBuffer + index;
+            bool posMatch = areAlmostEqual(v->pos, newVert.pos);
+            bool uvMatch = areAlmostEqual(v->uv, newVert.uv);
+            bool normMatch = areAlmostEqual(v->norm, newVert.norm);
+            if(posMatch && uvMatch && (normMatch || corner->smoothNormals)) {
+                v->norm += newVert.norm;
+                break;
+            }
+        }
+        if(index == result.numVertices)
+            result.vertexBuffer[result.numVertices++] = newVert;
+        indices[result.numIndices++] = index;
+    }
+
+    for(uint32_t i=0; i<result.numVertices; ++i)
+        result.vertexBuffer[i].norm = normaliseOrZero(result.vertexBuffer[i].norm);
+
+    free(parseData.vpBuffer);
+    free(parseData.vtBuffer);
+    free(parseData.vnBuffer);
+    free(parseData.corners);
+    free(parseData.submeshRecords);
+
+    result.indexBuffer = indices;
+    result.bytesPerIndex = sizeof(uint32_t);
+    return result;
+}
+
+// Returns true if the welded buffers are identical
+static bool checkWelding(const char* filename)
+{
+    MappedFile file;
+    if(!mapFile(filename, &file)) {
+        printf("Failed to open %s\n", filename);
+        return false;
+    }
+    const char* begin = (const char*)file.data;
+    LoadedObj expected = loadObjLinearSearch(begin, begin + file.numBytes);
+    unmapFile(&file);
+
+    LoadObjOptions options = {};
+    options.numThreads = getNumLogicalCores();
+    LoadedObj actual = loadObj(filename, options);
+
+    bool result = true;
+    if(actual.numVertices != expected.numVertices || actual.numIndices != expected.numIndices) {
+        printf("%s: linear search gave %u vertices and %u indices, hash grid gave %u vertices and %u indices\n",
+            filename, expected.numVertices, expected.numIndices, actual.numVertices, actual.numIndices);
+        result = false;
+    }
+    else {
+        for(uint32_t i=0; i<actual.numVertices; ++i) {
+            if(memcmp(actual.vertexBuffer + i, expected.vertexBuffer + i, sizeof(VertexData)) != 0) {
+                printf("%s: vertex %u differs\n", filename, i);
+                result = false;
+                break;
+            }
+        }
+        for(uint32_t i=0; i<actual.numIndices; ++i) {
+            if(getIndex(actual, i) != getIndex(expected, i)) {
+                printf("%s: index %u is %u, linear search gave %u\n", filename, i, getIndex(actual, i), getIndex(expected, i));
+                result = false;
+                break;
+            }
+        }
+    }
+    if(result)
+        printf("%s: %u vertices, %u indices, identical\n", filename, actual.numVertices, actual.numIndices);
+
+    freeLoadedObj(actual);
+    free(expected.vertexBuffer);
+    free(expected.indexBuffer);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        printf("Usage: objweldcheck file.obj [file2.obj ...]\n");
+        return 1;
+    }
+
+    int numFailures = 0;
+    for(int i=1; i<argc; ++i)
+        if(!checkWelding(argv[i]))
+            ++numFailures;
+    return numFailures;
+}